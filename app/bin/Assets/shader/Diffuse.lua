@@ -2,19 +2,45 @@ local vs = [[
 #ifndef SKIN_ON
 	#define SKIN_ON 0
 #endif
+#ifndef INSTANCING_ON
+	#define INSTANCING_ON 0
+#endif
 #ifndef RECIEVE_SHADOW_ON
 	#define RECIEVE_SHADOW_ON 0
 #endif
+#ifndef CLUSTER_LIGHTING_ON
+	#define CLUSTER_LIGHTING_ON 0
+#endif
+#ifndef LOD_FADE_CROSSFADE
+	#define LOD_FADE_CROSSFADE 0
+#endif
 
 VK_UNIFORM_BINDING(0) uniform PerView
 {
 	mat4 u_view_matrix;
     mat4 u_projection_matrix;
 };
-VK_UNIFORM_BINDING(1) uniform PerRenderer
-{
-	mat4 u_model_matrix;
-};
+#if (INSTANCING_ON == 1)
+	VK_UNIFORM_BINDING(1) uniform PerRenderer
+	{
+		mat4 u_model_matrices[128];
+	};
+#elif (LOD_FADE_CROSSFADE == 1)
+	VK_UNIFORM_BINDING(1) uniform PerRenderer
+	{
+		mat4 u_model_matrix;
+		mat4 u_bounds_matrix;
+		vec4 u_bounds_color;
+		vec4 u_lightmap_scale_offset;
+		vec4 u_lightmap_index;
+		vec4 u_lod_fade;
+	};
+#else
+	VK_UNIFORM_BINDING(1) uniform PerRenderer
+	{
+		mat4 u_model_matrix;
+	};
+#endif
 VK_UNIFORM_BINDING(3) uniform PerMaterialVertex
 {
 	vec4 u_texture_scale_offset;
@@ -51,19 +77,19 @@ VK_LAYOUT_LOCATION(2) out vec3 v_normal;
 	}
 #endif
 
-#if (RECIEVE_SHADOW_ON == 1)
-	VK_LAYOUT_LOCATION(3) out vec4 v_pos_light_proj;
-	VK_UNIFORM_BINDING(5) uniform PerLightVertex
-	{
-		mat4 u_light_view_matrix;
-		mat4 u_light_projection_matrix;
-	};
+#if (CLUSTER_LIGHTING_ON == 1)
+	VK_LAYOUT_LOCATION(4) out vec4 v_cluster_pos;
+#endif
+#if (LOD_FADE_CROSSFADE == 1)
+	VK_LAYOUT_LOCATION(5) out vec2 v_lod_fade;
 #endif
 
 void main()
 {
 #if (SKIN_ON == 1)
     mat4 model_matrix = skin_mat();
+#elif (INSTANCING_ON == 1)
+    mat4 model_matrix = u_model_matrices[VK_INSTANCE_INDEX];
 #else
     mat4 model_matrix = u_model_matrix;
 #endif
@@ -74,8 +100,17 @@ void main()
 	v_uv = i_uv * u_texture_scale_offset.xy + u_texture_scale_offset.zw;
     v_normal = (vec4(i_normal, 0.0) * model_matrix).xyz;
 
-#if (RECIEVE_SHADOW_ON == 1)
-	v_pos_light_proj = vec4(i_vertex.xyz, 1.0) * model_matrix * u_light_view_matrix * u_light_projection_matrix;
+#if (CLUSTER_LIGHTING_ON == 1)
+	// clip xy and w before api conversion, view depth
+	v_cluster_pos = vec4(gl_Position.xyw, -(world_pos * u_view_matrix).z);
+#endif
+
+#if (LOD_FADE_CROSSFADE == 1)
+	#if (INSTANCING_ON == 1)
+		v_lod_fade = vec2(1.0, 1.0);
+	#else
+		v_lod_fade = u_lod_fade.xy;
+	#endif
 #endif
 
 	vk_convert();
@@ -92,6 +127,12 @@ local fs = [[
 #ifndef VR_GLES
 	#define VR_GLES 0
 #endif
+#ifndef CLUSTER_LIGHTING_ON
+	#define CLUSTER_LIGHTING_ON 0
+#endif
+#ifndef LOD_FADE_CROSSFADE
+	#define LOD_FADE_CROSSFADE 0
+#endif
 
 precision highp float;
 VK_SAMPLER_BINDING(0) uniform sampler2D u_texture;
@@ -99,22 +140,69 @@ VK_UNIFORM_BINDING(4) uniform PerMaterialFragment
 {
     vec4 u_color;
 };
-VK_UNIFORM_BINDING(6) uniform PerLightFragment
-{
-	vec4 u_ambient_color;
-    vec4 u_light_pos;
-    vec4 u_light_color;
-	vec4 u_light_atten;
-	vec4 u_spot_light_dir;
-	vec4 u_shadow_params;
-};
+#if (CLUSTER_LIGHTING_ON == 1)
+	// 16 x 9 x 24 clusters, bit i of a cluster mask for light i
+	VK_UNIFORM_BINDING(6) uniform PerLightFragment
+	{
+		vec4 u_ambient_color;
+		vec4 u_cluster_params;
+		vec4 u_cluster_light_pos[32];
+		vec4 u_cluster_light_color[32];
+		vec4 u_cluster_light_atten[32];
+		vec4 u_cluster_spot_light_dir[32];
+		uvec4 u_cluster_light_masks[864];
+	};
+	VK_LAYOUT_LOCATION(4) in vec4 v_cluster_pos;
+	uint cluster_light_mask()
+	{
+		vec2 ndc = v_cluster_pos.xy / v_cluster_pos.z;
+		int x = int(clamp((ndc.x * 0.5 + 0.5) * 16.0, 0.0, 15.0));
+		int y = int(clamp((ndc.y * 0.5 + 0.5) * 9.0, 0.0, 8.0));
+		int z = int(clamp(log(max(v_cluster_pos.w, u_cluster_params.x) / u_cluster_params.x) * u_cluster_params.y, 0.0, 23.0));
+		int index = x + y * 16 + z * 144;
+		return u_cluster_light_masks[index / 4][index % 4];
+	}
+#else
+	VK_UNIFORM_BINDING(6) uniform PerLightFragment
+	{
+		vec4 u_ambient_color;
+		vec4 u_light_pos;
+		vec4 u_light_color;
+		vec4 u_light_atten;
+		vec4 u_spot_light_dir;
+		vec4 u_shadow_params;
+		mat4 u_shadow_matrices[4];
+		vec4 u_shadow_cascade_spheres[4];
+		vec4 u_shadow_cascade_params;
+		vec4 u_shadow_atlas_rects[4];
+	};
+#endif
 VK_LAYOUT_LOCATION(0) in vec3 v_pos;
 VK_LAYOUT_LOCATION(1) in vec2 v_uv;
 VK_LAYOUT_LOCATION(2) in vec3 v_normal;
 
+#if (LOD_FADE_CROSSFADE == 1)
+	VK_LAYOUT_LOCATION(5) in vec2 v_lod_fade;
+	const float Bayer4x4[16] = float[](
+		0.0, 8.0, 2.0, 10.0,
+		12.0, 4.0, 14.0, 6.0,
+		3.0, 11.0, 1.0, 9.0,
+		15.0, 7.0, 13.0, 5.0
+	);
+	// level fading out keeps pixels whose dither is below fade, level fading in keeps the rest
+	void lod_fade_clip()
+	{
+		ivec2 p = ivec2(gl_FragCoord.xy) % 4;
+		float d = (Bayer4x4[p.y * 4 + p.x] + 0.5) / 16.0;
+		if ((d < v_lod_fade.x) != (v_lod_fade.y > 0.0))
+		{
+			discard;
+		}
+	}
+#endif
+
 #if (RECIEVE_SHADOW_ON == 1)
 	VK_SAMPLER_BINDING(1) uniform highp sampler2D u_shadow_texture;
-	VK_LAYOUT_LOCATION(3) in vec4 v_pos_light_proj;
 	const vec2 Poisson25[25] = vec2[](
 		vec2(-0.978698, -0.0884121),
 		vec2(-0.841121, 0.521165),
@@ -142,16 +230,11 @@ VK_LAYOUT_LOCATION(2) in vec3 v_normal;
 		vec2(0.968871, 0.840449),
 		vec2(0.991882, -0.657338)
 	);
+	// filter taps stay inside the tile of the light in shadow atlas
+	vec4 shadow_uv_clamp;
 	float texture_shadow(vec2 uv)
 	{
-		if (uv.x < 0.0 || uv.x > 1.0 || uv.y < 0.0 || uv.y > 1.0)
-		{
-			return 1.0;
-		}
-		else
-		{
-			return texture(u_shadow_texture, uv).r;
-		}
+		return texture(u_shadow_texture, clamp(uv, shadow_uv_clamp.xy, shadow_uv_clamp.zw)).r;
 	}
 	float poisson_filter(float z, vec2 uv, float shadow_z_bias, vec2 filter_radius)
 	{
@@ -196,12 +279,48 @@ VK_LAYOUT_LOCATION(2) in vec3 v_normal;
 			return 0.0;
 		}
 	}
-	float sample_shadow(vec4 pos_light_proj, float nl)
+	// first cascade whose sphere contains the fragment, -1 if beyond all cascades
+	int shadow_cascade()
+	{
+		int count = int(u_shadow_cascade_params.x);
+		if (count <= 1)
+		{
+			return 0;
+		}
+		for (int i = 0; i < 4; ++i)
+		{
+			if (i >= count)
+			{
+				break;
+			}
+			vec3 d = v_pos - u_shadow_cascade_spheres[i].xyz;
+			if (dot(d, d) < u_shadow_cascade_spheres[i].w)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+	float sample_shadow(float nl)
 	{
+		int cascade = shadow_cascade();
+		if (cascade < 0)
+		{
+			return 0.0;
+		}
+		vec4 pos_light_proj = vec4(v_pos, 1.0) * u_shadow_matrices[cascade];
 		pos_light_proj = pos_light_proj / pos_light_proj.w;
-		vec2 uv = pos_light_proj.xy * 0.5 + 0.5;
+		if (abs(pos_light_proj.x) > 1.0 || abs(pos_light_proj.y) > 1.0)
+		{
+			return 0.0;
+		}
+		vec4 rect = u_shadow_atlas_rects[cascade];
+		vec2 uv = (pos_light_proj.xy * 0.5 + 0.5) * rect.xy + rect.zw;
+		float half_texel = u_shadow_params.w / 6.0;
+		shadow_uv_clamp = vec4(rect.zw + half_texel, rect.zw + rect.xy - half_texel);
 #if (VR_GLES == 0)
 		uv.y = 1.0 - uv.y;
+		shadow_uv_clamp.yw = 1.0 - shadow_uv_clamp.wy;
 #endif
 		float z = pos_light_proj.z * 0.5 + 0.5;
 		vec2 filter_radius = vec2(u_shadow_params.w);
@@ -210,24 +329,22 @@ VK_LAYOUT_LOCATION(2) in vec3 v_normal;
 	}
 #endif
 
-layout(location = 0) out vec4 o_color;
-void main()
+// light color reaching the surface scaled by n dot l, nl is returned for shadow bias
+vec3 light_diffuse(vec3 normal, vec4 light_pos, vec4 light_color, vec4 light_atten, vec4 spot_light_dir, out float nl)
 {
-    vec3 normal = normalize(v_normal);
-	vec3 to_light = u_light_pos.xyz - v_pos * u_light_pos.w;
+	vec3 to_light = light_pos.xyz - v_pos * light_pos.w;
 	vec3 light_dir = normalize(to_light);
-    float nl = max(dot(normal, light_dir), 0.0);
-	vec4 c = texture(u_texture, v_uv) * u_color;
+    nl = max(dot(normal, light_dir), 0.0);
 
 	float sqr_len = dot(to_light, to_light);
-	float atten = 1.0 - sqr_len * u_light_atten.z;
-	int light_type = int(u_light_color.a);
+	float atten = max(1.0 - sqr_len * light_atten.z, 0.0);
+	int light_type = int(light_color.a);
 	if (light_type == 1)
 	{
-		float theta = dot(light_dir, u_spot_light_dir.xyz);
-		if (theta > u_light_atten.x)
+		float theta = dot(light_dir, spot_light_dir.xyz);
+		if (theta > light_atten.x)
 		{
-			atten *= clamp((u_light_atten.x - theta) * u_light_atten.y, 0.0, 1.0);
+			atten *= clamp((light_atten.x - theta) * light_atten.y, 0.0, 1.0);
 		}
 		else
 		{
@@ -235,10 +352,41 @@ void main()
 		}
 	}
 
-	vec3 diffuse = c.rgb * nl * u_light_color.rgb * atten;
+	return nl * light_color.rgb * atten;
+}
+
+layout(location = 0) out vec4 o_color;
+void main()
+{
+#if (LOD_FADE_CROSSFADE == 1)
+	lod_fade_clip();
+#endif
+
+    vec3 normal = normalize(v_normal);
+	vec4 c = texture(u_texture, v_uv) * u_color;
+	float nl;
+
+#if (CLUSTER_LIGHTING_ON == 1)
+	vec3 diffuse = vec3(0.0);
+	uint mask = cluster_light_mask();
+	for (int i = 0; i < 32; ++i)
+	{
+		if ((mask >> uint(i)) == 0u)
+		{
+			break;
+		}
+		if ((mask & (1u << uint(i))) != 0u)
+		{
+			diffuse += light_diffuse(normal, u_cluster_light_pos[i], u_cluster_light_color[i], u_cluster_light_atten[i], u_cluster_spot_light_dir[i], nl);
+		}
+	}
+	diffuse *= c.rgb;
+#else
+	vec3 diffuse = c.rgb * light_diffuse(normal, u_light_pos, u_light_color, u_light_atten, u_spot_light_dir, nl);
+#endif
 
 #if (RECIEVE_SHADOW_ON == 1)
-	float shadow = sample_shadow(v_pos_light_proj, nl);
+	float shadow = sample_shadow(nl);
     diffuse = diffuse * (1.0 - shadow);
 #endif
 
@@ -311,6 +459,26 @@ local pass = {
 					name = "u_model_matrix",
 					size = 64,
 				},
+				{
+					name = "u_bounds_matrix",
+					size = 64,
+				},
+				{
+					name = "u_bounds_color",
+					size = 16,
+				},
+				{
+					name = "u_lightmap_scale_offset",
+					size = 16,
+				},
+				{
+					name = "u_lightmap_index",
+					size = 16,
+				},
+				{
+					name = "u_lod_fade",
+					size = 16,
+				},
 			},
 		},
         {
@@ -342,20 +510,6 @@ local pass = {
                     size = 16,
                 },
             },
-        },
-		{
-            name = "PerLightVertex",
-            binding = 5,
-            members = {
-				{
-					name = "u_light_view_matrix",
-					size = 64,
-				},
-                {
-                    name = "u_light_projection_matrix",
-                    size = 64,
-                },
-			},
         },
         {
             name = "PerLightFragment",
@@ -384,6 +538,22 @@ local pass = {
 				{
                     name = "u_shadow_params",
                     size = 16,
+                },
+				{
+                    name = "u_shadow_matrices",
+                    size = 64 * 4,
+                },
+				{
+                    name = "u_shadow_cascade_spheres",
+                    size = 16 * 4,
+                },
+				{
+                    name = "u_shadow_cascade_params",
+                    size = 16,
+                },
+				{
+                    name = "u_shadow_atlas_rects",
+                    size = 16 * 4,
                 },
             },
         },
@@ -0,0 +1,56 @@
+local vs = [[
+layout(location = 0) in vec4 i_vertex;
+void main()
+{
+	// quad on far plane covers the viewport, so depth of one atlas tile is cleared
+	gl_Position = vec4(i_vertex.xy, 1.0, 1.0);
+
+	vk_convert();
+}
+]]
+
+local fs = [[
+precision highp float;
+void main()
+{
+
+}
+]]
+
+--[[
+    Cull
+	    Back | Front | Off
+    ZTest
+	    Less | Greater | LEqual | GEqual | Equal | NotEqual | Always
+    ZWrite
+	    On | Off
+    SrcBlendMode
+	DstBlendMode
+	    One | Zero | SrcColor | SrcAlpha | DstColor | DstAlpha
+		| OneMinusSrcColor | OneMinusSrcAlpha | OneMinusDstColor | OneMinusDstAlpha
+	CWrite
+		On | Off
+	Queue
+		Background | Geometry | AlphaTest | Transparent | Overlay
+]]
+
+local rs = {
+    Cull = Off,
+    ZTest = Always,
+    ZWrite = On,
+    SrcBlendMode = One,
+    DstBlendMode = Zero,
+	CWrite = Off,
+    Queue = Overlay,
+}
+
+local pass = {
+    vs = vs,
+    fs = fs,
+    rs = rs,
+}
+
+-- return pass array
+return {
+    pass
+}
@@ -2,6 +2,9 @@ local vs = [[
 #ifndef SKIN_ON
 	#define SKIN_ON 0
 #endif
+#ifndef INSTANCING_ON
+	#define INSTANCING_ON 0
+#endif
 #ifndef BLEND_SHAPE_ON
 	#define BLEND_SHAPE_ON 0
 #endif
@@ -11,10 +14,17 @@ VK_UNIFORM_BINDING(0) uniform PerView
 	mat4 u_view_matrix;
     mat4 u_projection_matrix;
 };
-VK_UNIFORM_BINDING(1) uniform PerRenderer
-{
-	mat4 u_model_matrix;
-};
+#if (INSTANCING_ON == 1)
+	VK_UNIFORM_BINDING(1) uniform PerRenderer
+	{
+		mat4 u_model_matrices[128];
+	};
+#else
+	VK_UNIFORM_BINDING(1) uniform PerRenderer
+	{
+		mat4 u_model_matrix;
+	};
+#endif
 VK_UNIFORM_BINDING(3) uniform PerMaterialVertex
 {
 	vec4 u_texture_scale_offset;
@@ -93,6 +103,8 @@ void main()
 {
 #if (SKIN_ON == 1)
     mat4 model_matrix = skin_mat();
+#elif (INSTANCING_ON == 1)
+    mat4 model_matrix = u_model_matrices[VK_INSTANCE_INDEX];
 #else
     mat4 model_matrix = u_model_matrix;
 #endif
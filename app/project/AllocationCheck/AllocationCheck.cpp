@@ -0,0 +1,104 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "Engine.h"
+#include "Resources.h"
+#include "GameObject.h"
+#include "graphics/Camera.h"
+#include "graphics/Light.h"
+#include "graphics/MeshRenderer.h"
+#include "graphics/Texture.h"
+#include "postprocessing/Bloom.h"
+#include "time/Time.h"
+
+using namespace Viry3D;
+
+// headless check of the render loop on the noop backend, a static scene should render without allocating
+// once the first frames filled the caches, returns non zero if any frame after warm-up allocates
+static const int WarmUpFrames = 10;
+static const int CheckFrames = 60;
+
+static void InitScene()
+{
+    auto camera = GameObject::Create("camera")->AddComponent<Camera>();
+    camera->GetTransform()->SetPosition(Vector3(0, 2, -4));
+    camera->GetTransform()->SetRotation(Quaternion::Euler(15, 0, 0));
+    camera->SetCullingMask(1 << 0);
+
+    auto bloom = camera->GetGameObject()->AddComponent<Bloom>();
+    bloom->SetIntensity(1.0f);
+
+    auto light = GameObject::Create("light")->AddComponent<Light>();
+    light->GetTransform()->SetRotation(Quaternion::Euler(45, 60, 0));
+    light->SetType(LightType::Directional);
+    light->EnableShadow(true);
+    light->SetCullingMask(1 << 0);
+
+    auto material = RefMake<Material>(Shader::Find("Diffuse"));
+    material->SetTexture(MaterialProperty::TEXTURE, Texture::GetSharedWhiteTexture());
+
+    auto plane = GameObject::Create("plane")->AddComponent<MeshRenderer>();
+    plane->SetMesh(Resources::LoadMesh("Library/unity default resources.Plane.mesh"));
+    plane->SetMaterial(material);
+    plane->EnableRecieveShadow(true);
+
+    auto sphere = GameObject::Create("sphere")->AddComponent<MeshRenderer>();
+    sphere->GetTransform()->SetPosition(Vector3(0, 0.5f, 0));
+    sphere->SetMesh(Resources::LoadMesh("Library/unity default resources.Sphere.mesh"));
+    sphere->SetMaterial(material);
+    sphere->EnableCastShadow(true);
+}
+
+int main(int argc, char* argv[])
+{
+#ifdef NDEBUG
+    printf("allocation counting needs a debug build, skipped\n");
+    return 0;
+#else
+    Engine* engine = Engine::Create(nullptr, 640, 360, Engine::FLAG_NOOP_BACKEND);
+    if (engine == nullptr)
+    {
+        printf("noop engine creation FAILED\n");
+        return 1;
+    }
+
+    InitScene();
+
+    for (int i = 0; i < WarmUpFrames; ++i)
+    {
+        engine->Execute();
+    }
+
+    int failed = 0;
+    for (int i = 0; i < CheckFrames; ++i)
+    {
+        engine->Execute();
+
+        int count = Time::GetSubmitAllocCount();
+        if (count != 0)
+        {
+            printf("frame %-34d %-10d FAILED\n", WarmUpFrames + i, count);
+            failed++;
+        }
+    }
+    printf("%-40s %-10d %s\n", "frames allocating after warm-up", failed, failed == 0 ? "ok" : "FAILED");
+
+    Engine::Destroy(&engine);
+
+    return failed;
+#endif
+}
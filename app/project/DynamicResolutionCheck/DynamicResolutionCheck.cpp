@@ -0,0 +1,106 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "graphics/DynamicResolution.h"
+#include "math/Mathf.h"
+#include <stdio.h>
+
+using namespace Viry3D;
+
+// headless check of the dynamic resolution controller with synthetic frame times against the default 16.67 ms target,
+// which steps down above 16.67 ms and up below 13.33 ms, returns non zero if any case fails
+static int Check(const char* name, float result, float expected)
+{
+    bool ok = Mathf::Abs(result - expected) < 0.001f;
+    printf("%-40s %-10.2f %s\n", name, result, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static void Run(DynamicResolution& resolution, float frame_time, int frames)
+{
+    for (int i = 0; i < frames; ++i)
+    {
+        resolution.Update(frame_time);
+    }
+}
+
+// starts at scale with no frame time history
+static void StartAt(DynamicResolution& resolution, float scale)
+{
+    resolution.SetScaleRange(scale, scale);
+    resolution.SetScaleRange(0.5f, 1.0f);
+}
+
+int main(int argc, char* argv[])
+{
+    int failed = 0;
+
+    {
+        // steps down 0.1 on the first slow frame, then waits CooldownFrames before the next step
+        DynamicResolution resolution;
+        Run(resolution, 25, 1);
+        failed += Check("25 ms first frame steps down", resolution.GetScale(), 0.9f);
+        Run(resolution, 25, DynamicResolution::CooldownFrames);
+        failed += Check("25 ms holds during cooldown", resolution.GetScale(), 0.9f);
+        Run(resolution, 25, 1);
+        failed += Check("25 ms steps down after cooldown", resolution.GetScale(), 0.8f);
+        Run(resolution, 25, (DynamicResolution::CooldownFrames + 1) * 3);
+        failed += Check("25 ms reaches min scale", resolution.GetScale(), 0.5f);
+        Run(resolution, 25, 100);
+        failed += Check("25 ms stays at min scale", resolution.GetScale(), 0.5f);
+
+        Run(resolution, 10, 1000);
+        failed += Check("10 ms steps back up to max scale", resolution.GetScale(), 1.0f);
+    }
+
+    {
+        // steps up 0.05 only after up_frames fast frames in a row, counting restarts after the cooldown
+        DynamicResolution resolution;
+        StartAt(resolution, 0.5f);
+        Run(resolution, 10, 29);
+        failed += Check("10 ms holds before up_frames", resolution.GetScale(), 0.5f);
+        Run(resolution, 10, 1);
+        failed += Check("10 ms steps up at up_frames", resolution.GetScale(), 0.55f);
+        Run(resolution, 10, DynamicResolution::CooldownFrames + 29);
+        failed += Check("10 ms holds for cooldown and up_frames", resolution.GetScale(), 0.55f);
+        Run(resolution, 10, 1);
+        failed += Check("10 ms steps up again", resolution.GetScale(), 0.6f);
+    }
+
+    {
+        // a 30 ms spike lifts the smoothed time from 10 to 14 ms, between the thresholds, and restarts the count
+        DynamicResolution resolution;
+        StartAt(resolution, 0.5f);
+        Run(resolution, 10, 29);
+        Run(resolution, 30, 1);
+        failed += Check("spike in hold band does not step", resolution.GetScale(), 0.5f);
+        Run(resolution, 10, 29);
+        failed += Check("spike restarts up_frames count", resolution.GetScale(), 0.5f);
+        Run(resolution, 10, 1);
+        failed += Check("10 ms steps up after full count", resolution.GetScale(), 0.55f);
+    }
+
+    {
+        // 15 ms is below the down threshold and above the up threshold
+        DynamicResolution resolution;
+        StartAt(resolution, 0.75f);
+        Run(resolution, 15, 1000);
+        failed += Check("15 ms holds", resolution.GetScale(), 0.75f);
+    }
+
+    return failed;
+}
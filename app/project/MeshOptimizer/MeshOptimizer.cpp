@@ -0,0 +1,104 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "graphics/MeshOptimizer.h"
+#include "graphics/MeshSimplifier.h"
+
+using namespace Viry3D;
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        printf("Usage:\n");
+        printf("\tMeshOptimizer.exe [-w] input.mesh [input.mesh ...]\n");
+        printf("\treports acmr and atvr of a 16 entry fifo cache before and after optimization,\n");
+        printf("\t-w writes optimized meshes over the inputs\n");
+        return 0;
+    }
+
+    bool write = false;
+    double total_triangles = 0;
+    double total_vertices = 0;
+    double total_misses_before = 0;
+    double total_misses_after = 0;
+
+    printf("%-60s %10s %16s %16s\n", "mesh", "triangles", "acmr", "atvr");
+
+    for (int i = 1; i < argc; ++i)
+    {
+        String input = argv[i];
+        if (input == "-w")
+        {
+            write = true;
+            continue;
+        }
+
+        MeshData data;
+        if (!MeshData::LoadFromFile(input, data))
+        {
+            continue;
+        }
+
+        auto before = MeshOptimizer::AnalyzeVertexCache(data.indices, 0, data.indices.Size(), data.vertices.Size());
+        MeshOptimizer::Optimize(data);
+        auto after = MeshOptimizer::AnalyzeVertexCache(data.indices, 0, data.indices.Size(), data.vertices.Size());
+
+        int triangle_count = data.GetTriangleCount();
+        Vector<byte> used(data.vertices.Size(), 0);
+        int vertex_count = 0;
+        for (int j = 0; j < data.indices.Size(); ++j)
+        {
+            if (!used[data.indices[j]])
+            {
+                used[data.indices[j]] = 1;
+                vertex_count++;
+            }
+        }
+        total_triangles += triangle_count;
+        total_vertices += vertex_count;
+        total_misses_before += before.acmr * triangle_count;
+        total_misses_after += after.acmr * triangle_count;
+
+        printf("%-60s %10d %7.3f->%-7.3f %7.3f->%-7.3f\n",
+            input.CString(),
+            triangle_count,
+            before.acmr,
+            after.acmr,
+            before.atvr,
+            after.atvr);
+
+        if (write && !data.SaveToFile(input))
+        {
+            printf("write failed: %s\n", input.CString());
+            return 1;
+        }
+    }
+
+    if (total_triangles > 0 && total_vertices > 0)
+    {
+        printf("%-60s %10d %7.3f->%-7.3f %7.3f->%-7.3f\n",
+            "total",
+            (int) total_triangles,
+            total_misses_before / total_triangles,
+            total_misses_after / total_triangles,
+            total_misses_before / total_vertices,
+            total_misses_after / total_vertices);
+    }
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "graphics/MeshSimplifier.h"
+#include "graphics/MeshOptimizer.h"
+
+using namespace Viry3D;
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        printf("Usage:\n");
+        printf("\tMeshSimplifier.exe input.mesh ratio [ratio ...]\n");
+        printf("\twrites input_LOD1.mesh, input_LOD2.mesh ... with triangle count of input * ratio\n");
+        return 0;
+    }
+
+    String input = argv[1];
+    MeshData data;
+    if (!MeshData::LoadFromFile(input, data))
+    {
+        return 1;
+    }
+
+    String output_prefix = input;
+    if (output_prefix.EndsWith(".mesh"))
+    {
+        output_prefix = output_prefix.Substring(0, output_prefix.Size() - 5);
+    }
+
+    for (int i = 2; i < argc; ++i)
+    {
+        float ratio = String(argv[i]).To<float>();
+        MeshData lod = MeshSimplifier::Simplify(data, ratio);
+        MeshOptimizer::Optimize(lod);
+
+        String output = output_prefix + String::Format("_LOD%d.mesh", i - 1);
+        if (!lod.SaveToFile(output))
+        {
+            printf("write failed: %s\n", output.CString());
+            return 1;
+        }
+
+        printf("%s: %d -> %d triangles, %d -> %d vertices\n",
+            output.CString(),
+            data.GetTriangleCount(),
+            lod.GetTriangleCount(),
+            data.vertices.Size(),
+            lod.vertices.Size());
+    }
+
+    return 0;
+}
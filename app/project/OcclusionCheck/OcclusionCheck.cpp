@@ -0,0 +1,67 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "graphics/OcclusionBuffer.h"
+
+using namespace Viry3D;
+
+// headless check of the cpu occlusion buffer, runs without an engine so rasterization stays on the calling thread,
+// returns non zero if any case fails
+static int Check(const char* name, bool result, bool expected)
+{
+    printf("%-40s %-10s %s\n", name, result ? "visible" : "hidden", result == expected ? "ok" : "FAILED");
+    return result == expected ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+    Matrix4x4 view = Matrix4x4::LookTo(Vector3(0, 0, 0), Vector3(0, 0, 1), Vector3(0, 1, 0));
+    Matrix4x4 projection = Matrix4x4::Perspective(60, 1, 0.3f, 100);
+
+    OcclusionBuffer buffer(64, 64);
+    buffer.Clear(projection * view);
+
+    // 2 x 2 quad 2 units in front of the camera, its shadow is 10 x 10 at distance 10
+    Vector<Vector3> positions;
+    positions.Add(Vector3(-1, -1, 2));
+    positions.Add(Vector3(1, -1, 2));
+    positions.Add(Vector3(1, 1, 2));
+    positions.Add(Vector3(-1, 1, 2));
+
+    Vector<unsigned int> indices;
+    indices.Add(0);
+    indices.Add(1);
+    indices.Add(2);
+    indices.Add(0);
+    indices.Add(2);
+    indices.Add(3);
+
+    buffer.AddOccluder(positions, indices, Matrix4x4::Identity());
+    buffer.Rasterize();
+
+    int failed = 0;
+    failed += Check("far box behind quad", buffer.IsVisible(Bounds(Vector3(-0.5f, -0.5f, 9.5f), Vector3(0.5f, 0.5f, 10.5f))), false);
+    failed += Check("far box beside quad", buffer.IsVisible(Bounds(Vector3(7.5f, -0.5f, 9.5f), Vector3(8.5f, 0.5f, 10.5f))), true);
+    failed += Check("near box in front of quad", buffer.IsVisible(Bounds(Vector3(-0.1f, -0.1f, 1.0f), Vector3(0.1f, 0.1f, 1.2f))), true);
+    failed += Check("box crossing near plane", buffer.IsVisible(Bounds(Vector3(-0.1f, -0.1f, 0.1f), Vector3(0.1f, 0.1f, 0.5f))), true);
+
+    buffer.Clear(projection * view);
+    buffer.Rasterize();
+    failed += Check("far box without occluders", buffer.IsVisible(Bounds(Vector3(-0.5f, -0.5f, 9.5f), Vector3(0.5f, 0.5f, 10.5f))), true);
+
+    return failed;
+}
@@ -0,0 +1,126 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "graphics/RenderGraph.h"
+
+using namespace Viry3D;
+
+// headless check of render graph plans, graphs are only compiled so no gpu resource is touched,
+// returns non zero if any case fails
+static int Check(const char* name, int result, int expected)
+{
+    printf("%-48s %8d %s\n", name, result, result == expected ? "ok" : "FAILED");
+    return result == expected ? 0 : 1;
+}
+
+static RenderTargetKey MakeKey(int width, int height)
+{
+    RenderTargetKey key;
+    key.width = width;
+    key.height = height;
+    key.color_format = TextureFormat::R8G8B8A8;
+    key.depth_format = TextureFormat::None;
+    key.filter_mode = FilterMode::Linear;
+    key.wrap_mode = SamplerAddressMode::ClampToEdge;
+    key.flags = filament::backend::TargetBufferFlags::COLOR;
+    return key;
+}
+
+// camera target through count effects into output, each effect writes a transient target of width
+static void DeclareChain(RenderGraph& graph, const Ref<RenderTarget>& input, const Ref<RenderTarget>& output, int count, int width)
+{
+    int src = graph.ImportTarget("CameraTarget", input);
+    int final_dst = graph.ImportTarget("CameraOutput", output);
+
+    for (int i = 0; i < count; ++i)
+    {
+        int dst = i == count - 1 ? final_dst : graph.CreateTarget("PostProcessing", MakeKey(width, 720));
+        graph.AddPass("Effect", { src }, { dst }, nullptr);
+        src = dst;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    auto input = RefMake<RenderTarget>();
+    input->key = MakeKey(1280, 720);
+    auto output = RefMake<RenderTarget>();
+    output->key = MakeKey(1280, 720);
+
+    int failed = 0;
+    int frame_size = MakeKey(1280, 720).GetMemorySize();
+
+    // chain of 4 effects ping pongs between 2 physical targets
+    {
+        RenderGraph graph;
+        DeclareChain(graph, input, output, 4, 1280);
+        graph.Compile();
+
+        failed += Check("chain passes kept", (int) graph.GetPassOrder().Size(), 4);
+        failed += Check("chain physical targets", graph.GetPhysicalTargetCount(), 2);
+        failed += Check("chain transient bytes", graph.GetTransientMemorySize(), frame_size * 2);
+        failed += Check("chain unaliased bytes", graph.GetUnaliasedMemorySize(), frame_size * 3);
+    }
+
+    // a pass whose target nobody reads is culled, so is a write overwritten before any read
+    {
+        RenderGraph graph;
+        int src = graph.ImportTarget("CameraTarget", input);
+        int dst = graph.ImportTarget("CameraOutput", output);
+        int dead = graph.CreateTarget("Dead", MakeKey(64, 64));
+        int temp = graph.CreateTarget("Temp", MakeKey(1280, 720));
+        int dead_pass = graph.AddPass("Dead", { src }, { dead }, nullptr);
+        int first_write = graph.AddPass("FirstWrite", { src }, { temp }, nullptr);
+        int second_write = graph.AddPass("SecondWrite", { src }, { temp }, nullptr);
+        int read = graph.AddPass("Read", { temp }, { dst }, nullptr);
+        graph.Compile();
+
+        failed += Check("unread pass culled", graph.IsPassCulled(dead_pass) ? 1 : 0, 1);
+        failed += Check("overwritten pass culled", graph.IsPassCulled(first_write) ? 1 : 0, 1);
+        failed += Check("last write kept", graph.IsPassCulled(second_write) ? 1 : 0, 0);
+        failed += Check("read kept", graph.IsPassCulled(read) ? 1 : 0, 0);
+        failed += Check("unread target not allocated", graph.GetPhysicalTarget(dead), -1);
+        failed += Check("culled graph physical targets", graph.GetPhysicalTargetCount(), 1);
+    }
+
+    // a graph kept across frames compiles again only when its declaration changes
+    {
+        RenderGraph graph;
+        DeclareChain(graph, input, output, 3, 1280);
+        graph.Compile();
+        graph.Clear();
+
+        DeclareChain(graph, input, output, 3, 1280);
+        failed += Check("same declaration keeps plan", graph.IsCompiled() ? 1 : 0, 1);
+        failed += Check("same declaration passes", graph.GetPassCount(), 3);
+        graph.Clear();
+
+        DeclareChain(graph, input, output, 3, 640);
+        failed += Check("resized target compiles again", graph.IsCompiled() ? 1 : 0, 0);
+        graph.Compile();
+        failed += Check("resized chain transient bytes", graph.GetTransientMemorySize(), MakeKey(640, 720).GetMemorySize() * 2);
+        graph.Clear();
+
+        DeclareChain(graph, input, output, 2, 640);
+        failed += Check("removed effect compiles again", graph.IsCompiled() ? 1 : 0, 0);
+        graph.Compile();
+        failed += Check("removed effect physical targets", graph.GetPhysicalTargetCount(), 1);
+        failed += Check("removed effect pass count", graph.GetPassCount(), 2);
+    }
+
+    return failed;
+}
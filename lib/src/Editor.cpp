@@ -106,32 +106,30 @@ namespace Viry3D
                     if (!pos_in_window)
                     {
                         Ray ray = main_camera->ScreenPointToRay(pos);
-                        auto renderers = Renderer::GetRenderers();
                         Renderer* closest = nullptr;
                         float closest_length = Mathf::MaxFloatValue;
 
-                        for (auto i : renderers)
-                        {
+                        // transforms may have changed since last frame
+                        Renderer::UpdateBoundsTree();
+
+                        Renderer::GetBoundsTree().Query(ray, main_camera->GetFarClip(), [&](void* user_data) {
+                            Renderer* i = (Renderer*) user_data;
                             if (i->GetGameObject()->IsActiveInTree() && i->IsEnable())
                             {
                                 auto local_bounds = i->GetLocalBounds();
-                                if (local_bounds.GetSize().SqrMagnitude() > 0)
+                                const auto& world_to_local = i->GetTransform()->GetWorldToLocalMatrix();
+                                Ray ray_in_local(world_to_local.MultiplyPoint3x4(ray.GetOrigin()), world_to_local.MultiplyDirection(ray.GetDirection()));
+                                float ray_length = main_camera->GetFarClip();
+                                if (Mathf::RayBoundsIntersection(ray_in_local, local_bounds, ray_length))
                                 {
-                                    const auto& world_to_local = i->GetTransform()->GetWorldToLocalMatrix();
-                                    Ray ray_in_local(world_to_local.MultiplyPoint3x4(ray.GetOrigin()), world_to_local.MultiplyDirection(ray.GetDirection()));
-                                    float ray_length = main_camera->GetFarClip();
-                                    if (Mathf::RayBoundsIntersection(ray_in_local, local_bounds, ray_length))
+                                    if (ray_length < closest_length)
                                     {
-                                        auto hit = ray.GetPoint(ray_length);
-                                        if (ray_length < closest_length)
-                                        {
-                                            closest = i;
-                                            closest_length = ray_length;
-                                        }
+                                        closest = i;
+                                        closest_length = ray_length;
                                     }
                                 }
                             }
-                        }
+                        });
 
                         if (closest)
                         {
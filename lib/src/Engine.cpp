@@ -31,6 +31,8 @@
 #include "graphics/Camera.h"
 #include "graphics/Light.h"
 #include "graphics/Renderer.h"
+#include "graphics/Graphics.h"
+#include "graphics/ShadowAtlas.h"
 #include "ui/Font.h"
 #include "audio/AudioManager.h"
 #include "time/Time.h"
@@ -103,6 +105,9 @@ namespace Viry3D
         Map<int, List<MessageHandler>> m_message_handlers;
         Mutex m_mutex;
         Ref<Editor> m_editor;
+        std::chrono::steady_clock::time_point m_frame_begin_time;
+        bool m_frame_begun = false;
+        int m_submit_alloc_count = 0;
         
 		EnginePrivate(Engine* engine, void* native_window, int width, int height, uint64_t flags, void* shared_gl_context):
 			m_engine(engine),
@@ -124,8 +129,13 @@ namespace Viry3D
 			m_native_window(native_window),
 			m_width(width),
 			m_height(height),
-			m_window_flags(flags)
+			m_window_flags(flags & ~Engine::FLAG_NOOP_BACKEND)
 		{
+			if (flags & Engine::FLAG_NOOP_BACKEND)
+			{
+				m_backend = backend::Backend::NOOP;
+			}
+
             m_editor = RefMake<Editor>();
 		}
 
@@ -177,6 +187,9 @@ namespace Viry3D
 			Font::Done();
 			Mesh::Done();
             Material::Done();
+			Renderer::Done();
+			Graphics::Done();
+			ShadowAtlas::Done();
 			Camera::Done();
 			RenderTarget::Done();
             Texture::Done();
@@ -260,6 +273,17 @@ namespace Viry3D
 		{
             Time::Update();
             this->ProcessActions();
+
+			// last frame interval includes waiting in EndFrame for the driver thread to execute and present the frame,
+			// so it grows with render resolution when gpu bound, the main thread recording time alone does not
+			auto frame_begin_time = std::chrono::steady_clock::now();
+			auto& dynamic_resolution = Camera::GetDynamicResolution();
+			if (m_frame_begun && dynamic_resolution.IsAutoUpdateEnable())
+			{
+				dynamic_resolution.Update(std::chrono::duration<float, std::milli>(frame_begin_time - m_frame_begin_time).count());
+			}
+			m_frame_begin_time = frame_begin_time;
+			m_frame_begun = true;
             
 			++m_frame_id;
 
@@ -273,9 +297,37 @@ namespace Viry3D
 		void Render()
 		{
 			Time::SetDrawCall(0);
+			Time::SetSkippedStateChange(0);
+
 			Renderer::PrepareAll();
+
+#ifndef NDEBUG
+			int alloc_count = Memory::GetAllocCount();
+			int alloc_size = Memory::GetAllocSize() + Memory::GetNewSize();
+#endif
+
 			Light::RenderShadowMaps();
 			Camera::RenderAll();
+
+#ifndef NDEBUG
+			// shadow and camera submission should not allocate once caches are warm, log when the count changes
+			// so a regression shows up once instead of every frame, allocations of worker threads are counted too
+			int submit_alloc_count = Memory::GetAllocCount() - alloc_count;
+			Time::SetSubmitAllocCount(submit_alloc_count);
+			if (submit_alloc_count != m_submit_alloc_count)
+			{
+				m_submit_alloc_count = submit_alloc_count;
+				if (submit_alloc_count > 0)
+				{
+					Log("frame %d submission allocated %d times, live memory changed %d bytes",
+						m_frame_id,
+						submit_alloc_count,
+						Memory::GetAllocSize() + Memory::GetNewSize() - alloc_size);
+				}
+			}
+#endif
+			Graphics::EndFrame();
+			RenderTarget::EndFrame();
 			this->Flush();
 		}
 
@@ -525,7 +577,7 @@ namespace Viry3D
 			m_native_window = native_window;
 			m_width = width;
 			m_height = height;
-			m_window_flags = flags;
+			m_window_flags = flags & ~Engine::FLAG_NOOP_BACKEND;
 
 			m_swap_chain = this->GetDriverApi().createSwapChain(m_native_window, m_window_flags);
 			m_render_target = this->GetDriverApi().createDefaultRenderTarget();
@@ -44,6 +44,9 @@ namespace Viry3D
     class Engine
     {
 	public:
+		// creates the engine on the noop backend, nothing is drawn, for headless checks of the render loop
+		static constexpr uint64_t FLAG_NOOP_BACKEND = 1ull << 63;
+
 		static Engine* Create(void* native_window, int width, int height, uint64_t flags = 0, void* shared_gl_context = nullptr);
 		static void Destroy(Engine** engine);
 		static Engine* Instance();
@@ -33,6 +33,8 @@ namespace Viry3D
         template <class T, typename ...ARGS> Ref<T> AddComponent(ARGS... args);
         template <class T> Ref<T> GetComponent() const;
 		template <class T> Vector<Ref<T>> GetComponents() const;
+		// appends to coms, keeps its capacity for callers that query every frame
+		template <class T> void GetComponents(Vector<Ref<T>>& coms) const;
 		template <class T> Vector<Ref<T>> GetComponentsInChildren() const;
         void RemoveComponent(const Ref<Component>& com);
         const Ref<Transform>& GetTransform() const { return m_transform; }
@@ -110,7 +112,14 @@ namespace Viry3D
 	Vector<Ref<T>> GameObject::GetComponents() const
 	{
 		Vector<Ref<T>> coms;
+		this->GetComponents<T>(coms);
 
+		return coms;
+	}
+
+	template <class T>
+	void GameObject::GetComponents(Vector<Ref<T>>& coms) const
+	{
 		for (int i = 0; i < m_added_components.Size(); ++i)
 		{
 			auto& com = m_added_components[i];
@@ -130,8 +139,6 @@ namespace Viry3D
 				coms.Add(t);
 			}
 		}
-
-		return coms;
 	}
 
 	template <class T>
@@ -26,6 +26,7 @@
 #include "graphics/Shader.h"
 #include "graphics/Image.h"
 #include "graphics/Texture.h"
+#include "graphics/LODGroup.h"
 #include "animation/Animation.h"
 #include "json/json.h"
 #include "physics/SpringBone.h"
@@ -468,6 +469,12 @@ namespace Viry3D
 		{
 			auto mesh = ReadMesh(mesh_path);
 			renderer->SetMesh(mesh);
+
+			// shadow passes of casters read only positions
+			if (mesh && renderer->IsCastShadow())
+			{
+				mesh->EnableDepthStream(true);
+			}
 		}
     }
 
@@ -615,6 +622,59 @@ namespace Viry3D
         }
     }
 
+    // renderer paths are relative to the lod group, "." is the group itself
+    static void ReadLODGroup(MemoryStream& ms, Vector<LOD>& lods, Vector<Vector<String>>& renderer_paths, bool& cross_fade)
+    {
+        int lod_count = ms.Read<int>();
+        lods.Resize(lod_count);
+        renderer_paths.Resize(lod_count);
+        for (int i = 0; i < lod_count; ++i)
+        {
+            lods[i].screen_relative_height = ms.Read<float>();
+            lods[i].fade_transition_width = ms.Read<float>();
+            int renderer_count = ms.Read<int>();
+            renderer_paths[i].Resize(renderer_count);
+            for (int j = 0; j < renderer_count; ++j)
+            {
+                renderer_paths[i][j] = ReadString(ms);
+            }
+        }
+        cross_fade = ms.Read<byte>() == 1;
+    }
+
+    static void ResolveLODGroup(const Ref<LODGroup>& lod_group, Vector<LOD>& lods, const Vector<Vector<String>>& renderer_paths, bool cross_fade)
+    {
+        const auto& transform = lod_group->GetTransform();
+        for (int i = 0; i < lods.Size(); ++i)
+        {
+            for (int j = 0; j < renderer_paths[i].Size(); ++j)
+            {
+                const String& path = renderer_paths[i][j];
+                Ref<Transform> target;
+                if (path == ".")
+                {
+                    target = transform;
+                }
+                else if (path.Size() > 0)
+                {
+                    target = transform->Find(path);
+                }
+
+                if (target)
+                {
+                    auto renderer = target->GetGameObject()->GetComponent<Renderer>();
+                    if (renderer)
+                    {
+                        lods[i].renderers.Add(renderer);
+                    }
+                }
+            }
+        }
+
+        lod_group->SetLODs(lods);
+        lod_group->EnableCrossFade(cross_fade);
+    }
+
     static Ref<GameObject> ReadGameObject(MemoryStream& ms, const Ref<GameObject>& parent)
     {
         String name = ReadString(ms);
@@ -636,6 +696,11 @@ namespace Viry3D
 		obj->GetTransform()->SetLocalRotation(local_rot);
 		obj->GetTransform()->SetLocalScale(local_scale);
 
+        Ref<LODGroup> lod_group;
+        Vector<LOD> lods;
+        Vector<Vector<String>> lod_renderer_paths;
+        bool lod_cross_fade = false;
+
         int com_count = ms.Read<int>();
         for (int i = 0; i < com_count; ++i)
         {
@@ -680,6 +745,11 @@ namespace Viry3D
                 auto com = obj->AddComponent<SpringManager>();
                 ReadSpringManager(ms, com);
             }
+            else if (com_name == "LODGroup")
+            {
+                lod_group = obj->AddComponent<LODGroup>();
+                ReadLODGroup(ms, lods, lod_renderer_paths, lod_cross_fade);
+            }
         }
 
 		int child_count = ms.Read<int>();
@@ -688,6 +758,12 @@ namespace Viry3D
 			ReadGameObject(ms, obj);
 		}
 
+        // lod renderers are usually children
+        if (lod_group)
+        {
+            ResolveLODGroup(lod_group, lods, lod_renderer_paths, lod_cross_fade);
+        }
+
         return obj;
     }
 
@@ -0,0 +1,92 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Vector.h"
+#include <stdint.h>
+
+namespace Viry3D
+{
+	class RadixSort
+	{
+	public:
+		// stable lsd radix sort by V::key (uint64_t) in ascending order,
+		// temp is scratch storage which can be reused between calls
+		template<class V>
+		static void Sort(Vector<V>& items, Vector<V>& temp);
+	};
+
+	template<class V>
+	void RadixSort::Sort(Vector<V>& items, Vector<V>& temp)
+	{
+		int count = items.Size();
+		if (count < 2)
+		{
+			return;
+		}
+
+		if (temp.Size() < count)
+		{
+			temp.Resize(count);
+		}
+
+		V* src = &items[0];
+		V* dst = &temp[0];
+
+		for (int shift = 0; shift < 64; shift += 8)
+		{
+			int offsets[256] = { 0 };
+
+			for (int i = 0; i < count; ++i)
+			{
+				offsets[(src[i].key >> shift) & 0xff]++;
+			}
+
+			// all keys share this digit, nothing to move
+			if (offsets[(src[0].key >> shift) & 0xff] == count)
+			{
+				continue;
+			}
+
+			int sum = 0;
+			for (int i = 0; i < 256; ++i)
+			{
+				int c = offsets[i];
+				offsets[i] = sum;
+				sum += c;
+			}
+
+			for (int i = 0; i < count; ++i)
+			{
+				dst[offsets[(src[i].key >> shift) & 0xff]++] = src[i];
+			}
+
+			V* swap = src;
+			src = dst;
+			dst = swap;
+		}
+
+		if (src != &items[0])
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				items[i] = src[i];
+			}
+		}
+	}
+}
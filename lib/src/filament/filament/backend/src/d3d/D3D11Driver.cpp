@@ -845,6 +845,11 @@ namespace filament
 		}
 
 		void D3D11Driver::draw(backend::PipelineState ps, Handle<HwRenderPrimitive> rph)
+		{
+			this->drawInstanced(ps, rph, 1);
+		}
+
+		void D3D11Driver::drawInstanced(backend::PipelineState ps, Handle<HwRenderPrimitive> rph, uint32_t instanceCount)
 		{
 			auto program = handle_cast<D3D11Program>(m_handle_map, ps.program);
 			auto primitive = handle_cast<D3D11RenderPrimitive>(m_handle_map, rph);
@@ -857,9 +862,17 @@ namespace filament
 
 				for (size_t i = 0; i < m_context->uniform_buffer_bindings.size(); ++i)
 				{
-					if (m_context->uniform_buffer_bindings[i].buffer)
+					const auto& binding = m_context->uniform_buffer_bindings[i];
+					if (binding.buffer && binding.offset > 0)
 					{
-						m_context->context->VSSetConstantBuffers((UINT) i, 1, &m_context->uniform_buffer_bindings[i].buffer);
+						// offset and count are in 16 byte constants, both must be multiples of 16 constants
+						UINT first_constant = (UINT) (binding.offset / 16);
+						UINT constant_count = (UINT) ((binding.size + 255) / 256 * 16);
+						m_context->context->VSSetConstantBuffers1((UINT) i, 1, &binding.buffer, &first_constant, &constant_count);
+					}
+					else if (binding.buffer)
+					{
+						m_context->context->VSSetConstantBuffers((UINT) i, 1, &binding.buffer);
 					}
 					else
 					{
@@ -903,9 +916,17 @@ namespace filament
 
 				for (size_t i = 0; i < m_context->uniform_buffer_bindings.size(); ++i)
 				{
-					if (m_context->uniform_buffer_bindings[i].buffer)
+					const auto& binding = m_context->uniform_buffer_bindings[i];
+					if (binding.buffer && binding.offset > 0)
+					{
+						// offset and count are in 16 byte constants, both must be multiples of 16 constants
+						UINT first_constant = (UINT) (binding.offset / 16);
+						UINT constant_count = (UINT) ((binding.size + 255) / 256 * 16);
+						m_context->context->PSSetConstantBuffers1((UINT) i, 1, &binding.buffer, &first_constant, &constant_count);
+					}
+					else if (binding.buffer)
 					{
-						m_context->context->PSSetConstantBuffers((UINT) i, 1, &m_context->uniform_buffer_bindings[i].buffer);
+						m_context->context->PSSetConstantBuffers((UINT) i, 1, &binding.buffer);
 					}
 					else
 					{
@@ -1035,7 +1056,14 @@ namespace filament
 			}
 			m_context->context->IASetInputLayout(program->input_layout);
 
-			m_context->context->DrawIndexed(primitive->count, primitive->offset, 0);
+			if (instanceCount > 1)
+			{
+				m_context->context->DrawIndexedInstanced(primitive->count, instanceCount, primitive->offset, 0, 0);
+			}
+			else
+			{
+				m_context->context->DrawIndexed(primitive->count, primitive->offset, 0);
+			}
 		}
 	}
 }
@@ -845,6 +845,11 @@ void MetalDriver::blit(TargetBufferFlags buffers,
 }
 
 void MetalDriver::draw(backend::PipelineState ps, Handle<HwRenderPrimitive> rph) {
+    drawInstanced(ps, rph, 1);
+}
+
+void MetalDriver::drawInstanced(backend::PipelineState ps, Handle<HwRenderPrimitive> rph,
+        uint32_t instanceCount) {
     ASSERT_PRECONDITION(mContext->currentCommandEncoder != nullptr,
             "Attempted to draw without a valid command encoder.");
     auto primitive = handle_cast<MetalRenderPrimitive>(mHandleMap, rph);
@@ -995,7 +1000,8 @@ void MetalDriver::draw(backend::PipelineState ps, Handle<HwRenderPrimitive> rph)
                                               indexCount:primitive->count
                                                indexType:getIndexType(indexBuffer->elementSize)
                                              indexBuffer:indexBuffer->buffer
-                                       indexBufferOffset:primitive->offset];
+                                       indexBufferOffset:primitive->offset
+                                           instanceCount:instanceCount];
 }
 
 void MetalDriver::enumerateSamplerGroups(
@@ -3239,8 +3239,8 @@ void OpenGLDriver::bindUniformBufferRange(size_t index, Handle<HwUniformBuffer>
     if (this->getShaderModel() >= backend::ShaderModel::GL_ES_30)
     {
         GLUniformBuffer* ub = handle_cast<GLUniformBuffer*>(ubh);
-        // TODO: Is this assert really needed? Note that size is only populated for STREAM buffers.
-        assert(size <= ub->gl.ubo.size);
+        // size is only populated for STREAM buffers, check against capacity instead
+        assert(size <= ub->gl.ubo.capacity);
         assert(ub->gl.ubo.base + offset + size <= ub->gl.ubo.capacity);
         bindBufferRange(GL_UNIFORM_BUFFER, GLuint(index), ub->gl.ubo.id, ub->gl.ubo.base + offset, size);
     }
@@ -3616,6 +3616,10 @@ void OpenGLDriver::updateTextureLodRange(GLTexture* texture, int8_t targetLevel)
 }
 
 void OpenGLDriver::draw(PipelineState state, Handle<HwRenderPrimitive> rph) {
+    drawInstanced(state, rph, 1);
+}
+
+void OpenGLDriver::drawInstanced(PipelineState state, Handle<HwRenderPrimitive> rph, uint32_t instanceCount) {
     DEBUG_MARKER()
 	CHECK_GL_ERROR(utils::slog.e)
 
@@ -3647,8 +3651,15 @@ void OpenGLDriver::draw(PipelineState state, Handle<HwRenderPrimitive> rph) {
 
     if (this->getShaderModel() == backend::ShaderModel::GL_ES_20)
     {
+        // no instancing in es 2.0
+        assert(instanceCount == 1);
         glDrawElements(GLenum(rp->type), rp->count, rp->gl.indicesType, (const void*) (size_t) rp->offset);
     }
+    else if (instanceCount > 1)
+    {
+        glDrawElementsInstanced(GLenum(rp->type), rp->count, rp->gl.indicesType,
+                                (const void*) (size_t) rp->offset, instanceCount);
+    }
     else if (this->getShaderModel() >= backend::ShaderModel::GL_ES_30)
     {
         glDrawRangeElements(GLenum(rp->type), rp->minIndex, rp->maxIndex, rp->count,
@@ -24,9 +24,17 @@
 #include "Renderer.h"
 #include "Material.h"
 #include "SkinnedMeshRenderer.h"
+#include "MeshRenderer.h"
 #include "Light.h"
+#include "StaticBatching.h"
+#include "LODGroup.h"
+#include "RenderGraph.h"
 #include "time/Time.h"
+#include "math/Frustum.h"
+#include "container/RadixSort.h"
 #include "postprocessing/PostProcessing.h"
+#include <algorithm>
+#include <typeinfo>
 
 namespace Viry3D
 {
@@ -36,6 +44,8 @@ namespace Viry3D
 	bool Camera::m_cameras_order_dirty = false;
 	Ref<Mesh> Camera::m_quad_mesh;
 	Ref<Material> Camera::m_blit_material;
+	Ref<Shader> Camera::m_depth_shaders[4];
+	DynamicResolution Camera::m_dynamic_resolution;
 
 	void Camera::Init()
 	{
@@ -46,6 +56,10 @@ namespace Viry3D
 	{
 		m_quad_mesh.reset();
 		m_blit_material.reset();
+		for (int i = 0; i < 4; ++i)
+		{
+			m_depth_shaders[i].reset();
+		}
 	}
 
 	void Camera::RenderAll()
@@ -67,16 +81,36 @@ namespace Viry3D
 			});
 		}
 
+		// only the last culled camera is shared, lod selection and fade uniforms of renderers still belong to its view
+		Camera* culled_camera = nullptr;
+
 		for (auto i : m_cameras)
 		{
 			if (i->GetGameObject()->IsActiveInTree() && i->IsEnable())
 			{
 				m_current_camera = i;
 
-				List<Renderer*> renderers;
-				i->CullRenderers(Renderer::GetRenderers(), renderers);
+				i->m_culling_shared = culled_camera && i->IsCullingCompatible(culled_camera);
+
+				if (i->m_culling_shared)
+				{
+					i->m_tested_renderer_count = culled_camera->m_tested_renderer_count;
+					i->m_culled_renderer_count = culled_camera->m_culled_renderer_count;
+					i->m_drawn_renderer_count = culled_camera->m_drawn_renderer_count;
+					i->m_occluded_renderer_count = culled_camera->m_occluded_renderer_count;
+					i->m_draw_items.Clear();
+					i->m_draw_batches.Clear();
+				}
+				else
+				{
+					i->CullRenderers(i->m_draw_items);
+					i->BatchRenderers(i->m_draw_items, i->m_draw_batches);
+					culled_camera = i;
+				}
+
 				i->UpdateViewUniforms();
-				i->Draw(renderers);
+				i->UpdateLightUniforms();
+				i->Draw(culled_camera->m_draw_items, culled_camera->m_draw_batches);
 				i->PostProcessing();
 
 				m_current_camera = nullptr;
@@ -103,45 +137,212 @@ namespace Viry3D
         m_projection_matrix_dirty = true;
     }
 
-    void Camera::CullRenderers(const List<Renderer*>& renderers, List<Renderer*>& result)
+    void Camera::CullRenderers(Vector<DrawItem>& result)
     {
-        for (auto i : renderers)
+		// renderers created or enabled after PrepareAll, uniforms are flushed below
+		Renderer::UpdateBoundsTree();
+
+		const Matrix4x4& view = this->GetViewMatrix();
+		Frustum frustum(this->GetProjectionMatrix() * view);
+		float inv_far = 1.0f / m_far_clip;
+
+		result.Clear();
+
+		m_tested_renderer_count = 0;
+		m_culled_renderer_count = 0;
+		m_drawn_renderer_count = 0;
+		m_occluded_renderer_count = 0;
+
+		auto is_visible = [this](Renderer* renderer) {
+			int layer = renderer->GetGameObject()->GetLayer();
+			return renderer->GetGameObject()->IsActiveInTree() && renderer->IsEnable() && ((1 << layer) & m_culling_mask) != 0;
+		};
+		// level of lod group is selected from this camera on first renderer of the group
+		auto is_lod_visible = [this](Renderer* renderer) {
+			LODGroup* lod_group = renderer->GetLODGroup();
+			return lod_group == nullptr || lod_group->IsRendererVisible(renderer, this);
+		};
+
+		// renderer without bounds is always visible
+		const auto& unbounded_renderers = Renderer::GetUnboundedRenderers();
+		for (auto i : unbounded_renderers)
+		{
+			if (is_visible(i) && is_lod_visible(i))
+			{
+				float depth = -view.MultiplyPoint3x4(i->GetTransform()->GetPosition()).z * inv_far;
+				result.Add({ i->GetSortKey(depth), i });
+				m_drawn_renderer_count++;
+			}
+		}
+
+		int bounded_first = result.Size();
+
+		Renderer::GetBoundsTree().Query(frustum, [&](void* user_data, bool inside) {
+			Renderer* i = (Renderer*) user_data;
+			if (is_visible(i))
+			{
+				m_tested_renderer_count++;
+
+				// tree stores fat bounds, recheck exact bounds when not fully inside
+				if (!inside && frustum.ContainsBounds(i->GetWorldBounds()) == ContainsResult::Out)
+				{
+					m_culled_renderer_count++;
+					return;
+				}
+
+				if (!is_lod_visible(i))
+				{
+					m_culled_renderer_count++;
+					return;
+				}
+
+				float depth = -view.MultiplyPoint3x4(i->GetWorldBounds().GetCenter()).z * inv_far;
+				result.Add({ i->GetSortKey(depth), i });
+				m_drawn_renderer_count++;
+			}
+		});
+
+		if (m_occlusion_culling)
+		{
+			this->CullOccludedRenderers(result, bounded_first);
+		}
+
+		// lod fade changed by level selection
+		Renderer::FlushUniforms();
+
+		RadixSort::Sort(result, m_sort_items);
+    }
+
+	bool Camera::IsCullingCompatible(Camera* camera)
+	{
+		return m_culling_mask == camera->m_culling_mask &&
+			m_occlusion_culling == camera->m_occlusion_culling &&
+			m_far_clip == camera->m_far_clip &&
+			Memory::Compare(&this->GetViewMatrix(), &camera->GetViewMatrix(), sizeof(Matrix4x4)) == 0 &&
+			Memory::Compare(&this->GetProjectionMatrix(), &camera->GetProjectionMatrix(), sizeof(Matrix4x4)) == 0;
+	}
+
+	void Camera::EnableOcclusionCulling(bool enable)
+	{
+		m_occlusion_culling = enable;
+		if (!m_occlusion_culling)
+		{
+			m_occlusion_buffer.reset();
+			m_occluders.Clear();
+		}
+	}
+
+	void Camera::CullOccludedRenderers(Vector<DrawItem>& result, int first)
+	{
+		if (!m_occlusion_buffer)
+		{
+			m_occlusion_buffer = RefMake<OcclusionBuffer>();
+		}
+
+		// occluders in view, nearest first so the triangle budget goes to the ones hiding most
+		m_occluders.Clear();
+		for (int i = first; i < result.Size(); ++i)
+		{
+			Renderer* renderer = result[i].renderer;
+			if (renderer->IsOccluder() && typeid(*renderer) == typeid(MeshRenderer) && ((MeshRenderer*) renderer)->GetMesh())
+			{
+				m_occluders.Add(renderer);
+			}
+		}
+		if (m_occluders.Empty())
+		{
+			return;
+		}
+
+		const Matrix4x4& view = this->GetViewMatrix();
+		std::sort(&m_occluders[0], &m_occluders[0] + m_occluders.Size(), [&](Renderer* a, Renderer* b) {
+			return view.MultiplyPoint3x4(a->GetWorldBounds().GetCenter()).z > view.MultiplyPoint3x4(b->GetWorldBounds().GetCenter()).z;
+		});
+
+		m_occlusion_buffer->Clear(this->GetProjectionMatrix() * view);
+		for (int i = 0; i < m_occluders.Size(); ++i)
+		{
+			MeshRenderer* renderer = (MeshRenderer*) m_occluders[i];
+			if (!m_occlusion_buffer->AddOccluder(renderer->GetMesh(), renderer->GetTransform()->GetLocalToWorldMatrix()))
+			{
+				break;
+			}
+		}
+		m_occlusion_buffer->Rasterize();
+
+		// compact visible items in place, renderers without bounds before first are always kept
+		int count = first;
+		for (int i = first; i < result.Size(); ++i)
+		{
+			Renderer* renderer = result[i].renderer;
+			if (renderer->IsOccluder() || m_occlusion_buffer->IsVisible(renderer->GetWorldBounds()))
+			{
+				result[count++] = result[i];
+			}
+			else
+			{
+				m_occluded_renderer_count++;
+				m_culled_renderer_count++;
+				m_drawn_renderer_count--;
+			}
+		}
+		result.Resize(count);
+	}
+
+    void Camera::BatchRenderers(const Vector<DrawItem>& items, Vector<DrawBatch>& batches)
+    {
+        batches.Clear();
+
+        // editor draws bounds per renderer
+        bool batching = !Engine::Instance()->GetEditor()->IsInEditorMode();
+
+        int i = 0;
+        while (i < items.Size())
         {
-            int layer = i->GetGameObject()->GetLayer();
-            if (i->GetGameObject()->IsActiveInTree() && i->IsEnable() && ((1 << layer) & m_culling_mask) != 0)
+            Renderer* renderer = items[i].renderer;
+
+            // same mesh and materials are adjacent after sorting
+            int count = 1;
+            bool instancing = false;
+            if (batching && renderer->IsInstancingEnable())
             {
-                result.AddLast(i);
+                while (i + count < items.Size() &&
+                    count < Graphics::MaxInstanceCount &&
+                    renderer->IsInstancingCompatible(items[i + count].renderer))
+                {
+                    count++;
+                }
+                instancing = true;
             }
-        }
-        result.Sort([](Renderer* a, Renderer* b) {
-            const auto& materials_a = a->GetMaterials();
-            int queue_a = 0;
-            for (int i = 0; i < materials_a.Size(); ++i)
+            else if (batching && renderer->GetStaticBatch())
             {
-				if (materials_a[i])
-				{
-					int queue = materials_a[i]->GetQueue();
-					if (queue_a < queue)
-					{
-						queue_a = queue;
-					}
-				}
+                // static batch members share materials, keywords and layer, but shadow flags may change after combining
+                while (i + count < items.Size() &&
+                    items[i + count].renderer->GetStaticBatch() == renderer->GetStaticBatch() &&
+                    items[i + count].renderer->IsRecieveShadow() == renderer->IsRecieveShadow())
+                {
+                    count++;
+                }
             }
-            const auto& materials_b = b->GetMaterials();
-            int queue_b = 0;
-            for (int i = 0; i < materials_b.Size(); ++i)
+
+            DrawBatch batch;
+            batch.first = i;
+            batch.count = count;
+            batch.instance_slot = -1;
+
+            if (instancing && count > 1)
             {
-				if (materials_b[i])
-				{
-					int queue = materials_b[i]->GetQueue();
-					if (queue_b < queue)
-					{
-						queue_b = queue;
-					}
-				}
+                m_instance_matrices.Clear();
+                for (int j = 0; j < count; ++j)
+                {
+                    m_instance_matrices.Add(items[i + j].renderer->GetRendererUniforms().model_matrix);
+                }
+                batch.instance_slot = Graphics::AllocateInstances(&m_instance_matrices[0], count);
             }
-            return queue_a < queue_b;
-        });
+
+            batches.Add(batch);
+            i += count;
+        }
     }
 
 	void Camera::UpdateViewUniforms()
@@ -169,13 +370,61 @@ namespace Viry3D
 		driver.loadUniformBuffer(m_view_uniform_buffer, filament::backend::BufferDescriptor(buffer, sizeof(ViewUniforms)));
 	}
 
-	void Camera::Draw(const List<Renderer*>& renderers)
+	void Camera::EnableClusterLighting(bool enable)
+	{
+		m_cluster_lighting = enable;
+	}
+
+	void Camera::SetDepthPrepass(bool enable)
+	{
+		m_depth_prepass = enable;
+	}
+
+	void Camera::UpdateLightUniforms()
+	{
+		auto& driver = Engine::Instance()->GetDriverApi();
+		if (!m_ambient_uniform_buffer)
+		{
+			m_ambient_uniform_buffer = driver.createUniformBuffer(sizeof(LightFragmentUniforms), filament::backend::BufferUsage::DYNAMIC);
+		}
+
+		// ambient only lighting for renderers no light reaches
+		LightFragmentUniforms ambient_uniforms;
+		Memory::Zero(&ambient_uniforms, sizeof(ambient_uniforms));
+		ambient_uniforms.ambient_color = Light::GetAmbientColor();
+		ambient_uniforms.light_pos = Vector4(0, 0, 1, 0);
+
+		void* buffer = driver.allocate(sizeof(LightFragmentUniforms));
+		Memory::Copy(buffer, &ambient_uniforms, sizeof(LightFragmentUniforms));
+		driver.loadUniformBuffer(m_ambient_uniform_buffer, filament::backend::BufferDescriptor(buffer, sizeof(LightFragmentUniforms)));
+
+		m_cluster_lighting_active = m_cluster_lighting && LightClusters::IsSupported();
+
+		if (m_cluster_lighting_active)
+		{
+			m_light_clusters.Update(this->GetViewMatrix(), this->GetProjectionMatrix(), m_near_clip, m_far_clip, m_culling_mask);
+		}
+	}
+
+	void Camera::Draw(const Vector<DrawItem>& items, const Vector<DrawBatch>& batches)
 	{
 		auto& driver = Engine::Instance()->GetDriverApi();
 
 		int target_width = this->GetTargetWidth();
 		int target_height = this->GetTargetHeight();
-		bool has_post_processing = this->HasPostProcessing();
+
+		// scaled frames go through post processing, which upscales them in its last pass
+		float scale = m_dynamic_resolution.GetScale();
+		m_dynamic_resolution_active = m_dynamic_resolution_enable && scale < 1.0f && (m_render_target_color || !m_render_target_depth);
+		if (m_dynamic_resolution_active)
+		{
+			target_width = Mathf::Max(Mathf::RoundToInt(target_width * scale), 1);
+			target_height = Mathf::Max(Mathf::RoundToInt(target_height * scale), 1);
+		}
+		m_render_width = target_width;
+		m_render_height = target_height;
+
+		bool has_post_processing = this->HasPostProcessing() || m_dynamic_resolution_active;
 
 		filament::backend::RenderTargetHandle target;
 		filament::backend::RenderPassParams params;
@@ -205,8 +454,8 @@ namespace Viry3D
 
 				m_render_target = driver.createRenderTarget(
 					target_flags,
-					target_width,
-					target_height,
+					this->GetTargetWidth(),
+					this->GetTargetHeight(),
 					1,
 					color,
 					depth,
@@ -224,7 +473,7 @@ namespace Viry3D
 				if (m_render_target_color)
 				{
 					target_flags |= filament::backend::TargetBufferFlags::COLOR;
-					color_format = m_render_target_color->GetFormat();
+					color_format = m_hdr ? Texture::SelectHDRFormat(true) : m_render_target_color->GetFormat();
 				}
 				if (m_render_target_depth)
 				{
@@ -292,10 +541,11 @@ namespace Viry3D
 		{
 			if (has_post_processing)
 			{
+				// screen output has no use for alpha
 				m_post_processing_target = RenderTarget::GetTemporaryRenderTarget(
 					target_width,
 					target_height,
-					TextureFormat::R8G8B8A8,
+					m_hdr ? Texture::SelectHDRFormat(false) : TextureFormat::R8G8B8A8,
 					Texture::SelectDepthFormat(),
 					FilterMode::Linear,
 					SamplerAddressMode::ClampToEdge,
@@ -334,13 +584,59 @@ namespace Viry3D
 		params.viewport.height = (uint32_t) (m_viewport_rect.h * target_height);
 		params.clearColor = filament::math::float4(m_clear_color.r, m_clear_color.g, m_clear_color.b, m_clear_color.a);
 
+		// instance data can not be loaded inside render pass
+		Graphics::FlushInstances();
+
+		// prepass needs a depth buffer to fill
+		bool has_depth = m_render_target_depth || !m_render_target_color;
+		m_depth_prepass_active = m_depth_prepass && has_depth &&
+			!(Engine::Instance()->GetBackend() == filament::backend::Backend::OPENGL &&
+			Engine::Instance()->GetShaderModel() == filament::backend::ShaderModel::GL_ES_20);
+		m_depth_prepass_draw_count = 0;
+		m_depth_tested_draw_count = 0;
+		m_opaque_draw_count = 0;
+
 		driver.beginRenderPass(target, params);
 
-		driver.bindUniformBuffer((size_t) Shader::BindingPoint::PerView, m_view_uniform_buffer);
+		m_render_state.Reset();
+		m_render_state.BindUniformBuffer((size_t) Shader::BindingPoint::PerView, m_view_uniform_buffer);
+
+		if (m_depth_prepass_active)
+		{
+			this->DrawDepthPrepass(items, batches);
+		}
+
+        // explicit instanced draws go between opaque and transparent renderers
+        bool instanced_draws_done = false;
+
+        for (int i = 0; i < batches.Size(); ++i)
+        {
+            const auto& batch = batches[i];
+            Renderer* renderer = items[batch.first].renderer;
+
+            if (!instanced_draws_done && renderer->GetQueue() > (int) Shader::Queue::AlphaTest)
+            {
+                this->DrawInstancedDraws();
+                instanced_draws_done = true;
+            }
+
+            if (batch.instance_slot >= 0)
+            {
+                this->DrawRendererInstanced(items, batch);
+            }
+            else if (batch.count > 1)
+            {
+                this->DrawRendererStaticBatch(items, batch);
+            }
+            else
+            {
+                this->DrawRenderer(renderer);
+            }
+        }
 
-        for (auto i : renderers)
+        if (!instanced_draws_done)
         {
-            this->DrawRenderer(i);
+            this->DrawInstancedDraws();
         }
         
 		driver.endRenderPass();
@@ -348,54 +644,108 @@ namespace Viry3D
 		driver.flush();
 	}
 
-    void Camera::DrawRenderer(Renderer* renderer)
+    template <class T>
+    void Camera::DrawLighted(int layer, bool cluster_lighting, const Vector<Light*>* lights, T draw)
     {
-        auto& driver = Engine::Instance()->GetDriverApi();
-		
-		driver.bindUniformBuffer((size_t) Shader::BindingPoint::PerRenderer, renderer->GetTransformUniformBuffer());
-
-        SkinnedMeshRenderer* skin = dynamic_cast<SkinnedMeshRenderer*>(renderer);
-        if (skin && skin->GetBonesUniformBuffer())
-        {
-            driver.bindUniformBuffer((size_t) Shader::BindingPoint::PerRendererBones, skin->GetBonesUniformBuffer());
-        }
-        if (skin && skin->GetBlendShapeSamplerGroup())
-        {
-            driver.bindSamplers((size_t) Shader::BindingPoint::PerRendererBones, skin->GetBlendShapeSamplerGroup());
-        }
-
 		bool lighted = false;
 		bool light_add = false;
-		const auto& lights = Light::GetLights();
-		for (auto i : lights)
-		{
-			if ((1 << renderer->GetGameObject()->GetLayer()) & i->GetCullingMask())
+
+		auto draw_light = [&](Light* i) {
+			if ((1 << layer) & i->GetCullingMask())
 			{
 				if (i->IsShadowEnable())
 				{
 					if (i->GetViewUniformBuffer())
 					{
-						driver.bindUniformBuffer((size_t) Shader::BindingPoint::PerLightVertex, i->GetViewUniformBuffer());
+						m_render_state.BindUniformBuffer((size_t) Shader::BindingPoint::PerLightVertex, i->GetViewUniformBuffer());
 					}
 					
 					if (i->GetSamplerGroup())
 					{
-						driver.bindSamplers((size_t) Shader::BindingPoint::PerLightFragment, i->GetSamplerGroup());
+						m_render_state.BindSamplers((size_t) Shader::BindingPoint::PerLightFragment, i->GetSamplerGroup());
 					}
 				}
-				driver.bindUniformBuffer((size_t) Shader::BindingPoint::PerLightFragment, i->GetLightUniformBuffer());
+				m_render_state.BindUniformBuffer((size_t) Shader::BindingPoint::PerLightFragment, i->GetLightUniformBuffer());
 
-                this->DoDraw(renderer, i->IsShadowEnable(), light_add);
+                draw(i->IsShadowEnable(), light_add, false);
 
 				lighted = true;
 				light_add = true;
 			}
+		};
+
+		if (cluster_lighting)
+		{
+			// base pass with ambient and clustered lights, then additive passes of the rest
+			m_render_state.BindUniformBuffer((size_t) Shader::BindingPoint::PerLightFragment, m_light_clusters.GetUniformBuffer());
+
+			draw(false, false, true);
+
+			lighted = true;
+			light_add = true;
+
+			if (lights)
+			{
+				for (int i = 0; i < lights->Size(); ++i)
+				{
+					if (!m_light_clusters.IsClustered((*lights)[i]))
+					{
+						draw_light((*lights)[i]);
+					}
+				}
+			}
+			else
+			{
+				const auto& pass_lights = m_light_clusters.GetPassLights();
+				for (int i = 0; i < pass_lights.Size(); ++i)
+				{
+					draw_light(pass_lights[i]);
+				}
+			}
+		}
+		else if (lights)
+		{
+			// only lights reaching the renderers get additive passes
+			for (int i = 0; i < lights->Size(); ++i)
+			{
+				draw_light((*lights)[i]);
+			}
+		}
+		else
+		{
+			const auto& all_lights = Light::GetLights();
+			for (auto i : all_lights)
+			{
+				draw_light(i);
+			}
 		}
 
 		if (!lighted)
 		{
-            this->DoDraw(renderer);
+			m_render_state.BindUniformBuffer((size_t) Shader::BindingPoint::PerLightFragment, m_ambient_uniform_buffer);
+
+            draw(false, false, false);
 		}
+    }
+
+    void Camera::DrawRenderer(Renderer* renderer)
+    {
+		m_render_state.BindUniformBufferRange((size_t) Shader::BindingPoint::PerRenderer, renderer->GetUniformBuffer(), renderer->GetUniformOffset(), sizeof(RendererUniforms));
+
+        SkinnedMeshRenderer* skin = dynamic_cast<SkinnedMeshRenderer*>(renderer);
+        if (skin && skin->GetBonesUniformBuffer())
+        {
+            m_render_state.BindUniformBuffer((size_t) Shader::BindingPoint::PerRendererBones, skin->GetBonesUniformBuffer());
+        }
+        if (skin && skin->GetBlendShapeSamplerGroup())
+        {
+            m_render_state.BindSamplers((size_t) Shader::BindingPoint::PerRendererBones, skin->GetBlendShapeSamplerGroup());
+        }
+
+        bool cluster_lighting = m_cluster_lighting_active && renderer->IsClusterLightingSupported();
+        this->DrawLighted(renderer->GetGameObject()->GetLayer(), cluster_lighting, &renderer->GetLights(), [=](bool shadow_enable, bool light_add, bool cluster_lighting) {
+            this->DoDraw(renderer, shadow_enable, light_add, cluster_lighting);
+        });
 
         if (Engine::Instance()->GetEditor()->IsInEditorMode())
         {
@@ -406,13 +756,364 @@ namespace Viry3D
         }
     }
 
-    void Camera::DoDraw(Renderer* renderer, bool shadow_enable, bool light_add)
+    const Vector<Light*>& Camera::GetBatchLights(const Vector<DrawItem>& items, const DrawBatch& batch)
+    {
+        // union of lights reaching any renderer of batch
+        m_batch_lights = items[batch.first].renderer->GetLights();
+        for (int i = 1; i < batch.count; ++i)
+        {
+            const auto& lights = items[batch.first + i].renderer->GetLights();
+            for (int j = 0; j < lights.Size(); ++j)
+            {
+                if (!m_batch_lights.Contains(lights[j]))
+                {
+                    m_batch_lights.Add(lights[j]);
+                }
+            }
+        }
+
+        // lights added from other renderers follow the first renderer's lights
+        if (batch.count > 1)
+        {
+            Light::SortDirectionalFirst(m_batch_lights);
+        }
+
+        return m_batch_lights;
+    }
+
+    void Camera::DrawRendererInstanced(const Vector<DrawItem>& items, const DrawBatch& batch)
+    {
+        Renderer* renderer = items[batch.first].renderer;
+
+        m_render_state.BindUniformBufferRange(
+            (size_t) Shader::BindingPoint::PerRenderer,
+            Graphics::GetInstanceBuffer(batch.instance_slot),
+            Graphics::GetInstanceOffset(batch.instance_slot),
+            Graphics::GetInstanceBufferSize());
+
+        bool cluster_lighting = m_cluster_lighting_active && renderer->IsClusterLightingSupported();
+        this->DrawLighted(renderer->GetGameObject()->GetLayer(), cluster_lighting, &this->GetBatchLights(items, batch), [=](bool shadow_enable, bool light_add, bool cluster_lighting) {
+            this->DoDraw(renderer, shadow_enable, light_add, cluster_lighting, batch.count);
+        });
+    }
+
+    void Camera::DrawRendererStaticBatch(const Vector<DrawItem>& items, const DrawBatch& batch)
+    {
+        Renderer* renderer = items[batch.first].renderer;
+        const auto& static_batch = renderer->GetStaticBatch();
+
+        this->MergeStaticBatchRanges(items, batch);
+
+        // uniforms of any member have identity model matrix
+        m_render_state.BindUniformBufferRange((size_t) Shader::BindingPoint::PerRenderer, renderer->GetUniformBuffer(), renderer->GetUniformOffset(), sizeof(RendererUniforms));
+
+        bool cluster_lighting = m_cluster_lighting_active && renderer->IsClusterLightingSupported();
+        this->DrawLighted(renderer->GetGameObject()->GetLayer(), cluster_lighting, &this->GetBatchLights(items, batch), [&](bool shadow_enable, bool light_add, bool cluster_lighting) {
+            for (int i = 0; i < m_static_batch_ranges.Size(); i += 2)
+            {
+                static_batch->SetRange(m_static_batch_ranges[i], m_static_batch_ranges[i + 1]);
+                this->DoDraw(renderer, shadow_enable, light_add, cluster_lighting, 1, &static_batch->GetRangePrimitives());
+            }
+        });
+    }
+
+    void Camera::MergeStaticBatchRanges(const Vector<DrawItem>& items, const DrawBatch& batch)
+    {
+        // merge visible sources into consecutive index ranges
+        m_static_batch_sources.Clear();
+        for (int i = 0; i < batch.count; ++i)
+        {
+            m_static_batch_sources.Add(items[batch.first + i].renderer->GetStaticBatchIndex());
+        }
+        std::sort(&m_static_batch_sources[0], &m_static_batch_sources[0] + batch.count);
+
+        m_static_batch_ranges.Clear();
+        int first = m_static_batch_sources[0];
+        for (int i = 1; i <= batch.count; ++i)
+        {
+            if (i == batch.count || m_static_batch_sources[i] != m_static_batch_sources[i - 1] + 1)
+            {
+                m_static_batch_ranges.Add(first);
+                m_static_batch_ranges.Add(m_static_batch_sources[i - 1]);
+
+                if (i < batch.count)
+                {
+                    first = m_static_batch_sources[i];
+                }
+            }
+        }
+    }
+
+    bool Camera::IsDepthPrepassRenderer(Renderer* renderer)
+    {
+        // alpha tested and blended renderers need their own fragment shader for coverage
+        if (renderer->GetQueue() >= (int) Shader::Queue::AlphaTest)
+        {
+            return false;
+        }
+
+        // dithered lod cross fade discards fragments
+        if (renderer->IsLODFading())
+        {
+            return false;
+        }
+
+        // gpu blend shapes move vertices the depth only shader does not
+        SkinnedMeshRenderer* skin = dynamic_cast<SkinnedMeshRenderer*>(renderer);
+        if (skin && skin->GetBlendShapeSamplerGroup())
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Camera::IsDepthPrepassPass(const Shader::Pass& pass)
+    {
+        const auto& state = pass.pipeline.rasterState;
+        return pass.queue < (int) Shader::Queue::AlphaTest && state.depthWrite &&
+            (state.depthFunc == filament::backend::SamplerCompareFunc::LE || state.depthFunc == filament::backend::SamplerCompareFunc::L);
+    }
+
+    const Ref<Shader>& Camera::GetDepthShader(bool skin, bool instancing)
+    {
+        // shadow map shader writes depth only and reads only position and bone attributes
+        int index = (skin ? 1 : 0) | (instancing ? 2 : 0);
+        Ref<Shader>& shader = m_depth_shaders[index];
+        if (!shader)
+        {
+            Vector<String> keywords;
+            if (skin)
+            {
+                keywords.Add("SKIN_ON");
+            }
+            else if (instancing)
+            {
+                keywords.Add("INSTANCING_ON");
+            }
+            shader = Shader::Find("ShadowMap", keywords);
+        }
+
+        return shader;
+    }
+
+    void Camera::DrawDepthPrepass(const Vector<DrawItem>& items, const Vector<DrawBatch>& batches)
+    {
+        // reuse culled batches, ordered front to back by the nearest member,
+        // opaque keys keep normalized depth in the low 16 bits, batch index goes to the low 32 bits
+        m_prepass_items.Clear();
+        for (int i = 0; i < batches.Size(); ++i)
+        {
+            const auto& batch = batches[i];
+            Renderer* renderer = items[batch.first].renderer;
+            if (!IsDepthPrepassRenderer(renderer))
+            {
+                continue;
+            }
+
+            uint64_t depth_bits = 0xffff;
+            for (int j = 0; j < batch.count; ++j)
+            {
+                uint64_t bits = items[batch.first + j].key & 0xffff;
+                if (bits < depth_bits)
+                {
+                    depth_bits = bits;
+                }
+            }
+
+            m_prepass_items.Add({ (depth_bits << 32) | (uint64_t) i, renderer });
+        }
+
+        RadixSort::Sort(m_prepass_items, m_sort_items);
+
+        for (int i = 0; i < m_prepass_items.Size(); ++i)
+        {
+            const auto& batch = batches[(int) (m_prepass_items[i].key & 0xffffffff)];
+            Renderer* renderer = m_prepass_items[i].renderer;
+
+            if (batch.instance_slot >= 0)
+            {
+                m_render_state.BindUniformBufferRange(
+                    (size_t) Shader::BindingPoint::PerRenderer,
+                    Graphics::GetInstanceBuffer(batch.instance_slot),
+                    Graphics::GetInstanceOffset(batch.instance_slot),
+                    Graphics::GetInstanceBufferSize());
+
+                this->DoDrawDepth(renderer, batch.count, renderer->GetDepthPrimitives());
+            }
+            else if (batch.count > 1)
+            {
+                const auto& static_batch = renderer->GetStaticBatch();
+
+                this->MergeStaticBatchRanges(items, batch);
+
+                m_render_state.BindUniformBufferRange((size_t) Shader::BindingPoint::PerRenderer, renderer->GetUniformBuffer(), renderer->GetUniformOffset(), sizeof(RendererUniforms));
+
+                for (int j = 0; j < m_static_batch_ranges.Size(); j += 2)
+                {
+                    static_batch->SetRange(m_static_batch_ranges[j], m_static_batch_ranges[j + 1]);
+                    this->DoDrawDepth(renderer, 1, static_batch->GetRangePrimitives());
+                }
+            }
+            else
+            {
+                m_render_state.BindUniformBufferRange((size_t) Shader::BindingPoint::PerRenderer, renderer->GetUniformBuffer(), renderer->GetUniformOffset(), sizeof(RendererUniforms));
+
+                SkinnedMeshRenderer* skin = dynamic_cast<SkinnedMeshRenderer*>(renderer);
+                if (skin && skin->GetBonesUniformBuffer())
+                {
+                    m_render_state.BindUniformBuffer((size_t) Shader::BindingPoint::PerRendererBones, skin->GetBonesUniformBuffer());
+                }
+
+                this->DoDrawDepth(renderer, 1, renderer->GetDepthPrimitives());
+            }
+        }
+    }
+
+    void Camera::DoDrawDepth(Renderer* renderer, int instance_count, const Vector<filament::backend::RenderPrimitiveHandle>& primitives)
+    {
+        auto& driver = Engine::Instance()->GetDriverApi();
+
+        SkinnedMeshRenderer* skin = dynamic_cast<SkinnedMeshRenderer*>(renderer);
+        bool skin_on = skin && skin->GetBonePaths().Size() > 0;
+        const auto& depth_shader = GetDepthShader(skin_on, instance_count > 1);
+        if (!depth_shader)
+        {
+            return;
+        }
+
+        const auto& materials = renderer->GetMaterials();
+        for (int i = 0; i < materials.Size(); ++i)
+        {
+            auto& material = materials[i];
+            if (material)
+            {
+                filament::backend::RenderPrimitiveHandle primitive;
+
+                if (i < primitives.Size())
+                {
+                    primitive = primitives[i];
+                }
+                else if (primitives.Size() > 0)
+                {
+                    primitive = primitives[0];
+                }
+
+                if (primitive)
+                {
+                    const auto& shader = renderer->GetShader(i, false, false, instance_count > 1, false);
+
+                    material->SetScissor(m_render_width, m_render_height, m_render_state);
+
+                    // one depth write per material, with the face culling of its pass
+                    for (int j = 0; j < shader->GetPassCount(); ++j)
+                    {
+                        if (IsDepthPrepassPass(shader->GetPass(j)))
+                        {
+                            material->Bind(shader, j, m_render_state);
+
+                            filament::backend::PipelineState pipeline = depth_shader->GetPass(0).pipeline;
+                            pipeline.rasterState.culling = shader->GetPass(j).pipeline.rasterState.culling;
+                            pipeline.rasterState.inverseFrontFaces = shader->GetPass(j).pipeline.rasterState.inverseFrontFaces;
+                            if (instance_count > 1)
+                            {
+                                driver.drawInstanced(pipeline, primitive, instance_count);
+                            }
+                            else
+                            {
+                                driver.draw(pipeline, primitive);
+                            }
+                            Time::SetDrawCall(Time::GetDrawCall() + 1);
+                            m_depth_prepass_draw_count++;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void Camera::DrawInstancedDraws()
+    {
+        const auto& draws = Graphics::GetInstancedDraws();
+        for (int i = 0; i < draws.Size(); ++i)
+        {
+            const auto& draw = draws[i];
+            if (((1 << draw.layer) & m_culling_mask) == 0)
+            {
+                continue;
+            }
+
+            m_render_state.BindUniformBufferRange(
+                (size_t) Shader::BindingPoint::PerRenderer,
+                Graphics::GetInstanceBuffer(draw.instance_slot),
+                Graphics::GetInstanceOffset(draw.instance_slot),
+                Graphics::GetInstanceBufferSize());
+
+            const auto& shader = draw.material->GetShader(Graphics::GetInstancingKeywordMask());
+            bool cluster_lighting = m_cluster_lighting_active && shader && (!shader->IsForwardLight() || shader->IsClusterLightingSupported());
+            this->DrawLighted(draw.layer, cluster_lighting, nullptr, [&](bool shadow_enable, bool light_add, bool cluster_lighting) {
+                this->DoDrawInstanced(draw, shadow_enable, light_add, cluster_lighting);
+            });
+        }
+    }
+
+    void Camera::DoDrawInstanced(const InstancedDraw& draw, bool shadow_enable, bool light_add, bool cluster_lighting)
+    {
+        auto& driver = Engine::Instance()->GetDriverApi();
+
+        static const uint64_t s_recieve_shadow_mask = Shader::MakeKeywordMask({ "RECIEVE_SHADOW_ON" });
+        static const uint64_t s_light_add_mask = Shader::MakeKeywordMask({ "LIGHT_ADD_ON" });
+        static const uint64_t s_cluster_lighting_mask = Shader::MakeKeywordMask({ "CLUSTER_LIGHTING_ON" });
+
+        uint64_t keyword_mask = Graphics::GetInstancingKeywordMask();
+        if (shadow_enable)
+        {
+            keyword_mask |= s_recieve_shadow_mask;
+        }
+        if (light_add)
+        {
+            keyword_mask |= s_light_add_mask;
+        }
+        if (cluster_lighting)
+        {
+            keyword_mask |= s_cluster_lighting_mask;
+        }
+
+        const auto& material = draw.material;
+        Ref<Shader> shader = material->GetShader(keyword_mask);
+        if (!shader)
+        {
+            return;
+        }
+
+        material->SetScissor(m_render_width, m_render_height, m_render_state);
+
+        for (int i = 0; i < shader->GetPassCount(); ++i)
+        {
+            bool has_light = shader->GetPass(i).light_mode == Shader::LightMode::Forward;
+            if (!has_light && light_add)
+            {
+                continue;
+            }
+
+            material->Bind(shader, i, m_render_state);
+
+            const auto& pipeline = shader->GetPass(i).pipeline;
+            driver.drawInstanced(pipeline, draw.primitive, draw.instance_count);
+            Time::SetDrawCall(Time::GetDrawCall() + 1);
+        }
+    }
+
+    void Camera::DoDraw(Renderer* renderer, bool shadow_enable, bool light_add, bool cluster_lighting, int instance_count, const Vector<filament::backend::RenderPrimitiveHandle>* primitives_override)
     {
         auto& driver = Engine::Instance()->GetDriverApi();
 
         SkinnedMeshRenderer* skin = dynamic_cast<SkinnedMeshRenderer*>(renderer);
+        bool depth_prepassed = m_depth_prepass_active && IsDepthPrepassRenderer(renderer);
 
         const auto& materials = renderer->GetMaterials();
+        const auto& primitives = primitives_override ? *primitives_override : renderer->GetPrimitives();
         for (int i = 0; i < materials.Size(); ++i)
         {
             auto& material = materials[i];
@@ -425,7 +1126,7 @@ namespace Viry3D
                     material->SetMatrix(ViewUniforms::PROJECTION_MATRIX, m_view_uniforms.projection_matrix);
                     material->SetVector(ViewUniforms::CAMERA_POS, m_view_uniforms.camera_pos);
                     material->SetVector(ViewUniforms::TIME, m_view_uniforms.time);
-                    material->SetMatrix(RendererUniforms::MODEL_MATRIX, renderer->GetTransform()->GetLocalToWorldMatrix());
+                    material->SetMatrix(RendererUniforms::MODEL_MATRIX, renderer->GetRendererUniforms().model_matrix);
 
                     if (skin && skin->GetBonesUniformBuffer())
                     {
@@ -435,7 +1136,6 @@ namespace Viry3D
 
                 filament::backend::RenderPrimitiveHandle primitive;
 
-                auto primitives = renderer->GetPrimitives();
                 if (i < primitives.Size())
                 {
                     primitive = primitives[i];
@@ -447,19 +1147,9 @@ namespace Viry3D
 
                 if (primitive)
                 {
-                    auto keywords = renderer->GetShaderKeywords();
-                    if (shadow_enable && renderer->IsRecieveShadow())
-                    {
-                        keywords.Add("RECIEVE_SHADOW_ON");
-                    }
-                    if (light_add)
-                    {
-                        keywords.Add("LIGHT_ADD_ON");
-                    }
-                    
-                    const auto& shader = material->GetShader(keywords);
+                    const auto& shader = renderer->GetShader(i, shadow_enable && renderer->IsRecieveShadow(), light_add, instance_count > 1, cluster_lighting);
 
-                    material->SetScissor(this->GetTargetWidth(), this->GetTargetHeight());
+                    material->SetScissor(m_render_width, m_render_height, m_render_state);
 
                     for (int j = 0; j < shader->GetPassCount(); ++j)
                     {
@@ -469,10 +1159,31 @@ namespace Viry3D
                             continue;
                         }
 
-                        material->Bind(shader, j);
+                        material->Bind(shader, j, m_render_state);
 
-                        const auto& pipeline = shader->GetPass(j).pipeline;
-                        driver.draw(pipeline, primitive);
+                        filament::backend::PipelineState pipeline = shader->GetPass(j).pipeline;
+                        if (IsDepthPrepassPass(shader->GetPass(j)))
+                        {
+                            m_opaque_draw_count++;
+
+                            // depth is complete after prepass, shade only the front most fragments,
+                            // LEqual rather than Equal as depth only and forward programs are not guaranteed invariant
+                            if (depth_prepassed)
+                            {
+                                pipeline.rasterState.depthFunc = filament::backend::SamplerCompareFunc::LE;
+                                pipeline.rasterState.depthWrite = false;
+                                m_depth_tested_draw_count++;
+                            }
+                        }
+
+                        if (instance_count > 1)
+                        {
+                            driver.drawInstanced(pipeline, primitive, instance_count);
+                        }
+                        else
+                        {
+                            driver.draw(pipeline, primitive);
+                        }
                         Time::SetDrawCall(Time::GetDrawCall() + 1);
                     }
                 }
@@ -503,11 +1214,11 @@ namespace Viry3D
         {
             const auto& shader = material->GetShader();
 
-            material->SetScissor(this->GetTargetWidth(), this->GetTargetHeight());
+            material->SetScissor(m_render_width, m_render_height, m_render_state);
 
             for (int j = 0; j < shader->GetPassCount(); ++j)
             {
-                material->Bind(shader, j);
+                material->Bind(shader, j, m_render_state);
 
                 const auto& pipeline = shader->GetPass(j).pipeline;
                 driver.draw(pipeline, primitive);
@@ -517,120 +1228,117 @@ namespace Viry3D
 
 	bool Camera::HasPostProcessing()
 	{
-		Vector<Ref<Viry3D::PostProcessing>> coms = this->GetGameObject()->GetComponents<Viry3D::PostProcessing>();
-		return coms.Size() > 0;
+		return (bool) this->GetGameObject()->GetComponent<Viry3D::PostProcessing>();
 	}
 
 	void Camera::PostProcessing()
 	{
-		Vector<Ref<Viry3D::PostProcessing>> coms = this->GetGameObject()->GetComponents<Viry3D::PostProcessing>();
-		if (coms.Size() == 0)
+		if (!m_post_processing_target)
 		{
 			return;
 		}
 
+		Vector<Ref<Viry3D::PostProcessing>>& coms = m_post_processing_effects;
+		coms.Clear();
+		this->GetGameObject()->GetComponents<Viry3D::PostProcessing>(coms);
+
 		int target_width = this->GetTargetWidth();
 		int target_height = this->GetTargetHeight();
 
-		Ref<RenderTarget> post_processing_target_1;
-		Ref<RenderTarget> post_processing_target_2;
-		if (coms.Size() > 1)
+		if (!m_post_processing_output)
 		{
-			post_processing_target_1 = RenderTarget::GetTemporaryRenderTarget(
-				target_width,
-				target_height,
-				TextureFormat::R8G8B8A8,
-				TextureFormat::None,
-				FilterMode::Linear,
-				SamplerAddressMode::ClampToEdge,
-				filament::backend::TargetBufferFlags::COLOR);
+			m_post_processing_output = RefMake<RenderTarget>();
 		}
-		if (coms.Size() > 2)
-		{
-			post_processing_target_2 = RenderTarget::GetTemporaryRenderTarget(
-				target_width,
-				target_height,
-				TextureFormat::R8G8B8A8,
-				TextureFormat::None,
-				FilterMode::Linear,
-				SamplerAddressMode::ClampToEdge,
-				filament::backend::TargetBufferFlags::COLOR);
-		}
-
-		Ref<RenderTarget> src = m_post_processing_target;
-		Ref<RenderTarget> dst = post_processing_target_1;
+		Ref<RenderTarget>& output = m_post_processing_output;
+		output->key.width = target_width;
+		output->key.height = target_height;
+		output->key.filter_mode = FilterMode::Nearest;
+		output->key.wrap_mode = SamplerAddressMode::ClampToEdge;
 
-		for (int i = 0; i < coms.Size(); ++i)
+		if (m_render_target_color || m_render_target_depth)
 		{
-			if (i == coms.Size() - 1)
+			filament::backend::TargetBufferFlags target_flags = filament::backend::TargetBufferFlags::NONE;
+			TextureFormat color_format = TextureFormat::None;
+			TextureFormat depth_format = TextureFormat::None;
+
+			if (m_render_target_color)
+			{
+				target_flags |= filament::backend::TargetBufferFlags::COLOR;
+				color_format = m_render_target_color->GetFormat();
+			}
+			if (m_render_target_depth)
 			{
-				dst = RefMake<RenderTarget>();
-				dst->key.width = target_width;
-				dst->key.height = target_height;
-				dst->key.filter_mode = FilterMode::Nearest;
-				dst->key.wrap_mode = SamplerAddressMode::ClampToEdge;
+				target_flags |= filament::backend::TargetBufferFlags::DEPTH;
+				depth_format = m_render_target_depth->GetFormat();
+			}
 
-				if (m_render_target_color || m_render_target_depth)
-				{
-					filament::backend::TargetBufferFlags target_flags = filament::backend::TargetBufferFlags::NONE;
-					TextureFormat color_format = TextureFormat::None;
-					TextureFormat depth_format = TextureFormat::None;
+			output->key.color_format = color_format;
+			output->key.depth_format = depth_format;
+			output->key.flags = target_flags;
 
-					if (m_render_target_color)
-					{
-						target_flags |= filament::backend::TargetBufferFlags::COLOR;
-						color_format = m_render_target_color->GetFormat();
-					}
-					if (m_render_target_depth)
-					{
-						target_flags |= filament::backend::TargetBufferFlags::DEPTH;
-						depth_format = m_render_target_depth->GetFormat();
-					}
-
-					dst->key.color_format = color_format;
-					dst->key.depth_format = depth_format;
-					dst->key.flags = target_flags;
+			output->target = m_render_target;
+		}
+		else
+		{
+			output->key.color_format = TextureFormat::R8G8B8A8;
+			output->key.depth_format = Texture::SelectDepthFormat();
+			output->key.flags = filament::backend::TargetBufferFlags::COLOR_AND_DEPTH;
 
-					dst->target = m_render_target;
-				}
-				else
-				{
-					dst->key.color_format = TextureFormat::R8G8B8A8;
-					dst->key.depth_format = Texture::SelectDepthFormat();
-					dst->key.flags = filament::backend::TargetBufferFlags::COLOR_AND_DEPTH;
+			output->target = *(filament::backend::RenderTargetHandle*) Engine::Instance()->GetDefaultRenderTarget();
+		}
 
-					dst->target = *(filament::backend::RenderTargetHandle*) Engine::Instance()->GetDefaultRenderTarget();
-				}
-			}
+		// effects chain through transient targets at render size, the graph aliases them and culls passes nobody reads,
+		// the last effect or a plain blit upscales to the camera target. the graph is declared again each frame for
+		// current effect parameters, but only compiled again when the effect list or target sizes change
+		RenderGraph& graph = m_render_graph;
+		int src = graph.ImportTarget("CameraTarget", m_post_processing_target);
+		int final_dst = graph.ImportTarget("CameraOutput", output);
 
-			coms[i]->SetCameraDepthTexture(m_post_processing_target->depth);
-			coms[i]->OnRenderImage(src, dst);
-			coms[i]->SetCameraDepthTexture(Ref<Texture>());
+		for (int i = 0; i < coms.Size(); ++i)
+		{
+			int dst;
 
-			// swap
-			if (i < coms.Size() - 1)
+			if (i == coms.Size() - 1)
 			{
-				Ref<RenderTarget> temp = src;
-				src = dst;
-				dst = temp;
-
-				if (i == 0 && coms.Size() > 2)
-				{
-					dst = post_processing_target_2;
-				}
+				dst = final_dst;
 			}
+			else
+			{
+				dst = graph.CreateTarget(
+					"PostProcessing",
+					m_render_width,
+					m_render_height,
+					m_hdr ? m_post_processing_target->key.color_format : TextureFormat::R8G8B8A8,
+					TextureFormat::None,
+					FilterMode::Linear,
+					SamplerAddressMode::ClampToEdge,
+					filament::backend::TargetBufferFlags::COLOR);
+			}
+
+			coms[i]->OnRenderGraph(graph, src, dst);
+			src = dst;
+		}
+
+		if (coms.Size() == 0)
+		{
+			graph.AddPass("Upscale", { src }, { final_dst }, [=](RenderGraph& graph) {
+				Camera::Blit(graph.GetTarget(src), graph.GetTarget(final_dst));
+			});
 		}
 
-		if (post_processing_target_1)
+		for (int i = 0; i < coms.Size(); ++i)
 		{
-			RenderTarget::ReleaseTemporaryRenderTarget(post_processing_target_1);
-			post_processing_target_1.reset();
+			coms[i]->SetCameraDepthTexture(m_post_processing_target->depth);
 		}
-		if (post_processing_target_2)
+
+		graph.Execute();
+		graph.Clear();
+
+		for (int i = 0; i < coms.Size(); ++i)
 		{
-			RenderTarget::ReleaseTemporaryRenderTarget(post_processing_target_2);
-			post_processing_target_2.reset();
+			coms[i]->SetCameraDepthTexture(Ref<Texture>());
 		}
+		coms.Clear();
 
 		RenderTarget::ReleaseTemporaryRenderTarget(m_post_processing_target);
 		m_post_processing_target.reset();
@@ -707,8 +1415,10 @@ namespace Viry3D
 			auto& driver = Engine::Instance()->GetDriverApi();
 			driver.beginRenderPass(dst->target, params);
 
+			RenderState state;
+
 			const auto& shader = material->GetShader();
-			material->SetScissor(target_width, target_height);
+			material->SetScissor(target_width, target_height, state);
 
 			int pass_begin = 0;
 			int pass_end = shader->GetPassCount();
@@ -720,7 +1430,7 @@ namespace Viry3D
 
 			for (int i = pass_begin; i < pass_end; ++i)
 			{
-				material->Bind(shader, i);
+				material->Bind(shader, i, state);
 
 				const auto& pipeline = shader->GetPass(i).pipeline;
 				driver.draw(pipeline, primitive);
@@ -747,7 +1457,25 @@ namespace Viry3D
 		m_view_matrix_dirty(true),
 		m_projection_matrix_dirty(true),
 		m_view_matrix_external(false),
-		m_projection_matrix_external(false)
+		m_projection_matrix_external(false),
+		m_tested_renderer_count(0),
+		m_culled_renderer_count(0),
+		m_drawn_renderer_count(0),
+		m_occluded_renderer_count(0),
+		m_culling_shared(false),
+		m_occlusion_culling(false),
+		m_cluster_lighting(true),
+		m_cluster_lighting_active(false),
+		m_depth_prepass(false),
+		m_depth_prepass_active(false),
+		m_depth_prepass_draw_count(0),
+		m_depth_tested_draw_count(0),
+		m_opaque_draw_count(0),
+		m_dynamic_resolution_enable(false),
+		m_dynamic_resolution_active(false),
+		m_hdr(false),
+		m_render_width(0),
+		m_render_height(0)
     {
 		m_cameras.AddLast(this);
 		m_cameras_order_dirty = true;
@@ -763,6 +1491,12 @@ namespace Viry3D
 			m_view_uniform_buffer.clear();
 		}
 
+		if (m_ambient_uniform_buffer)
+		{
+			driver.destroyUniformBuffer(m_ambient_uniform_buffer);
+			m_ambient_uniform_buffer.clear();
+		}
+
 		if (m_render_target)
 		{
 			driver.destroyRenderTarget(m_render_target);
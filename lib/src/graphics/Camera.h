@@ -21,6 +21,13 @@
 #include "CameraClearFlags.h"
 #include "Color.h"
 #include "Material.h"
+#include "Renderer.h"
+#include "RenderState.h"
+#include "Graphics.h"
+#include "LightClusters.h"
+#include "OcclusionBuffer.h"
+#include "DynamicResolution.h"
+#include "RenderGraph.h"
 #include "math/Rect.h"
 #include "math/Matrix4x4.h"
 #include "container/List.h"
@@ -29,9 +36,19 @@
 namespace Viry3D
 {
 	class Texture;
-    class Renderer;
 	class RenderTarget;
 	class Mesh;
+	class Light;
+	class PostProcessing;
+
+    // consecutive sorted draw items drawn with one instanced draw when instance slot is valid,
+    // or with merged index ranges of a static batch when count > 1
+    struct DrawBatch
+    {
+        int first;
+        int count;
+        int instance_slot;
+    };
 
     class Camera : public Component
     {
@@ -81,18 +98,77 @@ namespace Viry3D
         Vector3 ScreenToWorldPoint(const Vector3& position);
         Vector3 WorldToScreenPoint(const Vector3& position);
         Ray ScreenPointToRay(const Vector3& position);
+		// renderers in subtrees rejected by the bvh are not counted as tested
+		int GetTestedRendererCount() const { return m_tested_renderer_count; }
+		int GetCulledRendererCount() const { return m_culled_renderer_count; }
+		int GetDrawnRendererCount() const { return m_drawn_renderer_count; }
+		// after frustum culling, test renderers against a cpu depth buffer of occluder renderers,
+		// occluded renderers are counted as culled too
+		bool IsOcclusionCullingEnable() const { return m_occlusion_culling; }
+		void EnableOcclusionCulling(bool enable);
+		int GetOccludedRendererCount() const { return m_occluded_renderer_count; }
+		// a camera drawn right after a camera with the same view, projection, far clip, culling mask and occlusion culling
+		// draws its culled, sorted and batched renderers without culling again
+		bool IsCullingShared() const { return m_culling_shared; }
+		const Ref<OcclusionBuffer>& GetOcclusionBuffer() const { return m_occlusion_buffer; }
+		// shade unshadowed lights in one pass with a froxel light grid, per light passes are kept
+		// for shadowed lights, shaders without CLUSTER_LIGHTING_ON and gles 2.0
+		bool IsClusterLightingEnable() const { return m_cluster_lighting; }
+		void EnableClusterLighting(bool enable);
+		const LightClusters& GetLightClusters() const { return m_light_clusters; }
+		// draw opaque renderers front to back with a depth only shader first, forward passes then test depth
+		// without writing it, so expensive fragment shaders run about once per pixel, not on gles 2.0
+		bool IsDepthPrepassEnable() const { return m_depth_prepass; }
+		void SetDepthPrepass(bool enable);
+		// draws of the depth prepass in last frame
+		int GetDepthPrepassDrawCount() const { return m_depth_prepass_draw_count; }
+		// forward draws in last frame shading only fragments left visible by the depth prepass,
+		// compare with GetOpaqueDrawCount for the part of opaque fragment work saved from overdraw
+		int GetDepthTestedDrawCount() const { return m_depth_tested_draw_count; }
+		int GetOpaqueDrawCount() const { return m_opaque_draw_count; }
+		// engine wide controller of the render scale, shared by cameras with dynamic resolution,
+		// the scale only changes when the app passes frame times to Update or enables its auto update
+		static DynamicResolution& GetDynamicResolution() { return m_dynamic_resolution; }
+		// draw into a target scaled by GetDynamicResolution and upscale it to the camera target after post processing,
+		// needs a color target, cameras with a depth only render target are not scaled
+		bool IsDynamicResolutionEnable() const { return m_dynamic_resolution_enable; }
+		void EnableDynamicResolution(bool enable) { m_dynamic_resolution_enable = enable; }
+		// draw into a float target when going through post processing, packed R11G11B10F when supported for
+		// the screen, with alpha for render targets, post processing intermediates use the same format
+		bool IsHDREnable() const { return m_hdr; }
+		void EnableHDR(bool enable) { m_hdr = enable; }
+		// size drawn in last frame, below target size while dynamic resolution scales down
+		int GetRenderWidth() const { return m_render_width; }
+		int GetRenderHeight() const { return m_render_height; }
 
 	protected:
 		virtual void OnTransformDirty();
 
 	private:
         void OnResize(int width, int height);
-        void CullRenderers(const List<Renderer*>& renderers, List<Renderer*>& result);
+        void CullRenderers(Vector<DrawItem>& result);
+		bool IsCullingCompatible(Camera* camera);
+		void CullOccludedRenderers(Vector<DrawItem>& result, int first);
 		void UpdateViewUniforms();
-		void Draw(const List<Renderer*>& renderers);
+		void UpdateLightUniforms();
+        void BatchRenderers(const Vector<DrawItem>& items, Vector<DrawBatch>& batches);
+		void Draw(const Vector<DrawItem>& items, const Vector<DrawBatch>& batches);
+        template <class T>
+        void DrawLighted(int layer, bool cluster_lighting, const Vector<Light*>* lights, T draw);
+        const Vector<Light*>& GetBatchLights(const Vector<DrawItem>& items, const DrawBatch& batch);
         void DrawRenderer(Renderer* renderer);
-        void DoDraw(Renderer* renderer, bool shadow_enable = false, bool light_add = false);
+        void DrawRendererInstanced(const Vector<DrawItem>& items, const DrawBatch& batch);
+        void DrawRendererStaticBatch(const Vector<DrawItem>& items, const DrawBatch& batch);
+        void DrawInstancedDraws();
+        void DoDraw(Renderer* renderer, bool shadow_enable = false, bool light_add = false, bool cluster_lighting = false, int instance_count = 1, const Vector<filament::backend::RenderPrimitiveHandle>* primitives_override = nullptr);
+        void DoDrawInstanced(const InstancedDraw& draw, bool shadow_enable, bool light_add, bool cluster_lighting);
         void DrawRendererBounds(Renderer* renderer);
+		void DrawDepthPrepass(const Vector<DrawItem>& items, const Vector<DrawBatch>& batches);
+		void DoDrawDepth(Renderer* renderer, int instance_count, const Vector<filament::backend::RenderPrimitiveHandle>& primitives);
+		void MergeStaticBatchRanges(const Vector<DrawItem>& items, const DrawBatch& batch);
+		static bool IsDepthPrepassRenderer(Renderer* renderer);
+		static bool IsDepthPrepassPass(const Shader::Pass& pass);
+		static const Ref<Shader>& GetDepthShader(bool skin, bool instancing);
 		bool HasPostProcessing();
 		void PostProcessing();
 
@@ -103,6 +179,8 @@ namespace Viry3D
 		static bool m_cameras_order_dirty;
 		static Ref<Mesh> m_quad_mesh;
 		static Ref<Material> m_blit_material;
+		static Ref<Shader> m_depth_shaders[4];
+		static DynamicResolution m_dynamic_resolution;
 		int m_depth;
         uint32_t m_culling_mask;
 		CameraClearFlags m_clear_flags;
@@ -123,8 +201,43 @@ namespace Viry3D
 		Ref<Texture> m_render_target_color;
 		Ref<Texture> m_render_target_depth;
 		Ref<RenderTarget> m_post_processing_target;
+		RenderGraph m_render_graph;
+		// reused every frame so post processing does not allocate once warm
+		Vector<Ref<Viry3D::PostProcessing>> m_post_processing_effects;
+		Ref<RenderTarget> m_post_processing_output;
 		ViewUniforms m_view_uniforms;
 		filament::backend::UniformBufferHandle m_view_uniform_buffer;
+		filament::backend::UniformBufferHandle m_ambient_uniform_buffer;
 		filament::backend::RenderTargetHandle m_render_target;
+		int m_tested_renderer_count;
+		int m_culled_renderer_count;
+		int m_drawn_renderer_count;
+		int m_occluded_renderer_count;
+		bool m_culling_shared;
+		bool m_occlusion_culling;
+		Ref<OcclusionBuffer> m_occlusion_buffer;
+		Vector<Renderer*> m_occluders;
+		bool m_cluster_lighting;
+		bool m_cluster_lighting_active;
+		LightClusters m_light_clusters;
+		bool m_depth_prepass;
+		bool m_depth_prepass_active;
+		int m_depth_prepass_draw_count;
+		int m_depth_tested_draw_count;
+		int m_opaque_draw_count;
+		bool m_dynamic_resolution_enable;
+		bool m_dynamic_resolution_active;
+		bool m_hdr;
+		int m_render_width;
+		int m_render_height;
+		Vector<DrawItem> m_prepass_items;
+		Vector<DrawItem> m_draw_items;
+		Vector<DrawItem> m_sort_items;
+		Vector<DrawBatch> m_draw_batches;
+		Vector<Matrix4x4> m_instance_matrices;
+		Vector<int> m_static_batch_sources;
+		Vector<int> m_static_batch_ranges;
+		Vector<Light*> m_batch_lights;
+		RenderState m_render_state;
     };
 }
@@ -0,0 +1,121 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "DynamicResolution.h"
+#include "math/Mathf.h"
+
+namespace Viry3D
+{
+	// weight of the newest frame time in the smoothed frame time
+	static const float FRAME_TIME_SMOOTHING = 0.2f;
+
+	DynamicResolution::DynamicResolution():
+		m_min_scale(0.5f),
+		m_max_scale(1.0f),
+		m_target_frame_time(1000.0f / 60),
+		m_down_ratio(1.0f),
+		m_up_ratio(0.8f),
+		m_up_frames(30),
+		m_down_step(0.1f),
+		m_up_step(0.05f),
+		m_auto_update(false),
+		m_scale(1.0f),
+		m_frame_time(0),
+		m_under_frames(0),
+		m_cooldown(0)
+	{
+
+	}
+
+	void DynamicResolution::SetScaleRange(float min_scale, float max_scale)
+	{
+		m_min_scale = Mathf::Clamp(min_scale, 0.1f, 1.0f);
+		m_max_scale = Mathf::Clamp(max_scale, m_min_scale, 1.0f);
+		m_scale = Mathf::Clamp(m_scale, m_min_scale, m_max_scale);
+	}
+
+	void DynamicResolution::SetTargetFrameTime(float frame_time)
+	{
+		m_target_frame_time = frame_time;
+	}
+
+	void DynamicResolution::SetHysteresis(float down_ratio, float up_ratio, int up_frames)
+	{
+		m_down_ratio = down_ratio;
+		m_up_ratio = Mathf::Min(up_ratio, down_ratio);
+		m_up_frames = Mathf::Max(up_frames, 1);
+	}
+
+	void DynamicResolution::SetScaleStep(float down_step, float up_step)
+	{
+		m_down_step = down_step;
+		m_up_step = up_step;
+	}
+
+	void DynamicResolution::Update(float frame_time)
+	{
+		if (m_frame_time > 0)
+		{
+			m_frame_time = Mathf::Lerp(m_frame_time, frame_time, FRAME_TIME_SMOOTHING);
+		}
+		else
+		{
+			m_frame_time = frame_time;
+		}
+
+		// let the frame time settle at the new scale
+		if (m_cooldown > 0)
+		{
+			m_cooldown--;
+			return;
+		}
+
+		if (m_frame_time > m_target_frame_time * m_down_ratio)
+		{
+			m_under_frames = 0;
+
+			if (m_scale > m_min_scale)
+			{
+				m_scale = Mathf::Max(m_scale - m_down_step, m_min_scale);
+				m_cooldown = CooldownFrames;
+			}
+		}
+		else if (m_frame_time < m_target_frame_time * m_up_ratio)
+		{
+			m_under_frames++;
+
+			if (m_under_frames >= m_up_frames && m_scale < m_max_scale)
+			{
+				m_scale = Mathf::Min(m_scale + m_up_step, m_max_scale);
+				m_under_frames = 0;
+				m_cooldown = CooldownFrames;
+			}
+		}
+		else
+		{
+			m_under_frames = 0;
+		}
+	}
+
+	void DynamicResolution::Reset()
+	{
+		m_scale = m_max_scale;
+		m_frame_time = 0;
+		m_under_frames = 0;
+		m_cooldown = 0;
+	}
+}
@@ -0,0 +1,64 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+namespace Viry3D
+{
+	// picks a render scale from frame times, the scale only depends on the sequence of frame times passed to Update.
+	// scale goes down one step when the smoothed frame time is above target * down_ratio, and up one step after
+	// up_frames frames in a row below target * up_ratio, no step is taken for a few frames after a change
+	class DynamicResolution
+	{
+	public:
+		static const int CooldownFrames = 8;
+
+		DynamicResolution();
+		// scale of render target width and height, 0 ~ 1
+		void SetScaleRange(float min_scale, float max_scale);
+		float GetMinScale() const { return m_min_scale; }
+		float GetMaxScale() const { return m_max_scale; }
+		// frame time in ms
+		void SetTargetFrameTime(float frame_time);
+		float GetTargetFrameTime() const { return m_target_frame_time; }
+		void SetHysteresis(float down_ratio, float up_ratio, int up_frames);
+		void SetScaleStep(float down_step, float up_step);
+		// off by default, when on the engine passes the interval between frame begins, which is never below
+		// the refresh interval with vsync, so keep it off and pass another time like gpu time in that case
+		void EnableAutoUpdate(bool enable) { m_auto_update = enable; }
+		bool IsAutoUpdateEnable() const { return m_auto_update; }
+		void Update(float frame_time);
+		void Reset();
+		float GetScale() const { return m_scale; }
+		float GetSmoothedFrameTime() const { return m_frame_time; }
+
+	private:
+		float m_min_scale;
+		float m_max_scale;
+		float m_target_frame_time;
+		float m_down_ratio;
+		float m_up_ratio;
+		int m_up_frames;
+		float m_down_step;
+		float m_up_step;
+		bool m_auto_update;
+		float m_scale;
+		float m_frame_time;
+		int m_under_frames;
+		int m_cooldown;
+	};
+}
@@ -0,0 +1,95 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "Graphics.h"
+#include "Shader.h"
+#include "Debug.h"
+#include "math/Mathf.h"
+
+namespace Viry3D
+{
+	UniformBufferPool Graphics::m_instance_pool(sizeof(Matrix4x4) * Graphics::MaxInstanceCount, 8);
+	Vector<int> Graphics::m_instance_slots;
+	Vector<InstancedDraw> Graphics::m_instanced_draws;
+
+	void Graphics::Done()
+	{
+		m_instanced_draws.Clear();
+		m_instance_slots.Clear();
+		m_instance_pool.Clear();
+	}
+
+	void Graphics::DrawMeshInstanced(const Ref<Mesh>& mesh, int submesh, const Ref<Material>& material, const Vector<Matrix4x4>& matrices, int layer)
+	{
+		const auto& primitives = mesh->GetPrimitives();
+		if (submesh < 0 || submesh >= primitives.Size() || matrices.Size() == 0)
+		{
+			return;
+		}
+
+		if (!material->GetShader()->IsInstancingSupported())
+		{
+			Log("shader not support instancing: %s", material->GetShader()->GetName().CString());
+			return;
+		}
+
+		for (int i = 0; i < matrices.Size(); i += MaxInstanceCount)
+		{
+			InstancedDraw draw;
+			draw.mesh = mesh;
+			draw.primitive = primitives[submesh];
+			draw.material = material;
+			draw.layer = layer;
+			draw.instance_count = Mathf::Min(matrices.Size() - i, MaxInstanceCount);
+			draw.instance_slot = AllocateInstances(&matrices[i], draw.instance_count);
+
+			m_instanced_draws.Add(draw);
+		}
+	}
+
+	uint64_t Graphics::GetInstancingKeywordMask()
+	{
+		static const uint64_t s_instancing_mask = Shader::MakeKeywordMask({ "INSTANCING_ON" });
+		return s_instancing_mask;
+	}
+
+	int Graphics::AllocateInstances(const Matrix4x4* matrices, int count)
+	{
+		assert(count <= MaxInstanceCount);
+
+		int slot = m_instance_pool.Allocate();
+		m_instance_pool.Update(slot, matrices, sizeof(Matrix4x4) * count);
+		m_instance_slots.Add(slot);
+
+		return slot;
+	}
+
+	void Graphics::FlushInstances()
+	{
+		m_instance_pool.Flush();
+	}
+
+	void Graphics::EndFrame()
+	{
+		for (int i = 0; i < m_instance_slots.Size(); ++i)
+		{
+			m_instance_pool.Free(m_instance_slots[i]);
+		}
+		m_instance_slots.Clear();
+		m_instanced_draws.Clear();
+	}
+}
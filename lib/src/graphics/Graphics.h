@@ -0,0 +1,64 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Material.h"
+#include "Mesh.h"
+#include "UniformBufferPool.h"
+#include "math/Matrix4x4.h"
+#include "container/Vector.h"
+
+namespace Viry3D
+{
+	struct InstancedDraw
+	{
+		Ref<Mesh> mesh;
+		filament::backend::RenderPrimitiveHandle primitive;
+		Ref<Material> material;
+		int layer;
+		int instance_slot;
+		int instance_count;
+	};
+
+	class Graphics
+	{
+	public:
+		// max instances per draw call, matches u_model_matrices in shaders with INSTANCING_ON
+		static const int MaxInstanceCount = 128;
+
+		static void Done();
+		// draw submesh once per matrix in every camera rendering layer this frame,
+		// split into draws of MaxInstanceCount, material shader must support instancing
+		static void DrawMeshInstanced(const Ref<Mesh>& mesh, int submesh, const Ref<Material>& material, const Vector<Matrix4x4>& matrices, int layer = 0);
+		static const Vector<InstancedDraw>& GetInstancedDraws() { return m_instanced_draws; }
+		static uint64_t GetInstancingKeywordMask();
+		// copy model matrices into per frame instance storage, the slot is valid until EndFrame
+		static int AllocateInstances(const Matrix4x4* matrices, int count);
+		static const filament::backend::UniformBufferHandle& GetInstanceBuffer(int slot) { return m_instance_pool.GetBuffer(slot); }
+		static int GetInstanceOffset(int slot) { return m_instance_pool.GetOffset(slot); }
+		static int GetInstanceBufferSize() { return m_instance_pool.GetSlotSize(); }
+		// upload instances written since last flush, call outside of render pass
+		static void FlushInstances();
+		static void EndFrame();
+
+	private:
+		static UniformBufferPool m_instance_pool;
+		static Vector<int> m_instance_slots;
+		static Vector<InstancedDraw> m_instanced_draws;
+	};
+}
@@ -0,0 +1,300 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "LODGroup.h"
+#include "Renderer.h"
+#include "Camera.h"
+#include "GameObject.h"
+#include "time/Time.h"
+#include "math/Mathf.h"
+
+namespace Viry3D
+{
+	float LODGroup::m_bias = 1.0f;
+
+	void LODGroup::SetBias(float bias)
+	{
+		m_bias = Mathf::Max(bias, 0.0f);
+	}
+
+	LODGroup::LODGroup():
+		m_cross_fade(false),
+		m_current_lod(0),
+		m_fade_lod(-1),
+		m_fade(1.0f),
+		m_select_camera(nullptr),
+		m_select_frame(-1)
+	{
+
+	}
+
+	LODGroup::~LODGroup()
+	{
+		this->UpdateRenderers(false);
+	}
+
+	void LODGroup::SetLODs(const Vector<LOD>& lods)
+	{
+		this->UpdateRenderers(false);
+
+		m_lods = lods;
+		m_current_lod = 0;
+		m_fade_lod = -1;
+		m_select_frame = -1;
+
+		this->UpdateRenderers(true);
+	}
+
+	void LODGroup::EnableCrossFade(bool enable)
+	{
+		if (m_cross_fade != enable)
+		{
+			this->UpdateRenderers(false);
+			m_cross_fade = enable;
+			this->UpdateRenderers(true);
+		}
+	}
+
+	void LODGroup::UpdateRenderers(bool attach)
+	{
+		const String keyword = CrossFadeKeyword();
+
+		for (int i = 0; i < m_lods.Size(); ++i)
+		{
+			const auto& renderers = m_lods[i].renderers;
+			for (int j = 0; j < renderers.Size(); ++j)
+			{
+				auto renderer = renderers[j].lock();
+				if (!renderer)
+				{
+					continue;
+				}
+
+				renderer->SetLODFade(1.0f, false);
+
+				if (attach)
+				{
+					renderer->SetLODGroup(this);
+
+					if (m_cross_fade && renderer->IsLODCrossFadeSupported())
+					{
+						renderer->EnableShaderKeyword(keyword);
+					}
+				}
+				else
+				{
+					if (renderer->GetLODGroup() == this)
+					{
+						renderer->SetLODGroup(nullptr);
+					}
+
+					const auto& keywords = renderer->GetShaderKeywords();
+					if (keywords.Contains(keyword))
+					{
+						Vector<String> rest;
+						for (int k = 0; k < keywords.Size(); ++k)
+						{
+							if (keywords[k] != keyword)
+							{
+								rest.Add(keywords[k]);
+							}
+						}
+						renderer->SetShaderKeywords(rest);
+					}
+				}
+			}
+		}
+	}
+
+	bool LODGroup::IsInLOD(Renderer* renderer, int lod) const
+	{
+		if (lod < 0 || lod >= m_lods.Size())
+		{
+			return false;
+		}
+
+		const auto& renderers = m_lods[lod].renderers;
+		for (int i = 0; i < renderers.Size(); ++i)
+		{
+			if (renderers[i].lock().get() == renderer)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool LODGroup::IsCrossFadeSupported(int lod) const
+	{
+		// fading out of the last level shows nothing in place
+		if (lod >= m_lods.Size())
+		{
+			return true;
+		}
+
+		const auto& renderers = m_lods[lod].renderers;
+		for (int i = 0; i < renderers.Size(); ++i)
+		{
+			auto renderer = renderers[i].lock();
+			if (renderer && !renderer->IsLODCrossFadeSupported())
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	float LODGroup::GetScreenRelativeHeight(Camera* camera) const
+	{
+		Bounds bounds;
+		bool has_bounds = false;
+
+		for (int i = 0; i < m_lods.Size(); ++i)
+		{
+			const auto& renderers = m_lods[i].renderers;
+			for (int j = 0; j < renderers.Size(); ++j)
+			{
+				auto renderer = renderers[j].lock();
+				if (renderer)
+				{
+					if (has_bounds)
+					{
+						bounds.Encapsulate(renderer->GetWorldBounds());
+					}
+					else
+					{
+						bounds = renderer->GetWorldBounds();
+						has_bounds = true;
+					}
+				}
+			}
+		}
+
+		if (!has_bounds)
+		{
+			return 0;
+		}
+
+		// largest side of bounds projected to ndc, ndc height is 2
+		Vector3 size = bounds.GetSize();
+		float extent = Mathf::Max(size.x, Mathf::Max(size.y, size.z));
+		float height = extent * 0.5f * camera->GetProjectionMatrix().m11;
+
+		if (!camera->IsOrthographic())
+		{
+			float depth = -camera->GetViewMatrix().MultiplyPoint3x4(bounds.GetCenter()).z;
+			height /= Mathf::Max(depth, camera->GetNearClip());
+		}
+
+		return height * m_bias;
+	}
+
+	void LODGroup::Select(Camera* camera)
+	{
+		m_select_camera = camera;
+		m_select_frame = Time::GetFrameCount();
+
+		float height = this->GetScreenRelativeHeight(camera);
+
+		int current = -1;
+		for (int i = 0; i < m_lods.Size(); ++i)
+		{
+			if (height >= m_lods[i].screen_relative_height)
+			{
+				current = i;
+				break;
+			}
+		}
+
+		// fade goes from 1 at the top of transition band to 0 at the threshold of current level
+		int fade_lod = -1;
+		float fade = 1.0f;
+		if (m_cross_fade && current >= 0)
+		{
+			float low = m_lods[current].screen_relative_height;
+			float high = current > 0 ? m_lods[current - 1].screen_relative_height : 1.0f;
+			float width = m_lods[current].fade_transition_width * (high - low);
+
+			if (width > 0 && height < low + width &&
+				this->IsCrossFadeSupported(current) && this->IsCrossFadeSupported(current + 1))
+			{
+				fade_lod = current + 1;
+				fade = Mathf::Clamp01((height - low) / width);
+			}
+		}
+
+		m_current_lod = current;
+		m_fade_lod = fade_lod;
+		m_fade = fade;
+
+		// current level draws dither values below fade, the next level draws the rest
+		for (int i = 0; i < m_lods.Size(); ++i)
+		{
+			if (i != current && i != fade_lod)
+			{
+				continue;
+			}
+
+			const auto& renderers = m_lods[i].renderers;
+			for (int j = 0; j < renderers.Size(); ++j)
+			{
+				auto renderer = renderers[j].lock();
+				if (!renderer)
+				{
+					continue;
+				}
+
+				if (i == current)
+				{
+					renderer->SetLODFade(fade, false);
+				}
+				else if (!this->IsInLOD(renderer.get(), current))
+				{
+					renderer->SetLODFade(fade, true);
+				}
+			}
+		}
+	}
+
+	bool LODGroup::IsRendererVisible(Renderer* renderer, Camera* camera)
+	{
+		if (!this->IsEnable() || !this->GetGameObject()->IsActiveInTree())
+		{
+			renderer->SetLODFade(1.0f, false);
+			return true;
+		}
+
+		if (m_select_camera != camera || m_select_frame != Time::GetFrameCount())
+		{
+			this->Select(camera);
+		}
+
+		return this->IsInLOD(renderer, m_current_lod) || this->IsInLOD(renderer, m_fade_lod);
+	}
+
+	bool LODGroup::IsRendererInCurrentLOD(Renderer* renderer) const
+	{
+		if (!this->IsEnable() || !this->GetGameObject()->IsActiveInTree())
+		{
+			return true;
+		}
+
+		return this->IsInLOD(renderer, m_current_lod);
+	}
+}
@@ -0,0 +1,78 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Component.h"
+#include "container/Vector.h"
+
+namespace Viry3D
+{
+	class Renderer;
+	class Camera;
+
+	struct LOD
+	{
+		// level is used while bounds height on screen / screen height is at least this, decreasing by level
+		float screen_relative_height;
+		// part of the level's height range above its threshold where it cross fades into the next level, 0 ~ 1
+		float fade_transition_width;
+		Vector<WeakRef<Renderer>> renderers;
+	};
+
+	// draws one level of renderers selected by screen height of their world bounds during culling,
+	// nothing is drawn below the last level's threshold
+	class LODGroup : public Component
+	{
+	public:
+		static float GetBias() { return m_bias; }
+		// scales screen heights, greater than 1 keeps detailed levels longer
+		static void SetBias(float bias);
+		static const char* CrossFadeKeyword() { return "LOD_FADE_CROSSFADE"; }
+		LODGroup();
+		virtual ~LODGroup();
+		const Vector<LOD>& GetLODs() const { return m_lods; }
+		void SetLODs(const Vector<LOD>& lods);
+		// dither between a level and the next one inside the fade transition width,
+		// only for renderers whose shaders support LOD_FADE_CROSSFADE, others switch at once
+		bool IsCrossFadeEnable() const { return m_cross_fade; }
+		void EnableCrossFade(bool enable);
+		// selected level of the last culling camera, -1 when smaller than all levels
+		int GetCurrentLOD() const { return m_current_lod; }
+		// select level for camera once per frame, renderer is visible if in the selected or fading level
+		bool IsRendererVisible(Renderer* renderer, Camera* camera);
+		// by the last selection, for passes without a camera like shadows
+		bool IsRendererInCurrentLOD(Renderer* renderer) const;
+		float GetScreenRelativeHeight(Camera* camera) const;
+
+	private:
+		void Select(Camera* camera);
+		void UpdateRenderers(bool attach);
+		bool IsInLOD(Renderer* renderer, int lod) const;
+		bool IsCrossFadeSupported(int lod) const;
+
+	private:
+		static float m_bias;
+		Vector<LOD> m_lods;
+		bool m_cross_fade;
+		int m_current_lod;
+		int m_fade_lod;
+		float m_fade;
+		Camera* m_select_camera;
+		int m_select_frame;
+	};
+}
@@ -16,18 +16,29 @@
 */
 
 #include "Light.h"
+#include "Camera.h"
 #include "Engine.h"
 #include "Material.h"
+#include "Mesh.h"
 #include "GameObject.h"
 #include "Renderer.h"
 #include "SkinnedMeshRenderer.h"
+#include "LODGroup.h"
 #include "Texture.h"
 #include "time/Time.h"
+#include "math/Frustum.h"
+#include "container/RadixSort.h"
+#include <algorithm>
 
 namespace Viry3D
 {
 	List<Light*> Light::m_lights;
 	Color Light::m_ambient_color(0, 0, 0, 0);
+	BoundsTree Light::m_bounds_tree;
+	List<Light*> Light::m_unbounded_lights;
+	Vector<Light*> Light::m_shadow_lights;
+	Vector<int> Light::m_shadow_tile_sizes;
+	Vector<ShadowAtlas::Tile> Light::m_shadow_tiles;
 
 	void Light::SetAmbientColor(const Color& color)
 	{
@@ -38,8 +49,61 @@ namespace Viry3D
 		}
 	}
 
+	void Light::SortDirectionalFirst(Vector<Light*>& lights)
+	{
+		std::stable_partition(lights.begin(), lights.end(), [](Light* light) {
+			return light->GetType() == LightType::Directional;
+		});
+	}
+
+	// blend of logarithmic and uniform cascade splits
+	static const float SHADOW_CASCADE_SPLIT_LAMBDA = 0.75f;
+	// casters unchanged for more frames than this go to the static shadow layer
+	static const int STATIC_CASTER_FRAMES = 30;
+
+	// fnv-1a
+	static uint64_t HashBytes(uint64_t hash, const void* data, int size)
+	{
+		const uint8_t* bytes = (const uint8_t*) data;
+		for (int i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	static uint64_t HashCasters(uint64_t hash, const Vector<DrawItem>& items)
+	{
+		for (int i = 0; i < items.Size(); ++i)
+		{
+			Renderer* renderer = items[i].renderer;
+			uint32_t version = renderer->GetVersion();
+			hash = HashBytes(hash, &renderer, sizeof(renderer));
+			hash = HashBytes(hash, &version, sizeof(version));
+		}
+		return hash;
+	}
+
+	// scale clip xy into the viewport in shadow atlas
+	static Matrix4x4 ShadowViewportMatrix(const ShadowAtlas::Tile& viewport)
+	{
+		float atlas_size = (float) ShadowAtlas::GetSize();
+		Matrix4x4 m = Matrix4x4::Identity();
+		m.m00 = viewport.size / atlas_size;
+		m.m03 = (viewport.x * 2 + viewport.size) / atlas_size - 1;
+		m.m11 = viewport.size / atlas_size;
+		m.m13 = (viewport.y * 2 + viewport.size) / atlas_size - 1;
+		return m;
+	}
+
 	void Light::RenderShadowMaps()
 	{
+		Ref<Camera> camera = Camera::GetMainCamera();
+
+		// tiles in shadow atlas by screen importance
+		m_shadow_lights.Clear();
+		m_shadow_tile_sizes.Clear();
 		for (auto i : m_lights)
 		{
 			if (i->GetGameObject()->IsActiveInTree() &&
@@ -47,122 +111,398 @@ namespace Viry3D
 				(i->GetType() == LightType::Directional || i->GetType() == LightType::Spot) &&
 				i->IsShadowEnable())
 			{
-				List<Renderer*> renderers;
-				i->CullRenderers(Renderer::GetRenderers(), renderers);
-				i->UpdateViewUniforms();
-				i->Draw(renderers);
+				float importance = i->GetShadowImportance(camera);
+				if (importance > 0)
+				{
+					m_shadow_lights.Add(i);
+					m_shadow_tile_sizes.Add((int) (i->m_shadow_texture_size * importance));
+				}
+				else if (i->m_shadow_tile.size > 0)
+				{
+					i->m_shadow_tile = { 0, 0, 0 };
+					i->m_dirty = true;
+				}
 			}
 		}
-	}
 
-	void Light::CullRenderers(const List<Renderer*>& renderers, List<Renderer*>& result)
-	{
-		for (auto i : renderers)
+		ShadowAtlas::Allocate(m_shadow_tile_sizes, m_shadow_tiles);
+
+		for (int k = 0; k < m_shadow_lights.Size(); ++k)
 		{
-			int layer = i->GetGameObject()->GetLayer();
-			if (i->GetGameObject()->IsActiveInTree() && i->IsEnable() && ((1 << layer) & m_culling_mask) != 0 && i->IsCastShadow())
+			Light* i = m_shadow_lights[k];
+			const ShadowAtlas::Tile& tile = m_shadow_tiles[k];
+
+			// atlas tile and size are in shadow matrices of light uniforms
+			if (tile.x != i->m_shadow_tile.x || tile.y != i->m_shadow_tile.y || tile.size != i->m_shadow_tile.size ||
+				i->m_shadow_atlas_version != ShadowAtlas::GetVersion())
+			{
+				i->m_shadow_tile = tile;
+				i->m_shadow_atlas_version = ShadowAtlas::GetVersion();
+				i->m_dirty = true;
+			}
+
+			if (tile.size == 0)
 			{
-				result.AddLast(i);
+				continue;
 			}
+
+			{
+				// cascades follow the main camera, shadow matrices in light uniforms change every frame
+				bool cascaded = camera && i->IsShadowCascaded();
+				if (cascaded || i->m_shadow_cascade_active)
+				{
+					i->m_shadow_cascade_active = cascaded;
+					i->m_dirty = true;
+				}
+
+				if (cascaded)
+				{
+					i->UpdateCascades(camera);
+
+					for (int j = 0; j < i->m_shadow_cascade_count; ++j)
+					{
+						i->RenderShadowMap(j, i->m_cascade_view_matrices[j], i->m_cascade_projection_matrices[j], i->m_cascade_view_uniform_buffers[j]);
+					}
+
+					// shaders sampling by light view projection get the first cascade
+					i->UpdateViewUniforms(i->m_view_uniform_buffer, i->m_cascade_view_matrices[0], ShadowViewportMatrix(i->GetShadowViewport(0)) * i->m_cascade_projection_matrices[0]);
+				}
+				else
+				{
+					i->RenderShadowMap(-1, i->GetViewMatrix(), i->GetProjectionMatrix(), i->m_cascade_view_uniform_buffers[0]);
+
+					i->UpdateViewUniforms(i->m_view_uniform_buffer, i->GetViewMatrix(), ShadowViewportMatrix(i->GetShadowViewport(-1)) * i->GetProjectionMatrix());
+				}
+			}
+		}
+	}
+
+	float Light::GetShadowImportance(const Ref<Camera>& camera)
+	{
+		if (!camera || this->GetType() == LightType::Directional)
+		{
+			return 1.0f;
+		}
+
+		Frustum frustum(camera->GetProjectionMatrix() * camera->GetViewMatrix());
+		if (frustum.ContainsBounds(this->GetWorldBounds()) == ContainsResult::Out)
+		{
+			return 0.0f;
+		}
+
+		float distance = (this->GetTransform()->GetPosition() - camera->GetTransform()->GetPosition()).Magnitude();
+		if (distance <= m_range)
+		{
+			return 1.0f;
+		}
+
+		// projected range over half view height
+		float half_height;
+		if (camera->IsOrthographic())
+		{
+			half_height = camera->GetOrthographicSize();
+		}
+		else
+		{
+			half_height = distance * tanf(camera->GetFieldOfView() * 0.5f * Mathf::Deg2Rad);
 		}
-		result.Sort([](Renderer* a, Renderer* b) {
-			const auto& materials_a = a->GetMaterials();
-			int queue_a = 0;
-			for (int i = 0; i < materials_a.Size(); ++i)
+
+		return Mathf::Clamp(m_range / half_height, 0.0f, 1.0f);
+	}
+
+	ShadowAtlas::Tile Light::GetShadowViewport(int cascade) const
+	{
+		if (cascade < 0)
+		{
+			return m_shadow_tile;
+		}
+
+		// cascades in 2 x 2 grid from bottom left of the tile
+		int half = m_shadow_tile.size / 2;
+		return { m_shadow_tile.x + (cascade % 2) * half, m_shadow_tile.y + (cascade / 2) * half, half };
+	}
+
+	void Light::RenderShadowMap(int cascade, const Matrix4x4& view, const Matrix4x4& projection, filament::backend::UniformBufferHandle& view_uniform_buffer)
+	{
+		int slot = Mathf::Max(cascade, 0);
+
+		this->CullRenderers(m_draw_items, view, projection);
+
+		// light transform and projection are in matrices, caster transform, bounds, enable state and materials in versions,
+		// casters entering or leaving the frustum change the list
+		uint64_t base_stamp = 14695981039346656037ull;
+		int atlas_version = ShadowAtlas::GetVersion();
+		base_stamp = HashBytes(base_stamp, &cascade, sizeof(cascade));
+		base_stamp = HashBytes(base_stamp, &atlas_version, sizeof(atlas_version));
+		base_stamp = HashBytes(base_stamp, &m_shadow_tile, sizeof(m_shadow_tile));
+		base_stamp = HashBytes(base_stamp, &view, sizeof(view));
+		base_stamp = HashBytes(base_stamp, &projection, sizeof(projection));
+
+		uint64_t stamp = HashCasters(base_stamp, m_draw_items);
+		if (stamp == m_shadow_stamps[slot])
+		{
+			return;
+		}
+		m_shadow_stamps[slot] = stamp;
+
+		this->UpdateViewUniforms(view_uniform_buffer, view, projection);
+
+		if (m_static_shadow_cache)
+		{
+			m_static_draw_items.Clear();
+			m_dynamic_draw_items.Clear();
+
+			int frame = Time::GetFrameCount();
+			for (int i = 0; i < m_draw_items.Size(); ++i)
 			{
-				int queue = materials_a[i]->GetQueue();
-				if (queue_a < queue)
+				if (frame - m_draw_items[i].renderer->GetVersionFrame() > STATIC_CASTER_FRAMES)
+				{
+					m_static_draw_items.Add(m_draw_items[i]);
+				}
+				else
 				{
-					queue_a = queue;
+					m_dynamic_draw_items.Add(m_draw_items[i]);
 				}
 			}
-			const auto& materials_b = b->GetMaterials();
-			int queue_b = 0;
-			for (int i = 0; i < materials_b.Size(); ++i)
+
+			uint64_t static_stamp = HashCasters(base_stamp, m_static_draw_items);
+			if (static_stamp != m_static_shadow_stamps[slot])
 			{
-				int queue = materials_b[i]->GetQueue();
-				if (queue_b < queue)
+				m_static_shadow_stamps[slot] = static_stamp;
+				this->Draw(m_static_draw_items, view_uniform_buffer, cascade, true);
+			}
+
+			this->Draw(m_dynamic_draw_items, view_uniform_buffer, cascade, false);
+		}
+		else
+		{
+			this->Draw(m_draw_items, view_uniform_buffer, cascade, false);
+		}
+	}
+
+	bool Light::IsShadowCascaded()
+	{
+		return this->GetType() == LightType::Directional && m_shadow_cascade_count > 1;
+	}
+
+	void Light::UpdateCascades(const Ref<Camera>& camera)
+	{
+		const Matrix4x4& camera_projection = camera->GetProjectionMatrix();
+		Matrix4x4 inverse_view_projection = (camera_projection * camera->GetViewMatrix()).Inverse();
+		float near_clip = camera->GetNearClip();
+		float far_clip = Mathf::Max(Mathf::Min(camera->GetFarClip(), m_shadow_distance), near_clip);
+
+		// ndc z of a view depth, works for perspective and orthographic projection
+		auto depth_to_ndc = [&](float depth) {
+			float z = camera_projection.m22 * -depth + camera_projection.m23;
+			float w = camera_projection.m32 * -depth + camera_projection.m33;
+			return z / w;
+		};
+
+		Vector3 light_dir = this->GetTransform()->GetForward();
+		Vector3 light_up = this->GetTransform()->GetUp();
+		Matrix4x4 light_rotation = Matrix4x4::LookTo(Vector3(0, 0, 0), light_dir, light_up);
+		Matrix4x4 light_rotation_inverse = light_rotation.Inverse();
+		int cascade_size = m_shadow_tile.size / 2;
+
+		float split_near = near_clip;
+		for (int i = 0; i < m_shadow_cascade_count; ++i)
+		{
+			float t = (i + 1) / (float) m_shadow_cascade_count;
+			float split_uniform = near_clip + (far_clip - near_clip) * t;
+			float split_log = near_clip * powf(far_clip / near_clip, t);
+			float split_far = Mathf::Lerp(split_uniform, split_log, SHADOW_CASCADE_SPLIT_LAMBDA);
+
+			// bounding sphere of the frustum slice, its size does not change when the camera rotates
+			Vector3 corners[8];
+			Vector3 center(0, 0, 0);
+			for (int j = 0; j < 8; ++j)
+			{
+				Vector3 ndc((j & 1) ? 1.0f : -1.0f, (j & 2) ? 1.0f : -1.0f, depth_to_ndc((j & 4) ? split_far : split_near));
+				corners[j] = inverse_view_projection.MultiplyPoint(ndc);
+				center += corners[j];
+			}
+			center /= 8;
+
+			float radius = 0;
+			for (int j = 0; j < 8; ++j)
+			{
+				radius = Mathf::Max(radius, (corners[j] - center).Magnitude());
+			}
+			radius = ceilf(radius * 16) / 16;
+
+			// snap center to shadow texels in light space, so moving camera does not shimmer shadow edges
+			float texel = radius * 2 / cascade_size;
+			Vector3 center_light = light_rotation.MultiplyPoint3x4(center);
+			center_light.x = floorf(center_light.x / texel) * texel;
+			center_light.y = floorf(center_light.y / texel) * texel;
+			center = light_rotation_inverse.MultiplyPoint3x4(center_light);
+
+			// receiver sphere at the far end of light clip range, casters in front of it are kept,
+			// casters outside the box around the sphere are culled
+			float distance = Mathf::Max(m_far_clip - radius, m_near_clip + radius);
+			Vector3 eye = center - light_dir * distance;
+
+			m_cascade_view_matrices[i] = Matrix4x4::LookTo(eye, light_dir, light_up);
+			m_cascade_projection_matrices[i] = Matrix4x4::Ortho(-radius, radius, -radius, radius, m_near_clip, distance + radius);
+			m_light_uniforms.shadow_cascade_spheres[i] = Vector4(center, radius * radius);
+
+			split_near = split_far;
+		}
+	}
+
+	void Light::CullRenderers(Vector<DrawItem>& result, const Matrix4x4& view, const Matrix4x4& projection)
+	{
+		Frustum frustum(projection * view);
+		float inv_far = 1.0f / m_far_clip;
+
+		result.Clear();
+
+		auto is_caster = [this](Renderer* renderer) {
+			int layer = renderer->GetGameObject()->GetLayer();
+			// lod groups cast shadows of the level last selected by a camera
+			LODGroup* lod_group = renderer->GetLODGroup();
+			return renderer->GetGameObject()->IsActiveInTree() && renderer->IsEnable() && ((1 << layer) & m_culling_mask) != 0 && renderer->IsCastShadow() &&
+				(lod_group == nullptr || lod_group->IsRendererInCurrentLOD(renderer));
+		};
+
+		const auto& unbounded_renderers = Renderer::GetUnboundedRenderers();
+		for (auto i : unbounded_renderers)
+		{
+			if (is_caster(i))
+			{
+				float depth = -view.MultiplyPoint3x4(i->GetTransform()->GetPosition()).z * inv_far;
+				result.Add({ i->GetSortKey(depth), i });
+			}
+		}
+
+		Renderer::GetBoundsTree().Query(frustum, [&](void* user_data, bool inside) {
+			Renderer* i = (Renderer*) user_data;
+			if (is_caster(i))
+			{
+				if (!inside && frustum.ContainsBounds(i->GetWorldBounds()) == ContainsResult::Out)
 				{
-					queue_b = queue;
+					return;
 				}
+
+				float depth = -view.MultiplyPoint3x4(i->GetWorldBounds().GetCenter()).z * inv_far;
+				result.Add({ i->GetSortKey(depth), i });
 			}
-			return queue_a < queue_b;
 		});
+
+		RadixSort::Sort(result, m_sort_items);
 	}
 
-	void Light::UpdateViewUniforms()
+	void Light::UpdateViewUniforms(filament::backend::UniformBufferHandle& uniform_buffer, const Matrix4x4& view, const Matrix4x4& projection)
 	{
 		auto& driver = Engine::Instance()->GetDriverApi();
-		if (!m_view_uniform_buffer)
+		if (!uniform_buffer)
 		{
-			m_view_uniform_buffer = driver.createUniformBuffer(sizeof(ViewUniforms), filament::backend::BufferUsage::DYNAMIC);
+			uniform_buffer = driver.createUniformBuffer(sizeof(ViewUniforms), filament::backend::BufferUsage::DYNAMIC);
 		}
 
 		ViewUniforms view_uniforms;
-		view_uniforms.view_matrix = this->GetViewMatrix();
-		view_uniforms.projection_matrix = this->GetProjectionMatrix();
-		view_uniforms.camera_pos = this->GetTransform()->GetPosition();
+		view_uniforms.view_matrix = view;
+		view_uniforms.projection_matrix = projection;
+		view_uniforms.camera_pos = view.Inverse().MultiplyPoint3x4(Vector3(0, 0, 0));
 
         // map depth range -1 ~ 1 to 0 ~ 1 for d3d
         if (Engine::Instance()->GetBackend() == filament::backend::Backend::D3D11)
         {
-            view_uniforms.projection_matrix = Matrix4x4::ProjectionDepthMapD3D11() * this->GetProjectionMatrix();
+            view_uniforms.projection_matrix = Matrix4x4::ProjectionDepthMapD3D11() * projection;
         }
 
 		void* buffer = driver.allocate(sizeof(ViewUniforms));
 		Memory::Copy(buffer, &view_uniforms, sizeof(ViewUniforms));
-		driver.loadUniformBuffer(m_view_uniform_buffer, filament::backend::BufferDescriptor(buffer, sizeof(ViewUniforms)));
+		driver.loadUniformBuffer(uniform_buffer, filament::backend::BufferDescriptor(buffer, sizeof(ViewUniforms)));
 	}
 
-	void Light::Draw(const List<Renderer*>& renderers)
+	void Light::Draw(const Vector<DrawItem>& items, const filament::backend::UniformBufferHandle& view_uniform_buffer, int cascade, bool static_layer)
 	{
 		auto& driver = Engine::Instance()->GetDriverApi();
 
-		int target_width = m_shadow_texture_size;
-		int target_height = m_shadow_texture_size;
-
 		filament::backend::RenderTargetHandle target;
 		filament::backend::RenderPassParams params;
 		params.flags.clear = filament::backend::TargetBufferFlags::NONE;
 		params.flags.discardStart = filament::backend::TargetBufferFlags::NONE;
 		params.flags.discardEnd = filament::backend::TargetBufferFlags::NONE;
 
-		if (!m_render_target)
+		ShadowAtlas::Tile viewport = this->GetShadowViewport(cascade);
+		int target_size;
+
+		if (static_layer)
 		{
-			filament::backend::TargetBufferFlags target_flags = filament::backend::TargetBufferFlags::NONE;
-			filament::backend::TargetBufferInfo color = { };
-			filament::backend::TargetBufferInfo depth = { };
-			filament::backend::TargetBufferInfo stencil = { };
+			// static layer has the layout of the light tile
+			if (m_static_shadow_texture && m_static_shadow_texture->GetWidth() != m_shadow_tile.size)
+			{
+				driver.destroyRenderTarget(m_static_render_target);
+				m_static_render_target.clear();
+				m_static_shadow_texture.reset();
+			}
 
-			target_flags |= filament::backend::TargetBufferFlags::DEPTH;
-			depth.handle = m_shadow_texture->GetTexture();
+			if (!m_static_shadow_texture)
+			{
+				m_static_shadow_texture = Texture::CreateRenderTexture(
+					m_shadow_tile.size,
+					m_shadow_tile.size,
+					Texture::SelectDepthFormat(),
+					FilterMode::Nearest,
+					SamplerAddressMode::ClampToEdge);
+
+				filament::backend::TargetBufferInfo color = { };
+				filament::backend::TargetBufferInfo depth = { };
+				filament::backend::TargetBufferInfo stencil = { };
+				depth.handle = m_static_shadow_texture->GetTexture();
+
+				m_static_render_target = driver.createRenderTarget(
+					filament::backend::TargetBufferFlags::DEPTH,
+					m_shadow_tile.size,
+					m_shadow_tile.size,
+					1,
+					color,
+					depth,
+					stencil);
+			}
 
-			m_render_target = driver.createRenderTarget(
-				target_flags,
-				target_width,
-				target_height,
-				1,
-				color,
-				depth,
-				stencil);
+			target = m_static_render_target;
+			target_size = m_shadow_tile.size;
+			viewport.x -= m_shadow_tile.x;
+			viewport.y -= m_shadow_tile.y;
+		}
+		else
+		{
+			target = ShadowAtlas::GetRenderTarget();
+			target_size = ShadowAtlas::GetSize();
 		}
-		target = m_render_target;
 
-		params.flags.clear = filament::backend::TargetBufferFlags::DEPTH;
 		params.flags.discardStart |= filament::backend::TargetBufferFlags::COLOR;
 
-		params.viewport.left = 0;
-		params.viewport.bottom = 0;
-		params.viewport.width = (uint32_t) target_width;
-		params.viewport.height = (uint32_t) target_height;
+		params.viewport.left = viewport.x;
+		params.viewport.bottom = viewport.y;
+		params.viewport.width = (uint32_t) viewport.size;
+		params.viewport.height = (uint32_t) viewport.size;
 
 		driver.beginRenderPass(target, params);
 
-		driver.bindUniformBuffer((size_t) Shader::BindingPoint::PerView, m_view_uniform_buffer);
+		m_render_state.Reset();
+
+		// dynamic casters are drawn over the cached static layer, which writes every texel of the tile.
+		// metal, d3d11 and vulkan clear the whole attachment whatever the viewport is, so the viewport is cleared
+		// by a draw to keep tiles of other lights in the atlas and other cascades in the static layer
+		if (!static_layer && m_static_shadow_cache && m_static_shadow_texture)
+		{
+			this->DrawStaticLayer();
+		}
+		else
+		{
+			this->ClearShadowTile(target_size);
+		}
+
+		m_render_state.BindUniformBuffer((size_t) Shader::BindingPoint::PerView, view_uniform_buffer);
 
-		for (auto i : renderers)
+		for (int i = 0; i < items.Size(); ++i)
 		{
-			this->DrawRenderer(i);
+			this->DrawRenderer(items[i].renderer, target_size);
 		}
 
 		driver.endRenderPass();
@@ -170,19 +510,84 @@ namespace Viry3D
 		driver.flush();
 	}
 
-	void Light::DrawRenderer(Renderer* renderer)
+	void Light::DrawStaticLayer()
+	{
+		auto& driver = Engine::Instance()->GetDriverApi();
+
+		if (!m_shadow_copy_material)
+		{
+			m_shadow_copy_material = RefMake<Material>(Shader::Find("ShadowCopy"));
+		}
+		// frag coord of the tile in atlas to texel of static layer, frag coord is from top left except on gl
+		int atlas_size = ShadowAtlas::GetSize();
+		Vector4 offset((float) m_shadow_tile.x, (float) m_shadow_tile.y, 0, 0);
+		if (Engine::Instance()->GetBackend() != filament::backend::Backend::OPENGL)
+		{
+			offset.y = (float) (atlas_size - m_shadow_tile.y - m_shadow_tile.size);
+		}
+
+		m_shadow_copy_material->SetTexture(MaterialProperty::TEXTURE, m_static_shadow_texture);
+		m_shadow_copy_material->SetVector("u_texel_offset", offset);
+		m_shadow_copy_material->Prepare();
+
+		const auto& shader = m_shadow_copy_material->GetShader();
+		const auto& primitive = Mesh::GetSharedQuadMesh()->GetPrimitives()[0];
+
+		m_shadow_copy_material->SetScissor(atlas_size, atlas_size, m_render_state);
+		m_shadow_copy_material->Bind(shader, 0, m_render_state);
+
+		driver.draw(shader->GetPass(0).pipeline, primitive);
+		Time::SetDrawCall(Time::GetDrawCall() + 1);
+	}
+
+	void Light::ClearShadowTile(int target_size)
 	{
 		auto& driver = Engine::Instance()->GetDriverApi();
 
-		driver.bindUniformBuffer((size_t) Shader::BindingPoint::PerRenderer, renderer->GetTransformUniformBuffer());
+		if (!m_shadow_clear_material)
+		{
+			m_shadow_clear_material = RefMake<Material>(Shader::Find("ShadowClear"));
+		}
+		m_shadow_clear_material->Prepare();
+
+		const auto& shader = m_shadow_clear_material->GetShader();
+		const auto& primitive = Mesh::GetSharedQuadMesh()->GetPrimitives()[0];
+
+		m_shadow_clear_material->SetScissor(target_size, target_size, m_render_state);
+		m_shadow_clear_material->Bind(shader, 0, m_render_state);
+
+		driver.draw(shader->GetPass(0).pipeline, primitive);
+		Time::SetDrawCall(Time::GetDrawCall() + 1);
+	}
+
+	void Light::DrawRenderer(Renderer* renderer, int target_size)
+	{
+		auto& driver = Engine::Instance()->GetDriverApi();
+
+		m_render_state.BindUniformBufferRange((size_t) Shader::BindingPoint::PerRenderer, renderer->GetUniformBuffer(), renderer->GetUniformOffset(), sizeof(RendererUniforms));
 
 		SkinnedMeshRenderer* skin = dynamic_cast<SkinnedMeshRenderer*>(renderer);
 		if (skin && skin->GetBonesUniformBuffer())
 		{
-			driver.bindUniformBuffer((size_t) Shader::BindingPoint::PerRendererBones, skin->GetBonesUniformBuffer());
+			m_render_state.BindUniformBuffer((size_t) Shader::BindingPoint::PerRendererBones, skin->GetBonesUniformBuffer());
+		}
+
+		bool skin_on = skin && skin->GetBonePaths().Size() > 0;
+		Ref<Shader>& shadow_shader = skin_on ? m_shadow_skin_shader : m_shadow_shader;
+		if (!shadow_shader)
+		{
+			if (skin_on)
+			{
+				shadow_shader = Shader::Find("ShadowMap", { "SKIN_ON" });
+			}
+			else
+			{
+				shadow_shader = Shader::Find("ShadowMap");
+			}
 		}
 
 		const auto& materials = renderer->GetMaterials();
+		const auto& primitives = renderer->GetDepthPrimitives();
 		for (int i = 0; i < materials.Size(); ++i)
 		{
 			auto& material = materials[i];
@@ -190,7 +595,6 @@ namespace Viry3D
 			{
 				filament::backend::RenderPrimitiveHandle primitive;
 
-				auto primitives = renderer->GetPrimitives();
 				if (i < primitives.Size())
 				{
 					primitive = primitives[i];
@@ -202,26 +606,16 @@ namespace Viry3D
 
 				if (primitive)
 				{
-					const auto& shader = material->GetShader(renderer->GetShaderKey(i));
+					const auto& shader = renderer->GetShader(i);
 
-					material->SetScissor(m_shadow_texture_size, m_shadow_texture_size);
+					material->SetScissor(target_size, target_size, m_render_state);
 
 					for (int j = 0; j < shader->GetPassCount(); ++j)
 					{
 						if (shader->GetPass(j).queue <= (int) Shader::Queue::AlphaTest &&
 							shader->GetPass(j).pipeline.rasterState.depthWrite)
 						{
-							material->Bind(shader, j);
-
-							Ref<Shader> shadow_shader;
-							if (skin && skin->GetBonePaths().Size() > 0)
-							{
-								shadow_shader = Shader::Find("ShadowMap", { "SKIN_ON" });
-							}
-							else
-							{
-								shadow_shader = Shader::Find("ShadowMap");
-							}
+							material->Bind(shader, j, m_render_state);
 
 							const auto& pipeline = shadow_shader->GetPass(0).pipeline;
 							driver.draw(pipeline, primitive);
@@ -242,15 +636,22 @@ namespace Viry3D
 		m_spot_angle(30.0f),
 		m_shadow_enable(false),
 		m_shadow_texture_size(0),
+		m_shadow_tile({ 0, 0, 0 }),
+		m_shadow_atlas_version(-1),
 		m_shadow_strength(1.0f),
 		m_shadow_z_bias(0.0001f),
 		m_shadow_slope_bias(0.0001f),
+		m_shadow_cascade_count(1),
+		m_shadow_distance(150),
+		m_shadow_cascade_active(false),
+		m_static_shadow_cache(false),
 		m_near_clip(0.3f),
 		m_far_clip(1000),
 		m_orthographic_size(1),
 		m_view_matrix_dirty(true),
 		m_projection_matrix_dirty(true),
-		m_culling_mask(0xffffffff)
+		m_culling_mask(0xffffffff),
+		m_bounds_proxy(BoundsTree::NullNode)
     {
 		m_lights.AddLast(this);
 
@@ -273,17 +674,27 @@ namespace Viry3D
 			m_light_uniform_buffer.clear();
 		}
 
-		if (m_sampler_group)
+		for (int i = 0; i < LightFragmentUniforms::MAX_SHADOW_CASCADE_COUNT; ++i)
+		{
+			if (m_cascade_view_uniform_buffers[i])
+			{
+				driver.destroyUniformBuffer(m_cascade_view_uniform_buffers[i]);
+				m_cascade_view_uniform_buffers[i].clear();
+			}
+		}
+
+		if (m_static_render_target)
 		{
-			driver.destroySamplerGroup(m_sampler_group);
-			m_sampler_group.clear();
+			driver.destroyRenderTarget(m_static_render_target);
+			m_static_render_target.clear();
 		}
 
-		if (m_render_target)
+		if (m_bounds_proxy != BoundsTree::NullNode)
 		{
-			driver.destroyRenderTarget(m_render_target);
-			m_render_target.clear();
+			m_bounds_tree.DestroyProxy(m_bounds_proxy);
+			m_bounds_proxy = BoundsTree::NullNode;
 		}
+		m_unbounded_lights.Remove(this);
 
 		m_lights.Remove(this);
     }
@@ -294,6 +705,96 @@ namespace Viry3D
 		m_view_matrix_dirty = true;
 	}
 
+	void Light::OnEnable(bool enable)
+	{
+		// transform dirty is not notified to disabled components
+		m_dirty = true;
+		m_view_matrix_dirty = true;
+	}
+
+	Bounds Light::GetWorldBounds()
+	{
+		if (this->GetType() == LightType::Directional)
+		{
+			return Bounds();
+		}
+
+		Vector3 position = this->GetTransform()->GetPosition();
+		Vector3 extents(m_range, m_range, m_range);
+		return Bounds(position - extents, position + extents);
+	}
+
+	bool Light::Intersects(const Bounds& bounds)
+	{
+		if (this->GetType() == LightType::Directional)
+		{
+			return true;
+		}
+
+		Vector3 position = this->GetTransform()->GetPosition();
+
+		// sphere vs box by closest point
+		Vector3 min = bounds.Min();
+		Vector3 max = bounds.Max();
+		Vector3 closest(
+			Mathf::Clamp(position.x, min.x, max.x),
+			Mathf::Clamp(position.y, min.y, max.y),
+			Mathf::Clamp(position.z, min.z, max.z));
+		if ((closest - position).SqrMagnitude() > m_range * m_range)
+		{
+			return false;
+		}
+
+		if (this->GetType() == LightType::Spot)
+		{
+			// cone vs bounding sphere of box
+			Vector3 center = bounds.GetCenter();
+			float radius = bounds.GetSize().Magnitude() * 0.5f;
+			Vector3 v = center - position;
+			float along = v.Dot(this->GetTransform()->GetForward());
+			float perp = sqrtf(Mathf::Max(v.SqrMagnitude() - along * along, 0.0f));
+			float half_angle = m_spot_angle * 0.5f * Mathf::Deg2Rad;
+
+			if (along < -radius || cosf(half_angle) * perp - sinf(half_angle) * along > radius)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void Light::UpdateBoundsProxy()
+	{
+		if (this->GetType() != LightType::Directional)
+		{
+			Bounds bounds = this->GetWorldBounds();
+
+			if (m_bounds_proxy == BoundsTree::NullNode)
+			{
+				m_bounds_proxy = m_bounds_tree.CreateProxy(bounds, this);
+				m_unbounded_lights.Remove(this);
+			}
+			else
+			{
+				m_bounds_tree.MoveProxy(m_bounds_proxy, bounds);
+			}
+		}
+		else
+		{
+			if (m_bounds_proxy != BoundsTree::NullNode)
+			{
+				m_bounds_tree.DestroyProxy(m_bounds_proxy);
+				m_bounds_proxy = BoundsTree::NullNode;
+			}
+
+			if (!m_unbounded_lights.Contains(this))
+			{
+				m_unbounded_lights.AddLast(this);
+			}
+		}
+	}
+
 	void Light::SetType(LightType type)
 	{
         if (m_type != type)
@@ -348,32 +849,34 @@ namespace Viry3D
 
 	void Light::SetShadowTextureSize(int size)
 	{
-		auto& driver = Engine::Instance()->GetDriverApi();
-
 		if (m_shadow_texture_size != size)
 		{
 			m_shadow_texture_size = size;
-			m_shadow_texture = Texture::CreateRenderTexture(
-				m_shadow_texture_size,
-				m_shadow_texture_size,
-				Texture::SelectDepthFormat(),
-				FilterMode::Linear,
-				SamplerAddressMode::ClampToEdge);
-
-			if (!m_sampler_group)
-			{
-				m_sampler_group = driver.createSamplerGroup(1);
-			}
+			m_projection_matrix_dirty = true;
 
-			filament::backend::SamplerGroup samplers(1);
-			samplers.setSampler(0, m_shadow_texture->GetTexture(), m_shadow_texture->GetSampler());
-			driver.updateSamplerGroup(m_sampler_group, std::move(samplers));
+			Memory::Zero(m_shadow_stamps, sizeof(m_shadow_stamps));
+			Memory::Zero(m_static_shadow_stamps, sizeof(m_static_shadow_stamps));
+		}
+	}
 
-			if (m_render_target)
-			{
-				driver.destroyRenderTarget(m_render_target);
-				m_render_target.clear();
-			}
+	void Light::SetShadowCascadeCount(int count)
+	{
+		m_shadow_cascade_count = Mathf::Clamp(count, 1, LightFragmentUniforms::MAX_SHADOW_CASCADE_COUNT);
+	}
+
+	void Light::SetShadowDistance(float distance)
+	{
+		m_shadow_distance = distance;
+	}
+
+	void Light::EnableStaticShadowCache(bool enable)
+	{
+		if (m_static_shadow_cache != enable)
+		{
+			m_static_shadow_cache = enable;
+
+			Memory::Zero(m_shadow_stamps, sizeof(m_shadow_stamps));
+			Memory::Zero(m_static_shadow_stamps, sizeof(m_static_shadow_stamps));
 		}
 	}
 
@@ -409,6 +912,7 @@ namespace Viry3D
         if (!Mathf::FloatEqual(m_near_clip, clip))
         {
             m_near_clip = clip;
+            m_dirty = true;
             m_projection_matrix_dirty = true;
         }
 	}
@@ -418,6 +922,7 @@ namespace Viry3D
         if (!Mathf::FloatEqual(m_far_clip, clip))
         {
             m_far_clip = clip;
+            m_dirty = true;
             m_projection_matrix_dirty = true;
         }
 	}
@@ -427,6 +932,7 @@ namespace Viry3D
         if (!Mathf::FloatEqual(m_orthographic_size, size))
         {
             m_orthographic_size = size;
+            m_dirty = true;
             m_projection_matrix_dirty = true;
         }
 	}
@@ -483,13 +989,15 @@ namespace Viry3D
 		}
 		m_dirty = false;
 
+		this->UpdateBoundsProxy();
+
 		auto& driver = Engine::Instance()->GetDriverApi();
 		if (!m_light_uniform_buffer)
 		{
 			m_light_uniform_buffer = driver.createUniformBuffer(sizeof(LightFragmentUniforms), filament::backend::BufferUsage::DYNAMIC);
 		}
 
-		LightFragmentUniforms light_uniforms;
+		LightFragmentUniforms& light_uniforms = m_light_uniforms;
 		light_uniforms.ambient_color = this->GetAmbientColor();
 		if (this->GetType() == LightType::Directional)
 		{
@@ -514,7 +1022,34 @@ namespace Viry3D
 			light_uniforms.light_atten.y = 1.0f / (light_uniforms.light_atten.x - cos(this->GetSpotAngle() / 4 * Mathf::Deg2Rad));
 			light_uniforms.spot_light_dir = -this->GetTransform()->GetForward();
 		}
-		light_uniforms.shadow_params = Vector4(m_shadow_strength, m_shadow_z_bias, m_shadow_slope_bias, 1.0f / m_shadow_texture_size * 3);
+		// no tile in shadow atlas, nothing is shadowed
+		float shadow_strength = m_shadow_tile.size > 0 ? m_shadow_strength : 0.0f;
+		float atlas_size = (float) ShadowAtlas::GetSize();
+		light_uniforms.shadow_params = Vector4(shadow_strength, m_shadow_z_bias, m_shadow_slope_bias, 1.0f / atlas_size * 3);
+
+		// map depth range -1 ~ 1 to 0 ~ 1 for d3d, same as shadow map rendering
+		Matrix4x4 depth_map = Matrix4x4::Identity();
+		if (Engine::Instance()->GetBackend() == filament::backend::Backend::D3D11)
+		{
+			depth_map = Matrix4x4::ProjectionDepthMapD3D11();
+		}
+		if (m_shadow_cascade_active)
+		{
+			// cascade spheres are set by UpdateCascades
+			for (int i = 0; i < m_shadow_cascade_count; ++i)
+			{
+				ShadowAtlas::Tile viewport = this->GetShadowViewport(i);
+				light_uniforms.shadow_matrices[i] = depth_map * m_cascade_projection_matrices[i] * m_cascade_view_matrices[i];
+				light_uniforms.shadow_atlas_rects[i] = Vector4(viewport.size / atlas_size, viewport.size / atlas_size, viewport.x / atlas_size, viewport.y / atlas_size);
+			}
+			light_uniforms.shadow_cascade_params = Vector4((float) m_shadow_cascade_count, 0, 0, 0);
+		}
+		else
+		{
+			light_uniforms.shadow_matrices[0] = depth_map * this->GetProjectionMatrix() * this->GetViewMatrix();
+			light_uniforms.shadow_atlas_rects[0] = Vector4(m_shadow_tile.size / atlas_size, m_shadow_tile.size / atlas_size, m_shadow_tile.x / atlas_size, m_shadow_tile.y / atlas_size);
+			light_uniforms.shadow_cascade_params = Vector4(1, 0, 0, 0);
+		}
 
 		void* buffer = driver.allocate(sizeof(LightFragmentUniforms));
 		Memory::Copy(buffer, &light_uniforms, sizeof(LightFragmentUniforms));
@@ -21,6 +21,10 @@
 #include "container/List.h"
 #include "Color.h"
 #include "math/Matrix4x4.h"
+#include "math/BoundsTree.h"
+#include "Renderer.h"
+#include "RenderState.h"
+#include "ShadowAtlas.h"
 #include "private/backend/DriverApi.h"
 
 namespace Viry3D
@@ -32,8 +36,8 @@ namespace Viry3D
         Point,
     };
 
-	class Renderer;
 	class Texture;
+	class Camera;
     
     class Light : public Component
     {
@@ -42,6 +46,12 @@ namespace Viry3D
 		static const Color& GetAmbientColor() { return m_ambient_color; }
 		static void SetAmbientColor(const Color& color);
 		static void RenderShadowMaps();
+		// bvh of point and spot lights by range, user data is Light*
+		static const BoundsTree& GetBoundsTree() { return m_bounds_tree; }
+		// directional lights are not in the tree
+		static const List<Light*>& GetUnboundedLights() { return m_unbounded_lights; }
+		// move directional lights to the front, order of lights of the same kind is kept
+		static void SortDirectionalFirst(Vector<Light*>& lights);
 		Light();
         virtual ~Light();
 		LightType GetType() const { return m_type; }
@@ -56,31 +66,59 @@ namespace Viry3D
 		void SetSpotAngle(float angle);
 		bool IsShadowEnable() const { return m_shadow_enable; }
 		void EnableShadow(bool enable);
+		// size of the tile in shadow atlas when the light covers the main camera view,
+		// smaller on screen gets smaller tile
 		void SetShadowTextureSize(int size);
-		const Ref<Texture>& GetShadowTexture() const { return m_shadow_texture; }
+		// shadow atlas shared by all lights
+		const Ref<Texture>& GetShadowTexture() const { return ShadowAtlas::GetTexture(); }
+		const ShadowAtlas::Tile& GetShadowTile() const { return m_shadow_tile; }
 		void SetShadowStrength(float strength);
 		void SetShadowZBias(float bias);
 		void SetShadowSlopeBias(float bias);
+		int GetShadowCascadeCount() const { return m_shadow_cascade_count; }
+		// directional light only, 2 ~ 4 cascades split the main camera frustum up to shadow distance,
+		// each cascade takes a quarter of the light tile in shadow atlas
+		void SetShadowCascadeCount(int count);
+		float GetShadowDistance() const { return m_shadow_distance; }
+		void SetShadowDistance(float distance);
+		bool IsStaticShadowCacheEnable() const { return m_static_shadow_cache; }
+		// casters unchanged for some frames are cached in a static layer, re-rendered only when they change,
+		// the rest are drawn over a copy of it when the shadow map is updated
+		void EnableStaticShadowCache(bool enable);
 		void SetNearClip(float clip);
 		void SetFarClip(float clip);
 		void SetOrthographicSize(float size);
+		Bounds GetWorldBounds();
+		// range sphere and spot cone reach bounds, directional lights reach everything
+		bool Intersects(const Bounds& bounds);
 		uint32_t GetCullingMask() const { return m_culling_mask; }
 		void SetCullingMask(uint32_t mask);
 		const filament::backend::UniformBufferHandle& GetViewUniformBuffer() const { return m_view_uniform_buffer; }
 		const filament::backend::UniformBufferHandle& GetLightUniformBuffer() const { return m_light_uniform_buffer; }
-		const filament::backend::SamplerGroupHandle& GetSamplerGroup() const { return m_sampler_group; }
+		const filament::backend::SamplerGroupHandle& GetSamplerGroup() const { return ShadowAtlas::GetSamplerGroup(); }
+		const LightFragmentUniforms& GetLightUniforms() const { return m_light_uniforms; }
 
 	protected:
 		virtual void OnTransformDirty();
+		virtual void OnEnable(bool enable);
 
 	private:
 		const Matrix4x4& GetViewMatrix();
 		const Matrix4x4& GetProjectionMatrix();
-		void CullRenderers(const List<Renderer*>& renderers, List<Renderer*>& result);
-		void UpdateViewUniforms();
-		void Draw(const List<Renderer*>& renderers);
-		void DrawRenderer(Renderer* renderer);
+		bool IsShadowCascaded();
+		float GetShadowImportance(const Ref<Camera>& camera);
+		// tile of the whole shadow when cascade is -1, or quarter of the cascade
+		ShadowAtlas::Tile GetShadowViewport(int cascade) const;
+		void UpdateCascades(const Ref<Camera>& camera);
+		void RenderShadowMap(int cascade, const Matrix4x4& view, const Matrix4x4& projection, filament::backend::UniformBufferHandle& view_uniform_buffer);
+		void CullRenderers(Vector<DrawItem>& result, const Matrix4x4& view, const Matrix4x4& projection);
+		void UpdateViewUniforms(filament::backend::UniformBufferHandle& uniform_buffer, const Matrix4x4& view, const Matrix4x4& projection);
+		void Draw(const Vector<DrawItem>& items, const filament::backend::UniformBufferHandle& view_uniform_buffer, int cascade, bool static_layer);
+		void DrawStaticLayer();
+		void ClearShadowTile(int target_size);
+		void DrawRenderer(Renderer* renderer, int target_size);
 		void Prepare();
+		void UpdateBoundsProxy();
 
 	private:
 		friend class Camera;
@@ -88,6 +126,11 @@ namespace Viry3D
     private:
 		static List<Light*> m_lights;
 		static Color m_ambient_color;
+		static BoundsTree m_bounds_tree;
+		static List<Light*> m_unbounded_lights;
+		static Vector<Light*> m_shadow_lights;
+		static Vector<int> m_shadow_tile_sizes;
+		static Vector<ShadowAtlas::Tile> m_shadow_tiles;
 		bool m_dirty;
         LightType m_type;
 		Color m_color;
@@ -96,10 +139,27 @@ namespace Viry3D
 		float m_spot_angle;
 		bool m_shadow_enable;
 		int m_shadow_texture_size;
-		Ref<Texture> m_shadow_texture;
+		ShadowAtlas::Tile m_shadow_tile;
+		int m_shadow_atlas_version;
 		float m_shadow_strength;
 		float m_shadow_z_bias;
 		float m_shadow_slope_bias;
+		int m_shadow_cascade_count;
+		float m_shadow_distance;
+		bool m_shadow_cascade_active;
+		Matrix4x4 m_cascade_view_matrices[LightFragmentUniforms::MAX_SHADOW_CASCADE_COUNT];
+		Matrix4x4 m_cascade_projection_matrices[LightFragmentUniforms::MAX_SHADOW_CASCADE_COUNT];
+		filament::backend::UniformBufferHandle m_cascade_view_uniform_buffers[LightFragmentUniforms::MAX_SHADOW_CASCADE_COUNT];
+		// version stamps of light and casters per cascade, 0 forces rendering
+		uint64_t m_shadow_stamps[LightFragmentUniforms::MAX_SHADOW_CASCADE_COUNT];
+		uint64_t m_static_shadow_stamps[LightFragmentUniforms::MAX_SHADOW_CASCADE_COUNT];
+		bool m_static_shadow_cache;
+		Ref<Texture> m_static_shadow_texture;
+		filament::backend::RenderTargetHandle m_static_render_target;
+		Ref<Material> m_shadow_copy_material;
+		Ref<Material> m_shadow_clear_material;
+		Vector<DrawItem> m_static_draw_items;
+		Vector<DrawItem> m_dynamic_draw_items;
 		float m_near_clip;
 		float m_far_clip;
 		float m_orthographic_size;
@@ -110,7 +170,12 @@ namespace Viry3D
 		uint32_t m_culling_mask;
 		filament::backend::UniformBufferHandle m_view_uniform_buffer;
 		filament::backend::UniformBufferHandle m_light_uniform_buffer;
-		filament::backend::SamplerGroupHandle m_sampler_group;
-		filament::backend::RenderTargetHandle m_render_target;
+		LightFragmentUniforms m_light_uniforms;
+		int m_bounds_proxy;
+		Vector<DrawItem> m_draw_items;
+		Vector<DrawItem> m_sort_items;
+		RenderState m_render_state;
+		Ref<Shader> m_shadow_shader;
+		Ref<Shader> m_shadow_skin_shader;
     };
 }
@@ -0,0 +1,202 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "LightClusters.h"
+#include "Light.h"
+#include "Engine.h"
+#include "GameObject.h"
+#include "Transform.h"
+#include "math/Frustum.h"
+#include "memory/Memory.h"
+
+namespace Viry3D
+{
+	bool LightClusters::IsSupported()
+	{
+		return !(Engine::Instance()->GetBackend() == filament::backend::Backend::OPENGL &&
+			Engine::Instance()->GetShaderModel() == filament::backend::ShaderModel::GL_ES_20);
+	}
+
+	LightClusters::LightClusters()
+	{
+		Memory::Zero(&m_uniforms, sizeof(m_uniforms));
+	}
+
+	LightClusters::~LightClusters()
+	{
+		if (m_uniform_buffer)
+		{
+			auto& driver = Engine::Instance()->GetDriverApi();
+			driver.destroyUniformBuffer(m_uniform_buffer);
+			m_uniform_buffer.clear();
+		}
+	}
+
+	void LightClusters::Update(const Matrix4x4& view, const Matrix4x4& projection, float near_clip, float far_clip, uint32_t culling_mask)
+	{
+		auto& driver = Engine::Instance()->GetDriverApi();
+		if (!m_uniform_buffer)
+		{
+			m_uniform_buffer = driver.createUniformBuffer(sizeof(ClusterLightUniforms), filament::backend::BufferUsage::DYNAMIC);
+		}
+
+		m_clustered_lights.Clear();
+		m_pass_lights.Clear();
+
+		Frustum frustum(projection * view);
+
+		const auto& lights = Light::GetLights();
+		for (auto i : lights)
+		{
+			if (!i->GetGameObject()->IsActiveInTree() || !i->IsEnable() || (i->GetCullingMask() & culling_mask) == 0)
+			{
+				continue;
+			}
+
+			// range of local light does not reach the view
+			if (i->GetType() != LightType::Directional && frustum.ContainsBounds(i->GetWorldBounds()) == ContainsResult::Out)
+			{
+				continue;
+			}
+
+			if (!i->IsShadowEnable() &&
+				(i->GetCullingMask() & culling_mask) == culling_mask &&
+				m_clustered_lights.Size() < ClusterLightUniforms::MAX_LIGHT_COUNT)
+			{
+				m_clustered_lights.Add(i);
+			}
+			else
+			{
+				m_pass_lights.Add(i);
+			}
+		}
+
+		m_uniforms.ambient_color = Light::GetAmbientColor();
+		m_uniforms.cluster_params = Vector4(near_clip, ClusterLightUniforms::CLUSTER_Z / logf(far_clip / near_clip), 0, 0);
+		Memory::Zero(m_uniforms.light_masks, sizeof(m_uniforms.light_masks));
+
+		uint32_t directional_mask = 0;
+
+		for (int i = 0; i < m_clustered_lights.Size(); ++i)
+		{
+			Light* light = m_clustered_lights[i];
+			const auto& light_uniforms = light->GetLightUniforms();
+
+			m_uniforms.light_pos[i] = light_uniforms.light_pos;
+			m_uniforms.light_color[i] = light_uniforms.light_color;
+			m_uniforms.light_atten[i] = light_uniforms.light_atten;
+			m_uniforms.spot_light_dir[i] = light_uniforms.spot_light_dir;
+
+			if (light->GetType() == LightType::Directional)
+			{
+				directional_mask |= 1u << i;
+			}
+			else
+			{
+				this->AddLocalLight(i, light, view, projection, near_clip, far_clip);
+			}
+		}
+
+		if (directional_mask != 0)
+		{
+			for (int i = 0; i < ClusterLightUniforms::CLUSTER_COUNT; ++i)
+			{
+				m_uniforms.light_masks[i] |= directional_mask;
+			}
+		}
+
+		void* buffer = driver.allocate(sizeof(ClusterLightUniforms));
+		Memory::Copy(buffer, &m_uniforms, sizeof(ClusterLightUniforms));
+		driver.loadUniformBuffer(m_uniform_buffer, filament::backend::BufferDescriptor(buffer, sizeof(ClusterLightUniforms)));
+	}
+
+	void LightClusters::AddLocalLight(int index, Light* light, const Matrix4x4& view, const Matrix4x4& projection, float near_clip, float far_clip)
+	{
+		const int cluster_x = ClusterLightUniforms::CLUSTER_X;
+		const int cluster_y = ClusterLightUniforms::CLUSTER_Y;
+		const int cluster_z = ClusterLightUniforms::CLUSTER_Z;
+
+		Vector3 center = view.MultiplyPoint3x4(light->GetTransform()->GetPosition());
+		float depth = -center.z;
+		float range = light->GetRange();
+		float depth_min = Mathf::Max(depth - range, near_clip);
+		float depth_max = Mathf::Min(depth + range, far_clip);
+		if (depth_min > depth_max)
+		{
+			return;
+		}
+
+		float z_scale = m_uniforms.cluster_params.y;
+		int z_begin = Mathf::Clamp(Mathf::FloorToInt(logf(depth_min / near_clip) * z_scale), 0, cluster_z - 1);
+		int z_end = Mathf::Clamp(Mathf::FloorToInt(logf(depth_max / near_clip) * z_scale), 0, cluster_z - 1);
+		uint32_t bit = 1u << index;
+
+		for (int z = z_begin; z <= z_end; ++z)
+		{
+			// slice depth range clipped by light sphere
+			float slice_near = Mathf::Max(near_clip * powf(far_clip / near_clip, z / (float) cluster_z), depth_min);
+			float slice_far = Mathf::Min(near_clip * powf(far_clip / near_clip, (z + 1) / (float) cluster_z), depth_max);
+
+			// widest cross section of the sphere inside the slice
+			float dz = 0;
+			if (depth < slice_near)
+			{
+				dz = slice_near - depth;
+			}
+			else if (depth > slice_far)
+			{
+				dz = depth - slice_far;
+			}
+			float radius = sqrtf(Mathf::Max(range * range - dz * dz, 0.0f));
+
+			// screen rect of the box around the cross section
+			float x_min = 1e9f, x_max = -1e9f, y_min = 1e9f, y_max = -1e9f;
+			for (int i = 0; i < 8; ++i)
+			{
+				Vector3 corner(
+					center.x + ((i & 1) ? radius : -radius),
+					center.y + ((i & 2) ? radius : -radius),
+					(i & 4) ? -slice_far : -slice_near);
+				Vector3 ndc = projection.MultiplyPoint(corner);
+
+				x_min = Mathf::Min(x_min, ndc.x);
+				x_max = Mathf::Max(x_max, ndc.x);
+				y_min = Mathf::Min(y_min, ndc.y);
+				y_max = Mathf::Max(y_max, ndc.y);
+			}
+
+			if (x_min > 1 || x_max < -1 || y_min > 1 || y_max < -1)
+			{
+				continue;
+			}
+
+			int x_begin = Mathf::Clamp(Mathf::FloorToInt((x_min * 0.5f + 0.5f) * cluster_x), 0, cluster_x - 1);
+			int x_end = Mathf::Clamp(Mathf::FloorToInt((x_max * 0.5f + 0.5f) * cluster_x), 0, cluster_x - 1);
+			int y_begin = Mathf::Clamp(Mathf::FloorToInt((y_min * 0.5f + 0.5f) * cluster_y), 0, cluster_y - 1);
+			int y_end = Mathf::Clamp(Mathf::FloorToInt((y_max * 0.5f + 0.5f) * cluster_y), 0, cluster_y - 1);
+
+			for (int y = y_begin; y <= y_end; ++y)
+			{
+				uint32_t* masks = &m_uniforms.light_masks[z * cluster_x * cluster_y + y * cluster_x];
+				for (int x = x_begin; x <= x_end; ++x)
+				{
+					masks[x] |= bit;
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,55 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Material.h"
+#include "math/Matrix4x4.h"
+#include "container/Vector.h"
+#include "private/backend/DriverApi.h"
+
+namespace Viry3D
+{
+	class Light;
+
+	// bins lights of a view into a froxel grid with exponential depth slices,
+	// forward shaders with CLUSTER_LIGHTING_ON shade all clustered lights of a fragment in one pass
+	class LightClusters
+	{
+	public:
+		// needs uniform buffers and integer ops, not available on gles 2.0
+		static bool IsSupported();
+		LightClusters();
+		~LightClusters();
+		// shadowed lights, lights not covering all layers of culling mask and lights beyond the max count
+		// are left to per light passes, call outside of render pass
+		void Update(const Matrix4x4& view, const Matrix4x4& projection, float near_clip, float far_clip, uint32_t culling_mask);
+		const filament::backend::UniformBufferHandle& GetUniformBuffer() const { return m_uniform_buffer; }
+		const Vector<Light*>& GetClusteredLights() const { return m_clustered_lights; }
+		const Vector<Light*>& GetPassLights() const { return m_pass_lights; }
+		bool IsClustered(Light* light) const { return m_clustered_lights.Contains(light); }
+
+	private:
+		void AddLocalLight(int index, Light* light, const Matrix4x4& view, const Matrix4x4& projection, float near_clip, float far_clip);
+
+	private:
+		ClusterLightUniforms m_uniforms;
+		filament::backend::UniformBufferHandle m_uniform_buffer;
+		Vector<Light*> m_clustered_lights;
+		Vector<Light*> m_pass_lights;
+	};
+}
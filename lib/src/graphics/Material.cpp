@@ -18,6 +18,7 @@
 #include "Material.h"
 #include "Engine.h"
 #include "Camera.h"
+#include "RenderState.h"
 
 namespace Viry3D
 {
@@ -44,13 +45,9 @@ namespace Viry3D
     }
 
     Material::Material(const Ref<Shader>& shader):
+        m_shader(shader),
         m_scissor_rect(0, 0, 1, 1)
     {
-        ShaderVariant variant;
-        variant.key = shader->GetShaderKey();
-        variant.keywords = shader->GetKeywords();
-        variant.shader = shader;
-        m_shader_variants.Add(variant.key, variant);
 
         m_unifrom_buffers.Resize(shader->GetPassCount());
         for (int i = 0; i < m_unifrom_buffers.Size(); ++i)
@@ -102,30 +99,21 @@ namespace Viry3D
 
     const String& Material::GetShaderName()
     {
-        return m_shader_variants.begin()->second.shader->GetName();
+        return m_shader->GetName();
     }
 
-    const Ref<Shader>& Material::GetShader()
+    Ref<Shader> Material::GetShader(uint64_t keyword_mask) const
     {
-        return m_shader_variants.begin()->second.shader;
-    }
-
-    const Ref<Shader>& Material::GetShader(const String& key)
-    {
-        assert(m_shader_variants.Contains(key));
-        return m_shader_variants[key].shader;
-    }
+        keyword_mask |= m_shader->GetKeywordMask();
 
-    const Ref<Shader>& Material::GetShader(const Vector<String>& keywords)
-    {
-        if (this->GetShaderName().Size() > 0)
+        // shaders created from code have no source to compile variants from
+        if (m_shader->GetName().Size() > 0 && keyword_mask != m_shader->GetKeywordMask())
         {
-            auto key = this->EnableKeywords(keywords);
-            return this->GetShader(key);
+            return Shader::Find(m_shader->GetName(), keyword_mask);
         }
         else
         {
-            return this->GetShader();
+            return m_shader;
         }
     }
 
@@ -136,7 +124,7 @@ namespace Viry3D
             return *m_queue;
         }
         
-        return m_shader_variants.begin()->second.shader->GetQueue();
+        return m_shader->GetQueue();
     }
     
     void Material::SetQueue(int queue)
@@ -258,22 +246,6 @@ namespace Viry3D
         m_scissor_rect = rect;
     }
 
-    String Material::EnableKeywords(const Vector<String>& keywords)
-	{
-        String key = Shader::MakeKey(this->GetShaderName(), keywords);
-        if (!m_shader_variants.Contains(key))
-        {
-            auto shader = Shader::Find(this->GetShaderName(), keywords);
-
-            ShaderVariant variant;
-            variant.key = shader->GetShaderKey();
-            variant.keywords = shader->GetKeywords();
-            variant.shader = shader;
-            m_shader_variants.Add(variant.key, variant);
-        }
-        return key;
-	}
-
     void Material::Prepare(int pass)
     {
         for (auto& i : m_properties)
@@ -319,9 +291,10 @@ namespace Viry3D
                 {
                     unifrom_buffer.dirty = false;
                     
-                    void* buffer = Memory::Alloc<void>(unifrom_buffer.buffer.Size());
+                    // command stream memory is released with the frame, no heap allocation
+                    void* buffer = driver.allocate(unifrom_buffer.buffer.Size());
                     Memory::Copy(buffer, unifrom_buffer.buffer.Bytes(), unifrom_buffer.buffer.Size());
-                    driver.loadUniformBuffer(unifrom_buffer.uniform_buffer, filament::backend::BufferDescriptor(buffer, unifrom_buffer.buffer.Size(), FreeBufferCallback));
+                    driver.loadUniformBuffer(unifrom_buffer.uniform_buffer, filament::backend::BufferDescriptor(buffer, unifrom_buffer.buffer.Size()));
                 }
             }
         }
@@ -361,7 +334,7 @@ namespace Viry3D
     void Material::UpdateUniformMember(const String& name, const void* data, int size)
     {
         auto& driver = Engine::Instance()->GetDriverApi();
-        const auto& shader = m_shader_variants.begin()->second.shader;
+        const auto& shader = m_shader;
 
         for (int i = 0; i < shader->GetPassCount(); ++i)
         {
@@ -408,7 +381,7 @@ namespace Viry3D
     void Material::UpdateUniformTexture(const String& name, const Ref<Texture>& texture)
     {
         auto& driver = Engine::Instance()->GetDriverApi();
-        const auto& shader = m_shader_variants.begin()->second.shader;
+        const auto& shader = m_shader;
 
         for (int i = 0; i < shader->GetPassCount(); ++i)
         {
@@ -442,19 +415,17 @@ namespace Viry3D
         }
     }
     
-    void Material::SetScissor(int target_width, int target_height)
+    void Material::SetScissor(int target_width, int target_height, RenderState& state)
     {
-		auto& driver = Engine::Instance()->GetDriverApi();
-        
 		// set scissor
 		int32_t scissor_left = (int32_t) (m_scissor_rect.x * target_width);
 		int32_t scissor_bottom = (int32_t) ((1.0f - (m_scissor_rect.y + m_scissor_rect.h)) * target_height);
 		uint32_t scissor_width = (uint32_t) (m_scissor_rect.w * target_width);
 		uint32_t scissor_height = (uint32_t) (m_scissor_rect.h * target_height);
-		driver.setViewportScissor(scissor_left, scissor_bottom, scissor_width, scissor_height);
+		state.SetViewportScissor(scissor_left, scissor_bottom, scissor_width, scissor_height);
     }
 
-	void Material::Bind(const Ref<Shader>& shader, int pass)
+	void Material::Bind(const Ref<Shader>& shader, int pass, RenderState& state)
 	{
 		auto& driver = Engine::Instance()->GetDriverApi();
 		const auto& unifrom_buffers = m_unifrom_buffers[pass];
@@ -465,7 +436,7 @@ namespace Viry3D
 		{
 			if (unifrom_buffers[i].uniform_buffer)
 			{
-				driver.bindUniformBuffer((size_t) i, unifrom_buffers[i].uniform_buffer);
+				state.BindUniformBuffer((size_t) i, unifrom_buffers[i].uniform_buffer);
 			}
 		}
 
@@ -474,7 +445,7 @@ namespace Viry3D
         {
             if (samplers[i].sampler_group)
             {
-                driver.bindSamplers((size_t) i, samplers[i].sampler_group);
+                state.BindSamplers((size_t) i, samplers[i].sampler_group);
             }
         }
 
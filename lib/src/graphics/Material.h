@@ -32,6 +32,7 @@
 namespace Viry3D
 {
     class Camera;
+    class RenderState;
     
 	// per view uniforms, set by camera
 	struct ViewUniforms
@@ -55,12 +56,14 @@ namespace Viry3D
         static constexpr const char* BOUNDS_COLOR = "u_bounds_color";
 		static constexpr const char* LIGHTMAP_SCALE_OFFSET = "u_lightmap_scale_offset";
 		static constexpr const char* LIGHTMAP_INDEX = "u_lightmap_index";
+		static constexpr const char* LOD_FADE = "u_lod_fade";
 
 		Matrix4x4 model_matrix;
         Matrix4x4 bounds_matrix;
         Color bounds_color;
 		Vector4 lightmap_scale_offset;
 		Vector4 lightmap_index; // in x
+		Vector4 lod_fade; // fade in x, y < 0 draws the complement of dither pattern
 	};
 
 	// per renderer bones uniforms, set by skinned mesh renderer
@@ -81,6 +84,11 @@ namespace Viry3D
 		static constexpr const char* LIGHT_ATTEN = "u_light_atten";
 		static constexpr const char* SPOT_LIGHT_DIR = "u_spot_light_dir";
 		static constexpr const char* SHADOW_PARAMS = "u_shadow_params";
+		static constexpr const char* SHADOW_MATRICES = "u_shadow_matrices";
+		static constexpr const char* SHADOW_CASCADE_SPHERES = "u_shadow_cascade_spheres";
+		static constexpr const char* SHADOW_CASCADE_PARAMS = "u_shadow_cascade_params";
+		static constexpr const char* SHADOW_ATLAS_RECTS = "u_shadow_atlas_rects";
+		static constexpr const int MAX_SHADOW_CASCADE_COUNT = 4;
 
 		Color ambient_color;
 		Vector4 light_pos;
@@ -88,6 +96,28 @@ namespace Viry3D
 		Vector4 light_atten;
 		Vector4 spot_light_dir;
 		Vector4 shadow_params; // strength, z_bias, slope_bias, filter_radius
+		Matrix4x4 shadow_matrices[MAX_SHADOW_CASCADE_COUNT]; // world to light clip space of each cascade
+		Vector4 shadow_cascade_spheres[MAX_SHADOW_CASCADE_COUNT]; // world center, squared radius
+		Vector4 shadow_cascade_params; // cascade count in x
+		Vector4 shadow_atlas_rects[MAX_SHADOW_CASCADE_COUNT]; // uv scale and offset of each cascade in shadow atlas
+	};
+
+	// clustered lights uniforms, set by camera, bound at light fragment binding in CLUSTER_LIGHTING_ON variants
+	struct ClusterLightUniforms
+	{
+		static constexpr const int MAX_LIGHT_COUNT = 32;
+		static constexpr const int CLUSTER_X = 16;
+		static constexpr const int CLUSTER_Y = 9;
+		static constexpr const int CLUSTER_Z = 24;
+		static constexpr const int CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+
+		Color ambient_color;
+		Vector4 cluster_params; // near, z slice scale
+		Vector4 light_pos[MAX_LIGHT_COUNT];
+		Color light_color[MAX_LIGHT_COUNT]; // light type in a
+		Vector4 light_atten[MAX_LIGHT_COUNT];
+		Vector4 spot_light_dir[MAX_LIGHT_COUNT];
+		uint32_t light_masks[CLUSTER_COUNT]; // bit i for light i, 4 clusters per uvec4
 	};
 
 	// per material uniforms, set by material
@@ -149,13 +179,6 @@ namespace Viry3D
         bool dirty = false;
     };
 
-    struct ShaderVariant
-    {
-        String key;
-        Vector<String> keywords;
-        Ref<Shader> shader;
-    };
-    
     class Material : public Object
     {
     public:
@@ -165,9 +188,9 @@ namespace Viry3D
         Material(const Ref<Shader>& shader);
         virtual ~Material();
         const String& GetShaderName();
-        const Ref<Shader>& GetShader();
-        const Ref<Shader>& GetShader(const String& key);
-        const Ref<Shader>& GetShader(const Vector<String>& keywords);
+        const Ref<Shader>& GetShader() const { return m_shader; }
+        // variant with keyword_mask added to keywords of the material shader
+        Ref<Shader> GetShader(uint64_t keyword_mask) const;
         int GetQueue() const;
         void SetQueue(int queue);
         const Matrix4x4* GetMatrix(const String& name) const;
@@ -183,10 +206,9 @@ namespace Viry3D
         void SetMatrixArray(const String& name, const Vector<Matrix4x4>& array);
         const Rect& GetScissorRect() const { return m_scissor_rect; }
         void SetScissorRect(const Rect& rect);
-		String EnableKeywords(const Vector<String>& keywords);
         void Prepare(int pass = -1);
-        void SetScissor(int target_width, int target_height);
-		void Bind(const Ref<Shader>& shader, int pass);
+        void SetScissor(int target_width, int target_height, RenderState& state);
+		void Bind(const Ref<Shader>& shader, int pass, RenderState& state);
         
     private:
         template <class T>
@@ -229,7 +251,7 @@ namespace Viry3D
         
     private:
         static Ref<Material> m_shared_bounds_material;
-        Map<String, ShaderVariant> m_shader_variants;
+        Ref<Shader> m_shader;
         Ref<int> m_queue;
         Map<String, MaterialProperty> m_properties;
         Rect m_scissor_rect;
@@ -20,6 +20,7 @@
 #include "Engine.h"
 #include "Shader.h"
 #include "Texture.h"
+#include "MeshOptimizer.h"
 #include "io/File.h"
 #include "io/MemoryStream.h"
 #include "memory/Memory.h"
@@ -28,6 +29,7 @@ namespace Viry3D
 {
 	Ref<Mesh> Mesh::m_shared_quad_mesh;
     Ref<Mesh> Mesh::m_shared_bounds_mesh;
+    bool Mesh::m_optimize_on_load = false;
 
 	void Mesh::Init()
 	{
@@ -226,6 +228,18 @@ namespace Viry3D
             Vector3 bounds_center = ms.Read<Vector3>();
             Vector3 bounds_size = ms.Read<Vector3>();
 
+            if (m_optimize_on_load)
+            {
+                Vector<int> remap = MeshOptimizer::Optimize(*vertices, *indices, *submeshes);
+                for (int i = 0; i < blend_shapes->Size(); ++i)
+                {
+                    auto& frame = (*blend_shapes)[i].frame;
+                    MeshOptimizer::RemapVertexStream(frame.vertices, remap);
+                    MeshOptimizer::RemapVertexStream(frame.normals, remap);
+                    MeshOptimizer::RemapVertexStream(frame.tangents, remap);
+                }
+            }
+
             mesh = RefMake<Mesh>(std::move(*vertices), std::move(*indices), *submeshes);
             mesh->SetName(mesh_name);
             mesh->SetBindposes(std::move(*bindposes));
@@ -294,8 +308,10 @@ namespace Viry3D
         m_buffer_vertex_count(vertices.Size()),
         m_buffer_index_count(indices.Size()),
         m_uint32_index(uint32_index),
+        m_dynamic(dynamic),
 		m_enabled_attributes(0),
-        m_primitive_type(primitive_type)
+        m_primitive_type(primitive_type),
+        m_depth_stream(false)
     {
         auto& driver = Engine::Instance()->GetDriverApi();
         
@@ -375,6 +391,8 @@ namespace Viry3D
 			m_primitives[i].clear();
 		}
 		m_primitives.Clear();
+
+        this->DestroyDepthStream();
     }
 
     void Mesh::Update(Vector<Vertex>&& vertices, Vector<unsigned int>&& indices, const Vector<Submesh>& submeshes)
@@ -445,6 +463,131 @@ namespace Viry3D
             driver.setRenderPrimitiveBuffer(m_primitives[i], m_vb, m_ib, m_enabled_attributes);
             driver.setRenderPrimitiveRange(m_primitives[i], m_primitive_type, m_submeshes[i].index_first, 0, m_vertices.Size() - 1, m_submeshes[i].index_count);
         }
+
+        if (m_depth_stream)
+        {
+            this->UpdateDepthStream();
+        }
+    }
+
+    void Mesh::EnableDepthStream(bool enable)
+    {
+        if (m_depth_stream == enable)
+        {
+            return;
+        }
+
+        m_depth_stream = enable;
+
+        if (m_depth_stream)
+        {
+            this->UpdateDepthStream();
+        }
+        else
+        {
+            this->DestroyDepthStream();
+        }
+    }
+
+    void Mesh::UpdateDepthStream()
+    {
+        auto& driver = Engine::Instance()->GetDriverApi();
+
+        // position only, or position + bone weights + bone indices for skinned mesh
+        bool skin = m_bindposes.Size() > 0;
+        int float_count = skin ? 11 : 3;
+        int stride = sizeof(float) * float_count;
+        uint32_t enabled_attributes = 1 << (int) Shader::AttributeLocation::Vertex;
+        if (skin)
+        {
+            enabled_attributes |=
+                (1 << (int) Shader::AttributeLocation::BoneWeights) |
+                (1 << (int) Shader::AttributeLocation::BoneIndices);
+        }
+
+        if (!m_depth_vb)
+        {
+            filament::backend::AttributeArray attributes;
+
+            int location = (int) Shader::AttributeLocation::Vertex;
+            attributes[location].offset = 0;
+            attributes[location].stride = stride;
+            attributes[location].buffer = 0;
+            attributes[location].type = filament::backend::ElementType::FLOAT3;
+            attributes[location].flags = 0;
+
+            if (skin)
+            {
+                location = (int) Shader::AttributeLocation::BoneWeights;
+                attributes[location].offset = sizeof(Vector3);
+                attributes[location].stride = stride;
+                attributes[location].buffer = 0;
+                attributes[location].type = filament::backend::ElementType::FLOAT4;
+                attributes[location].flags = 0;
+
+                location = (int) Shader::AttributeLocation::BoneIndices;
+                attributes[location].offset = sizeof(Vector3) + sizeof(Vector4);
+                attributes[location].stride = stride;
+                attributes[location].buffer = 0;
+                attributes[location].type = filament::backend::ElementType::FLOAT4;
+                attributes[location].flags = 0;
+            }
+
+            filament::backend::BufferUsage usage = m_dynamic ? filament::backend::BufferUsage::DYNAMIC : filament::backend::BufferUsage::STATIC;
+            m_depth_vb = driver.createVertexBuffer(1, (uint8_t) Shader::AttributeLocation::Count, m_buffer_vertex_count, attributes, usage);
+        }
+
+        int size = stride * m_vertices.Size();
+        float* buffer = Memory::Alloc<float>(size);
+        for (int i = 0; i < m_vertices.Size(); ++i)
+        {
+            const Vertex& v = m_vertices[i];
+            float* p = &buffer[i * float_count];
+            p[0] = v.vertex.x;
+            p[1] = v.vertex.y;
+            p[2] = v.vertex.z;
+
+            if (skin)
+            {
+                Memory::Copy(&p[3], &v.bone_weights, sizeof(Vector4));
+                Memory::Copy(&p[7], &v.bone_indices, sizeof(Vector4));
+            }
+        }
+        driver.updateVertexBuffer(m_depth_vb, 0, filament::backend::BufferDescriptor(buffer, size, FreeBufferCallback), 0);
+
+        for (int i = 0; i < m_depth_primitives.Size(); ++i)
+        {
+            driver.destroyRenderPrimitive(m_depth_primitives[i]);
+            m_depth_primitives[i].clear();
+        }
+        m_depth_primitives.Clear();
+
+        m_depth_primitives.Resize(m_submeshes.Size());
+        for (int i = 0; i < m_depth_primitives.Size(); ++i)
+        {
+            m_depth_primitives[i] = driver.createRenderPrimitive();
+
+            driver.setRenderPrimitiveBuffer(m_depth_primitives[i], m_depth_vb, m_ib, enabled_attributes);
+            driver.setRenderPrimitiveRange(m_depth_primitives[i], m_primitive_type, m_submeshes[i].index_first, 0, m_vertices.Size() - 1, m_submeshes[i].index_count);
+        }
+    }
+
+    void Mesh::DestroyDepthStream()
+    {
+        auto& driver = Engine::Instance()->GetDriverApi();
+
+        for (int i = 0; i < m_depth_primitives.Size(); ++i)
+        {
+            driver.destroyRenderPrimitive(m_depth_primitives[i]);
+            m_depth_primitives[i].clear();
+        }
+        m_depth_primitives.Clear();
+
+        if (m_depth_vb)
+        {
+            driver.destroyVertexBuffer(m_depth_vb);
+            m_depth_vb.clear();
+        }
     }
 
     void Mesh::SetBlendShapes(Vector<BlendShape>&& blend_shapes)
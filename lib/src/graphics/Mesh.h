@@ -69,6 +69,10 @@ namespace Viry3D
 		static const Ref<Mesh>& GetSharedQuadMesh();
         static const Ref<Mesh>& GetSharedBoundsMesh();
         static Ref<Mesh> LoadFromFile(const String& path);
+        // reorder triangles and vertices of loaded meshes for vertex cache, overdraw and fetch,
+        // off by default as cooked meshes are optimized by MeshOptimizer tool
+        static void EnableOptimizeOnLoad(bool enable) { m_optimize_on_load = enable; }
+        static bool IsOptimizeOnLoadEnable() { return m_optimize_on_load; }
         Mesh(Vector<Vertex>&& vertices, Vector<unsigned int>&& indices, const Vector<Submesh>& submeshes = Vector<Submesh>(), bool uint32_index = false, bool dynamic = false, filament::backend::PrimitiveType primitive_type = filament::backend::PrimitiveType::TRIANGLES);
         virtual ~Mesh();
         void Update(Vector<Vertex>&& vertices, Vector<unsigned int>&& indices, const Vector<Submesh>& submeshes = Vector<Submesh>());
@@ -84,14 +88,23 @@ namespace Viry3D
 		const filament::backend::VertexBufferHandle& GetVertexBuffer() const { return m_vb; }
 		const filament::backend::IndexBufferHandle& GetIndexBuffer() const { return m_ib; }
 		const Vector<filament::backend::RenderPrimitiveHandle>& GetPrimitives() const { return m_primitives; }
+        // keep a tightly packed position stream, with bone weights and indices for skinned mesh,
+        // depth only passes bind it instead of the full interleaved vertex
+        void EnableDepthStream(bool enable);
+        bool IsDepthStreamEnable() const { return m_depth_stream; }
+        // one primitive per submesh reading the depth stream, empty if depth stream is disabled
+        const Vector<filament::backend::RenderPrimitiveHandle>& GetDepthPrimitives() const { return m_depth_primitives; }
 
     private:
         void SetBindposes(Vector<Matrix4x4>&& bindposes) { m_bindposes = std::move(bindposes); }
         void SetBlendShapes(Vector<BlendShape>&& blend_shapes);
+        void UpdateDepthStream();
+        void DestroyDepthStream();
         
     private:
 		static Ref<Mesh> m_shared_quad_mesh;
         static Ref<Mesh> m_shared_bounds_mesh;
+        static bool m_optimize_on_load;
         Vector<Vertex> m_vertices;
         Vector<unsigned int> m_indices;
         int m_buffer_vertex_count;
@@ -102,11 +115,15 @@ namespace Viry3D
         Ref<Texture> m_blend_shape_texture;
         Bounds m_bounds;
         bool m_uint32_index;
+        bool m_dynamic;
 		filament::backend::AttributeArray m_attributes;
 		uint32_t m_enabled_attributes;
         filament::backend::VertexBufferHandle m_vb;
         filament::backend::IndexBufferHandle m_ib;
         filament::backend::PrimitiveType m_primitive_type;
         Vector<filament::backend::RenderPrimitiveHandle> m_primitives;
+        bool m_depth_stream;
+        filament::backend::VertexBufferHandle m_depth_vb;
+        Vector<filament::backend::RenderPrimitiveHandle> m_depth_primitives;
     };
 }
@@ -0,0 +1,436 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "memory/Memory.h"
+#include "math/Mathf.h"
+#include <algorithm>
+
+namespace Viry3D
+{
+    MeshOptimizer::VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const Vector<unsigned int>& indices, int index_first, int index_count, int vertex_count, int cache_size)
+    {
+        VertexCacheStats stats = { 0, 0 };
+        int triangle_count = index_count / 3;
+        if (triangle_count == 0)
+        {
+            return stats;
+        }
+
+        // vertex is in cache while less than cache_size misses happened after its own miss
+        Vector<int> timestamps(vertex_count, 0);
+        Vector<byte> used(vertex_count, 0);
+        int time = cache_size + 1;
+        int misses = 0;
+        int unique = 0;
+
+        for (int i = index_first; i < index_first + triangle_count * 3; ++i)
+        {
+            unsigned int v = indices[i];
+            if (time - timestamps[v] > cache_size)
+            {
+                timestamps[v] = time++;
+                misses++;
+            }
+            if (!used[v])
+            {
+                used[v] = 1;
+                unique++;
+            }
+        }
+
+        stats.acmr = misses / (float) triangle_count;
+        stats.atvr = misses / (float) unique;
+
+        return stats;
+    }
+
+    void MeshOptimizer::OptimizeVertexCache(Vector<unsigned int>& indices, int index_first, int index_count, int vertex_count, int cache_size, Vector<int>* hard_boundaries)
+    {
+        int triangle_count = index_count / 3;
+        if (hard_boundaries)
+        {
+            hard_boundaries->Clear();
+        }
+        if (triangle_count == 0)
+        {
+            return;
+        }
+
+        const unsigned int* source = &indices[index_first];
+
+        // triangles around each vertex
+        Vector<int> offsets(vertex_count + 1, 0);
+        for (int i = 0; i < triangle_count * 3; ++i)
+        {
+            offsets[source[i] + 1]++;
+        }
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            offsets[i + 1] += offsets[i];
+        }
+        Vector<int> adjacency(triangle_count * 3);
+        {
+            Vector<int> fill = offsets;
+            for (int i = 0; i < triangle_count * 3; ++i)
+            {
+                adjacency[fill[source[i]]++] = i / 3;
+            }
+        }
+
+        Vector<int> live(vertex_count);
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            live[i] = offsets[i + 1] - offsets[i];
+        }
+
+        Vector<int> timestamps(vertex_count, 0);
+        Vector<byte> emitted(triangle_count, 0);
+        Vector<unsigned int> result(triangle_count * 3);
+        int result_count = 0;
+        Vector<unsigned int> dead_end;
+        Vector<unsigned int> candidates;
+        int time = cache_size + 1;
+        int cursor = 0;
+        int fan = (int) source[0];
+
+        if (hard_boundaries)
+        {
+            hard_boundaries->Add(0);
+        }
+
+        // tipsify, emit all triangles around the fanning vertex then move to a vertex likely still in cache
+        while (fan >= 0)
+        {
+            candidates.Clear();
+            for (int i = offsets[fan]; i < offsets[fan + 1]; ++i)
+            {
+                int t = adjacency[i];
+                if (emitted[t])
+                {
+                    continue;
+                }
+                emitted[t] = 1;
+
+                for (int j = 0; j < 3; ++j)
+                {
+                    unsigned int v = source[t * 3 + j];
+                    result[result_count++] = v;
+                    dead_end.Add(v);
+                    candidates.Add(v);
+                    live[v]--;
+
+                    if (time - timestamps[v] > cache_size)
+                    {
+                        timestamps[v] = time++;
+                    }
+                }
+            }
+
+            // prefer the oldest candidate that stays in cache while its remaining triangles are emitted
+            int next = -1;
+            int best_priority = -1;
+            for (int i = 0; i < candidates.Size(); ++i)
+            {
+                unsigned int v = candidates[i];
+                if (live[v] <= 0)
+                {
+                    continue;
+                }
+
+                int priority = 0;
+                if (time - timestamps[v] + 2 * live[v] <= cache_size)
+                {
+                    priority = time - timestamps[v];
+                }
+                if (priority > best_priority)
+                {
+                    best_priority = priority;
+                    next = v;
+                }
+            }
+
+            // dead end, back to the latest vertex with triangles left, else scan for any
+            if (next < 0)
+            {
+                while (!dead_end.Empty())
+                {
+                    unsigned int v = dead_end[dead_end.Size() - 1];
+                    dead_end.Resize(dead_end.Size() - 1);
+                    if (live[v] > 0)
+                    {
+                        next = v;
+                        break;
+                    }
+                }
+
+                while (next < 0 && cursor < vertex_count)
+                {
+                    if (live[cursor] > 0)
+                    {
+                        next = cursor;
+                    }
+                    cursor++;
+                }
+
+                if (next >= 0 && hard_boundaries)
+                {
+                    hard_boundaries->Add(result_count / 3);
+                }
+            }
+
+            fan = next;
+        }
+
+        for (int i = 0; i < result_count; ++i)
+        {
+            indices[index_first + i] = result[i];
+        }
+    }
+
+    void MeshOptimizer::OptimizeOverdraw(Vector<unsigned int>& indices, int index_first, int index_count, const Vector<Mesh::Vertex>& vertices, float threshold, int cache_size)
+    {
+        int vertex_count = vertices.Size();
+        int triangle_count = index_count / 3;
+        if (triangle_count == 0)
+        {
+            return;
+        }
+
+        Vector<int> hard_boundaries;
+        OptimizeVertexCache(indices, index_first, index_count, vertex_count, cache_size, &hard_boundaries);
+
+        // split each hard cluster where acmr of the part drawn from an empty cache gets within threshold
+        // of the whole hard cluster, so parts drawn in any order stay close to the cache optimized order
+        Vector<int> clusters;
+        Vector<int> timestamps(vertex_count, 0);
+        int time = cache_size + 1;
+        auto update_cache = [&](int t) {
+            int misses = 0;
+            for (int j = 0; j < 3; ++j)
+            {
+                unsigned int v = indices[index_first + t * 3 + j];
+                if (time - timestamps[v] > cache_size)
+                {
+                    timestamps[v] = time++;
+                    misses++;
+                }
+            }
+            return misses;
+        };
+
+        for (int i = 0; i < hard_boundaries.Size(); ++i)
+        {
+            int begin = hard_boundaries[i];
+            int end = i + 1 < hard_boundaries.Size() ? hard_boundaries[i + 1] : triangle_count;
+
+            time += cache_size + 1;
+            int hard_misses = 0;
+            for (int t = begin; t < end; ++t)
+            {
+                hard_misses += update_cache(t);
+            }
+            float acmr_limit = threshold * hard_misses / (float) (end - begin);
+
+            int first = clusters.Size();
+            clusters.Add(begin);
+            time += cache_size + 1;
+            int misses = 0;
+            int count = 0;
+            for (int t = begin; t < end; ++t)
+            {
+                misses += update_cache(t);
+                count++;
+
+                if (misses <= acmr_limit * count)
+                {
+                    clusters.Add(t + 1);
+                    time += cache_size + 1;
+                    misses = 0;
+                    count = 0;
+                }
+            }
+
+            // the last part is usually a few triangles with bad acmr, merge it into the previous part
+            if (clusters.Size() - 1 > first)
+            {
+                clusters.Resize(clusters.Size() - 1);
+            }
+        }
+
+        // area weighted centroid and normal of each cluster
+        Vector<Vector3> cluster_centroids(clusters.Size());
+        Vector<Vector3> cluster_normals(clusters.Size());
+        Vector3 mesh_centroid;
+        float mesh_area = 0;
+
+        for (int i = 0; i < clusters.Size(); ++i)
+        {
+            int begin = clusters[i];
+            int end = i + 1 < clusters.Size() ? clusters[i + 1] : triangle_count;
+            Vector3 centroid;
+            Vector3 normal;
+            float area = 0;
+
+            for (int t = begin; t < end; ++t)
+            {
+                Vector3 a = vertices[indices[index_first + t * 3 + 0]].vertex;
+                Vector3 b = vertices[indices[index_first + t * 3 + 1]].vertex;
+                Vector3 c = vertices[indices[index_first + t * 3 + 2]].vertex;
+                Vector3 n = (b - a) * (c - a);
+                float triangle_area = n.Magnitude();
+
+                centroid += (a + b + c) * (triangle_area / 3.0f);
+                normal += n;
+                area += triangle_area;
+            }
+
+            mesh_centroid += centroid;
+            mesh_area += area;
+
+            cluster_centroids[i] = area > 0 ? centroid / area : Vector3::Zero();
+            cluster_normals[i] = normal.SqrMagnitude() > 0 ? Vector3::Normalize(normal) : Vector3::Zero();
+        }
+
+        if (mesh_area > 0)
+        {
+            mesh_centroid = mesh_centroid / mesh_area;
+        }
+
+        // clusters facing away from the center occlude the rest more likely, draw them first
+        Vector<float> keys(clusters.Size());
+        Vector<int> order(clusters.Size());
+        for (int i = 0; i < clusters.Size(); ++i)
+        {
+            keys[i] = Vector3::Dot(cluster_centroids[i] - mesh_centroid, cluster_normals[i]);
+            order[i] = i;
+        }
+        std::stable_sort(&order[0], &order[0] + order.Size(), [&](int a, int b) {
+            return keys[a] > keys[b];
+        });
+
+        Vector<unsigned int> result(triangle_count * 3);
+        int result_count = 0;
+        for (int i = 0; i < order.Size(); ++i)
+        {
+            int c = order[i];
+            int begin = clusters[c];
+            int end = c + 1 < clusters.Size() ? clusters[c + 1] : triangle_count;
+            for (int j = begin * 3; j < end * 3; ++j)
+            {
+                result[result_count++] = indices[index_first + j];
+            }
+        }
+
+        for (int i = 0; i < result_count; ++i)
+        {
+            indices[index_first + i] = result[i];
+        }
+    }
+
+    Vector<int> MeshOptimizer::OptimizeVertexFetch(Vector<Mesh::Vertex>& vertices, Vector<unsigned int>& indices)
+    {
+        int vertex_count = vertices.Size();
+        Vector<int> remap(vertex_count, -1);
+        int next = 0;
+
+        for (int i = 0; i < indices.Size(); ++i)
+        {
+            unsigned int v = indices[i];
+            if (remap[v] < 0)
+            {
+                remap[v] = next++;
+            }
+            indices[i] = remap[v];
+        }
+
+        // keep unused vertices so vertex count and side streams stay valid
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            if (remap[i] < 0)
+            {
+                remap[i] = next++;
+            }
+        }
+
+        RemapVertexStream(vertices, remap);
+
+        return remap;
+    }
+
+    Vector<int> MeshOptimizer::Optimize(Vector<Mesh::Vertex>& vertices, Vector<unsigned int>& indices, const Vector<Mesh::Submesh>& submeshes)
+    {
+        Vector<Mesh::Submesh> ranges = submeshes;
+        if (ranges.Empty())
+        {
+            ranges.Add({ 0, indices.Size() });
+        }
+
+        for (int i = 0; i < ranges.Size(); ++i)
+        {
+            int first = ranges[i].index_first;
+            int count = ranges[i].index_count;
+            if (count < 3)
+            {
+                continue;
+            }
+
+            // source order may be cache optimized already by the exporter, keep the lowest acmr of source, tipsify
+            // and overdraw order, overdraw order wins ties
+            Vector<unsigned int> source(count);
+            Memory::Copy(&source[0], &indices[first], count * sizeof(unsigned int));
+            float source_acmr = AnalyzeVertexCache(indices, first, count, vertices.Size()).acmr;
+
+            OptimizeVertexCache(indices, first, count, vertices.Size());
+
+            Vector<unsigned int> cache_order(count);
+            Memory::Copy(&cache_order[0], &indices[first], count * sizeof(unsigned int));
+            float cache_acmr = AnalyzeVertexCache(indices, first, count, vertices.Size()).acmr;
+
+            const Vector<unsigned int>& best = cache_acmr <= source_acmr ? cache_order : source;
+            float best_acmr = Mathf::Min(cache_acmr, source_acmr);
+
+            // overdraw runs tipsify itself, start it from the source order like a direct call
+            Memory::Copy(&indices[first], &source[0], count * sizeof(unsigned int));
+            OptimizeOverdraw(indices, first, count, vertices);
+
+            if (AnalyzeVertexCache(indices, first, count, vertices.Size()).acmr > best_acmr)
+            {
+                Memory::Copy(&indices[first], &best[0], count * sizeof(unsigned int));
+            }
+        }
+
+        return OptimizeVertexFetch(vertices, indices);
+    }
+
+    void MeshOptimizer::Optimize(MeshData& data)
+    {
+        Vector<int> remap = Optimize(data.vertices, data.indices, data.submeshes);
+
+        for (int i = 0; i < data.blend_shapes.Size(); ++i)
+        {
+            auto& frames = data.blend_shapes[i].frames;
+            for (int j = 0; j < frames.Size(); ++j)
+            {
+                RemapVertexStream(frames[j].vertices, remap);
+                RemapVertexStream(frames[j].normals, remap);
+                RemapVertexStream(frames[j].tangents, remap);
+            }
+        }
+    }
+}
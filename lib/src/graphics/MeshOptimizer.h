@@ -0,0 +1,74 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Mesh.h"
+#include "container/Vector.h"
+
+namespace Viry3D
+{
+    struct MeshData;
+
+    // reorders triangles for post transform vertex cache and overdraw, then vertices for fetch locality,
+    // each submesh is optimized inside its own index range
+    class MeshOptimizer
+    {
+    public:
+        static const int DefaultCacheSize = 16;
+
+        struct VertexCacheStats
+        {
+            // transformed vertices per triangle, 0.5 ~ 3
+            float acmr;
+            // transformed vertices per referenced vertex, 1 is optimal
+            float atvr;
+        };
+
+        // simulate a fifo post transform cache
+        static VertexCacheStats AnalyzeVertexCache(const Vector<unsigned int>& indices, int index_first, int index_count, int vertex_count, int cache_size = DefaultCacheSize);
+        // tipsify triangle order, optionally output triangle offsets where the walk restarted from an unrelated vertex
+        static void OptimizeVertexCache(Vector<unsigned int>& indices, int index_first, int index_count, int vertex_count, int cache_size = DefaultCacheSize, Vector<int>* hard_boundaries = nullptr);
+        // split cache optimized triangles into clusters and draw clusters facing out of the mesh first,
+        // threshold is the acmr allowed above the cache optimized order, 1.05 gives up to 5%
+        static void OptimizeOverdraw(Vector<unsigned int>& indices, int index_first, int index_count, const Vector<Mesh::Vertex>& vertices, float threshold = 1.05f, int cache_size = DefaultCacheSize);
+        // vertices in order of first use, unused vertices last, return new index of each old vertex
+        static Vector<int> OptimizeVertexFetch(Vector<Mesh::Vertex>& vertices, Vector<unsigned int>& indices);
+        // all passes per submesh, return new index of each old vertex for side streams like blend shapes
+        static Vector<int> Optimize(Vector<Mesh::Vertex>& vertices, Vector<unsigned int>& indices, const Vector<Mesh::Submesh>& submeshes);
+        static void Optimize(MeshData& data);
+        // move elements of a per vertex stream like Optimize moved vertices, streams of other sizes are left as is
+        template<class T>
+        static void RemapVertexStream(Vector<T>& stream, const Vector<int>& remap);
+    };
+
+    template<class T>
+    void MeshOptimizer::RemapVertexStream(Vector<T>& stream, const Vector<int>& remap)
+    {
+        if (stream.Size() != remap.Size())
+        {
+            return;
+        }
+
+        Vector<T> result(stream.Size());
+        for (int i = 0; i < stream.Size(); ++i)
+        {
+            result[remap[i]] = stream[i];
+        }
+        stream = std::move(result);
+    }
+}
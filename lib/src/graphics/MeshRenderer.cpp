@@ -16,6 +16,7 @@
 */
 
 #include "MeshRenderer.h"
+#include "StaticBatching.h"
 
 namespace Viry3D
 {
@@ -32,18 +33,52 @@ namespace Viry3D
     void MeshRenderer::SetMesh(const Ref<Mesh>& mesh)
     {
         m_mesh = mesh;
+
+        this->MarkWorldBoundsDirty();
     }
     
-    Vector<filament::backend::RenderPrimitiveHandle> MeshRenderer::GetPrimitives()
+    const Vector<filament::backend::RenderPrimitiveHandle>& MeshRenderer::GetPrimitives()
     {
-        Vector<filament::backend::RenderPrimitiveHandle> primitives;
-        
+        if (this->GetStaticBatch())
+        {
+            return this->GetStaticBatch()->GetSourcePrimitives(this->GetStaticBatchIndex());
+        }
+
         if (m_mesh)
         {
-            primitives = m_mesh->GetPrimitives();
+            return m_mesh->GetPrimitives();
         }
         
-        return primitives;
+        return Renderer::GetPrimitives();
+    }
+
+    const Vector<filament::backend::RenderPrimitiveHandle>& MeshRenderer::GetDepthPrimitives()
+    {
+        if (this->GetStaticBatch())
+        {
+            const auto& batch = this->GetStaticBatch();
+            if (batch->GetMesh()->IsDepthStreamEnable())
+            {
+                return batch->GetSourceDepthPrimitives(this->GetStaticBatchIndex());
+            }
+        }
+        else if (m_mesh && m_mesh->IsDepthStreamEnable())
+        {
+            return m_mesh->GetDepthPrimitives();
+        }
+
+        return this->GetPrimitives();
+    }
+
+    uint32_t MeshRenderer::GetMeshId() const
+    {
+        // keep renderers of a static batch adjacent after sorting
+        if (this->GetStaticBatch())
+        {
+            return this->GetStaticBatch()->GetMesh()->GetId();
+        }
+
+        return m_mesh ? m_mesh->GetId() : 0;
     }
 
     Bounds MeshRenderer::GetLocalBounds() const
@@ -31,9 +31,14 @@ namespace Viry3D
         virtual ~MeshRenderer();
         const Ref<Mesh>& GetMesh() const { return m_mesh; }
 		virtual void SetMesh(const Ref<Mesh>& mesh);
-        virtual Vector<filament::backend::RenderPrimitiveHandle> GetPrimitives();
+        virtual const Vector<filament::backend::RenderPrimitiveHandle>& GetPrimitives();
+        virtual const Vector<filament::backend::RenderPrimitiveHandle>& GetDepthPrimitives();
         virtual Bounds GetLocalBounds() const;
 
+    protected:
+        virtual uint32_t GetMeshId() const;
+        virtual bool CanInstance() const { return m_mesh && !this->GetStaticBatch(); }
+
 	private:
         Ref<Mesh> m_mesh;
     };
@@ -0,0 +1,1044 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "MeshSimplifier.h"
+#include "io/File.h"
+#include "io/MemoryStream.h"
+#include "memory/Memory.h"
+#include "Debug.h"
+#include "math/Mathf.h"
+#include <algorithm>
+#include <math.h>
+
+// border and seam edges resist moving away from their line
+#define BORDER_EDGE_WEIGHT 10.0
+// collapse is rejected when a triangle normal turns by more than about 75 degrees
+#define FLIP_DOT_LIMIT 0.25
+#define MAX_PASS_COUNT 100
+
+namespace Viry3D
+{
+    bool MeshData::LoadFromFile(const String& path, MeshData& data)
+    {
+        if (!File::Exist(path))
+        {
+            Log("mesh file not exist: %s", path.CString());
+            return false;
+        }
+
+        MemoryStream ms(File::ReadAllBytes(path));
+
+        data = MeshData();
+
+        int name_size = ms.Read<int>();
+        data.name = ms.ReadString(name_size);
+
+        int vertex_count = ms.Read<int>();
+        data.vertices.Resize(vertex_count);
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            data.vertices[i].vertex = ms.Read<Vector3>();
+        }
+
+        int color_count = ms.Read<int>();
+        for (int i = 0; i < color_count; ++i)
+        {
+            float r = ms.Read<byte>() / 255.0f;
+            float g = ms.Read<byte>() / 255.0f;
+            float b = ms.Read<byte>() / 255.0f;
+            float a = ms.Read<byte>() / 255.0f;
+            data.vertices[i].color = Color(r, g, b, a);
+        }
+        data.has_colors = color_count > 0;
+
+        int uv_count = ms.Read<int>();
+        for (int i = 0; i < uv_count; ++i)
+        {
+            data.vertices[i].uv = ms.Read<Vector2>();
+        }
+        data.has_uv = uv_count > 0;
+
+        int uv2_count = ms.Read<int>();
+        for (int i = 0; i < uv2_count; ++i)
+        {
+            data.vertices[i].uv2 = ms.Read<Vector2>();
+        }
+        data.has_uv2 = uv2_count > 0;
+
+        int normal_count = ms.Read<int>();
+        for (int i = 0; i < normal_count; ++i)
+        {
+            data.vertices[i].normal = ms.Read<Vector3>();
+        }
+        data.has_normals = normal_count > 0;
+
+        int tangent_count = ms.Read<int>();
+        for (int i = 0; i < tangent_count; ++i)
+        {
+            data.vertices[i].tangent = ms.Read<Vector4>();
+        }
+        data.has_tangents = tangent_count > 0;
+
+        int bone_weight_count = ms.Read<int>();
+        for (int i = 0; i < bone_weight_count; ++i)
+        {
+            data.vertices[i].bone_weights = ms.Read<Vector4>();
+            float index0 = (float) ms.Read<byte>();
+            float index1 = (float) ms.Read<byte>();
+            float index2 = (float) ms.Read<byte>();
+            float index3 = (float) ms.Read<byte>();
+            data.vertices[i].bone_indices = Vector4(index0, index1, index2, index3);
+        }
+        data.has_bone_weights = bone_weight_count > 0;
+
+        int index_count = ms.Read<int>();
+        data.indices.Resize(index_count);
+        for (int i = 0; i < index_count; ++i)
+        {
+            data.indices[i] = ms.Read<unsigned short>();
+        }
+
+        int submesh_count = ms.Read<int>();
+        data.submeshes.Resize(submesh_count);
+        if (submesh_count > 0)
+        {
+            ms.Read(&data.submeshes[0], data.submeshes.SizeInBytes());
+        }
+
+        int bindpose_count = ms.Read<int>();
+        data.bindposes.Resize(bindpose_count);
+        if (bindpose_count > 0)
+        {
+            ms.Read(&data.bindposes[0], data.bindposes.SizeInBytes());
+        }
+
+        int blend_shape_count = ms.Read<int>();
+        data.blend_shapes.Resize(blend_shape_count);
+        for (int i = 0; i < blend_shape_count; ++i)
+        {
+            auto& shape = data.blend_shapes[i];
+
+            int string_size = ms.Read<int>();
+            shape.name = ms.ReadString(string_size);
+            int frame_count = ms.Read<int>();
+            shape.frames.Resize(frame_count);
+
+            for (int j = 0; j < frame_count; ++j)
+            {
+                auto& frame = shape.frames[j];
+                frame.weight = ms.Read<float>();
+                frame.vertices.Resize(vertex_count);
+                frame.normals.Resize(normal_count);
+                frame.tangents.Resize(tangent_count);
+
+                for (int k = 0; k < vertex_count; ++k)
+                {
+                    frame.vertices[k] = ms.Read<Vector3>();
+                }
+                for (int k = 0; k < normal_count; ++k)
+                {
+                    frame.normals[k] = ms.Read<Vector3>();
+                }
+                for (int k = 0; k < tangent_count; ++k)
+                {
+                    frame.tangents[k] = ms.Read<Vector3>();
+                }
+            }
+        }
+
+        data.bounds_center = ms.Read<Vector3>();
+        data.bounds_size = ms.Read<Vector3>();
+
+        return true;
+    }
+
+    template<class T>
+    static void WriteValue(Vector<byte>& buffer, const T& value)
+    {
+        buffer.AddRange((const byte*) &value, sizeof(T));
+    }
+
+    static void WriteString(Vector<byte>& buffer, const String& value)
+    {
+        WriteValue<int>(buffer, value.Size());
+        buffer.AddRange((const byte*) value.CString(), value.Size());
+    }
+
+    static byte ColorByte(float value)
+    {
+        return (byte) (Mathf::Clamp01(value) * 255.0f + 0.5f);
+    }
+
+    bool MeshData::SaveToFile(const String& path) const
+    {
+        Vector<byte> buffer;
+        int vertex_count = vertices.Size();
+
+        WriteString(buffer, name);
+
+        WriteValue<int>(buffer, vertex_count);
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            WriteValue(buffer, Vector3(vertices[i].vertex));
+        }
+
+        WriteValue<int>(buffer, has_colors ? vertex_count : 0);
+        for (int i = 0; has_colors && i < vertex_count; ++i)
+        {
+            const Color& c = vertices[i].color;
+            WriteValue(buffer, ColorByte(c.r));
+            WriteValue(buffer, ColorByte(c.g));
+            WriteValue(buffer, ColorByte(c.b));
+            WriteValue(buffer, ColorByte(c.a));
+        }
+
+        WriteValue<int>(buffer, has_uv ? vertex_count : 0);
+        for (int i = 0; has_uv && i < vertex_count; ++i)
+        {
+            WriteValue(buffer, vertices[i].uv);
+        }
+
+        WriteValue<int>(buffer, has_uv2 ? vertex_count : 0);
+        for (int i = 0; has_uv2 && i < vertex_count; ++i)
+        {
+            WriteValue(buffer, vertices[i].uv2);
+        }
+
+        WriteValue<int>(buffer, has_normals ? vertex_count : 0);
+        for (int i = 0; has_normals && i < vertex_count; ++i)
+        {
+            WriteValue(buffer, vertices[i].normal);
+        }
+
+        WriteValue<int>(buffer, has_tangents ? vertex_count : 0);
+        for (int i = 0; has_tangents && i < vertex_count; ++i)
+        {
+            WriteValue(buffer, vertices[i].tangent);
+        }
+
+        WriteValue<int>(buffer, has_bone_weights ? vertex_count : 0);
+        for (int i = 0; has_bone_weights && i < vertex_count; ++i)
+        {
+            const Vector4& bone_indices = vertices[i].bone_indices;
+            WriteValue(buffer, vertices[i].bone_weights);
+            WriteValue(buffer, (byte) bone_indices.x);
+            WriteValue(buffer, (byte) bone_indices.y);
+            WriteValue(buffer, (byte) bone_indices.z);
+            WriteValue(buffer, (byte) bone_indices.w);
+        }
+
+        WriteValue<int>(buffer, indices.Size());
+        for (int i = 0; i < indices.Size(); ++i)
+        {
+            WriteValue(buffer, (unsigned short) indices[i]);
+        }
+
+        WriteValue<int>(buffer, submeshes.Size());
+        if (submeshes.Size() > 0)
+        {
+            buffer.AddRange(submeshes.Bytes(), submeshes.SizeInBytes());
+        }
+
+        WriteValue<int>(buffer, bindposes.Size());
+        if (bindposes.Size() > 0)
+        {
+            buffer.AddRange(bindposes.Bytes(), bindposes.SizeInBytes());
+        }
+
+        WriteValue<int>(buffer, blend_shapes.Size());
+        for (int i = 0; i < blend_shapes.Size(); ++i)
+        {
+            const auto& shape = blend_shapes[i];
+            WriteString(buffer, shape.name);
+            WriteValue<int>(buffer, shape.frames.Size());
+
+            for (int j = 0; j < shape.frames.Size(); ++j)
+            {
+                const auto& frame = shape.frames[j];
+                WriteValue(buffer, frame.weight);
+
+                // frame streams have the same counts as mesh streams
+                for (int k = 0; k < vertex_count; ++k)
+                {
+                    WriteValue(buffer, k < frame.vertices.Size() ? frame.vertices[k] : Vector3::Zero());
+                }
+                for (int k = 0; has_normals && k < vertex_count; ++k)
+                {
+                    WriteValue(buffer, k < frame.normals.Size() ? frame.normals[k] : Vector3::Zero());
+                }
+                for (int k = 0; has_tangents && k < vertex_count; ++k)
+                {
+                    WriteValue(buffer, k < frame.tangents.Size() ? frame.tangents[k] : Vector3::Zero());
+                }
+            }
+        }
+
+        WriteValue(buffer, bounds_center);
+        WriteValue(buffer, bounds_size);
+
+        ByteBuffer file_buffer(buffer.Size());
+        Memory::Copy(file_buffer.Bytes(), buffer.Bytes(), buffer.Size());
+
+        return File::WriteAllBytes(path, file_buffer);
+    }
+
+    // symmetric 4x4 of sum of squared distances to planes
+    struct Quadric
+    {
+        double a00 = 0;
+        double a11 = 0;
+        double a22 = 0;
+        double a10 = 0;
+        double a20 = 0;
+        double a21 = 0;
+        double b0 = 0;
+        double b1 = 0;
+        double b2 = 0;
+        double c = 0;
+
+        void AddPlane(const Vector3& n, double d, double weight)
+        {
+            a00 += n.x * n.x * weight;
+            a11 += n.y * n.y * weight;
+            a22 += n.z * n.z * weight;
+            a10 += n.y * n.x * weight;
+            a20 += n.z * n.x * weight;
+            a21 += n.z * n.y * weight;
+            b0 += n.x * d * weight;
+            b1 += n.y * d * weight;
+            b2 += n.z * d * weight;
+            c += d * d * weight;
+        }
+
+        void Add(const Quadric& q)
+        {
+            a00 += q.a00;
+            a11 += q.a11;
+            a22 += q.a22;
+            a10 += q.a10;
+            a20 += q.a20;
+            a21 += q.a21;
+            b0 += q.b0;
+            b1 += q.b1;
+            b2 += q.b2;
+            c += q.c;
+        }
+
+        double Error(const Vector3& v) const
+        {
+            double x = v.x;
+            double y = v.y;
+            double z = v.z;
+            double r = a00 * x * x + a11 * y * y + a22 * z * z +
+                2 * (a10 * x * y + a20 * x * z + a21 * y * z) +
+                2 * (b0 * x + b1 * y + b2 * z) + c;
+            return fabs(r);
+        }
+    };
+
+    enum class VertexKind
+    {
+        // interior vertex with one set of attributes, collapses to any neighbor
+        Manifold,
+        // on an open border, collapses along the border
+        Border,
+        // two sets of attributes along a uv or normal seam, both collapse along the seam together
+        Seam,
+        // corners, seam crossings, vertices shared by submeshes and other complex cases
+        Locked,
+    };
+
+    struct Collapse
+    {
+        unsigned int v0;
+        unsigned int v1;
+        // other wedge of a seam vertex, -1 if none
+        int wedge0;
+        int wedge1;
+        double error;
+    };
+
+    static uint64_t EdgeKey(unsigned int a, unsigned int b)
+    {
+        return (((uint64_t) a) << 32) | b;
+    }
+
+    static bool HasEdge(const Vector<uint64_t>& edges, unsigned int a, unsigned int b)
+    {
+        if (edges.Empty())
+        {
+            return false;
+        }
+        return std::binary_search(&edges[0], &edges[0] + edges.Size(), EdgeKey(a, b));
+    }
+
+    // position level and attribute level topology of current triangles, rebuilt every pass
+    struct Topology
+    {
+        Vector<uint64_t> position_edges;
+        Vector<uint64_t> attribute_edges;
+        Vector<int> border_out;
+        Vector<int> border_in;
+        Vector<int> seam_out;
+        Vector<int> seam_in;
+        Vector<int> seam_out_to;
+        Vector<int> seam_in_from;
+        Vector<VertexKind> kinds;
+    };
+
+    static void BuildTopology(
+        Topology& topo,
+        const Vector<unsigned int>& indices,
+        const Vector<unsigned int>& position_ids,
+        const Vector<int>& position_wedges,
+        const Vector<int>& wedge_next,
+        const Vector<byte>& static_locked)
+    {
+        int vertex_count = position_ids.Size();
+        int triangle_count = indices.Size() / 3;
+
+        topo.position_edges.Resize(triangle_count * 3);
+        topo.attribute_edges.Resize(triangle_count * 3);
+        for (int i = 0; i < triangle_count; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                unsigned int a = indices[i * 3 + j];
+                unsigned int b = indices[i * 3 + (j + 1) % 3];
+                topo.position_edges[i * 3 + j] = EdgeKey(position_ids[a], position_ids[b]);
+                topo.attribute_edges[i * 3 + j] = EdgeKey(a, b);
+            }
+        }
+        if (triangle_count > 0)
+        {
+            std::sort(&topo.position_edges[0], &topo.position_edges[0] + topo.position_edges.Size());
+            std::sort(&topo.attribute_edges[0], &topo.attribute_edges[0] + topo.attribute_edges.Size());
+        }
+
+        topo.border_out = Vector<int>(vertex_count, 0);
+        topo.border_in = Vector<int>(vertex_count, 0);
+        topo.seam_out = Vector<int>(vertex_count, 0);
+        topo.seam_in = Vector<int>(vertex_count, 0);
+        topo.seam_out_to = Vector<int>(vertex_count, -1);
+        topo.seam_in_from = Vector<int>(vertex_count, -1);
+
+        for (int i = 0; i < triangle_count; ++i)
+        {
+            for (int j = 0; j < 3; ++j)
+            {
+                unsigned int a = indices[i * 3 + j];
+                unsigned int b = indices[i * 3 + (j + 1) % 3];
+                unsigned int pa = position_ids[a];
+                unsigned int pb = position_ids[b];
+
+                if (!HasEdge(topo.position_edges, pb, pa))
+                {
+                    topo.border_out[pa]++;
+                    topo.border_in[pb]++;
+                }
+                else if (!HasEdge(topo.attribute_edges, b, a))
+                {
+                    topo.seam_out[a]++;
+                    topo.seam_out_to[a] = b;
+                    topo.seam_in[b]++;
+                    topo.seam_in_from[b] = a;
+                }
+            }
+        }
+
+        // kinds are indexed by position id
+        topo.kinds = Vector<VertexKind>(vertex_count, VertexKind::Locked);
+        for (int p = 0; p < vertex_count; ++p)
+        {
+            if (position_wedges[p] < 0 || static_locked[p])
+            {
+                continue;
+            }
+
+            bool border = topo.border_out[p] > 0 || topo.border_in[p] > 0;
+            int w0 = position_wedges[p];
+            int w1 = wedge_next[w0];
+
+            if (w1 == w0)
+            {
+                bool seam = topo.seam_out[w0] > 0 || topo.seam_in[w0] > 0;
+                if (!border && !seam)
+                {
+                    topo.kinds[p] = VertexKind::Manifold;
+                }
+                else if (!seam && topo.border_out[p] == 1 && topo.border_in[p] == 1)
+                {
+                    topo.kinds[p] = VertexKind::Border;
+                }
+            }
+            else if (wedge_next[w1] == w0 && !border &&
+                topo.seam_out[w0] == 1 && topo.seam_in[w0] == 1 &&
+                topo.seam_out[w1] == 1 && topo.seam_in[w1] == 1)
+            {
+                topo.kinds[p] = VertexKind::Seam;
+            }
+        }
+    }
+
+    static bool CanCollapse(
+        const Topology& topo,
+        const Vector<unsigned int>& position_ids,
+        const Vector<int>& wedge_next,
+        unsigned int v0,
+        unsigned int v1,
+        Collapse& collapse)
+    {
+        unsigned int p0 = position_ids[v0];
+        unsigned int p1 = position_ids[v1];
+        if (p0 == p1)
+        {
+            return false;
+        }
+
+        collapse.v0 = v0;
+        collapse.v1 = v1;
+        collapse.wedge0 = -1;
+        collapse.wedge1 = -1;
+
+        VertexKind kind0 = topo.kinds[p0];
+        VertexKind kind1 = topo.kinds[p1];
+
+        switch (kind0)
+        {
+            case VertexKind::Manifold:
+                return true;
+
+            case VertexKind::Border:
+                return (kind1 == VertexKind::Border || kind1 == VertexKind::Locked) &&
+                    (!HasEdge(topo.position_edges, p1, p0) || !HasEdge(topo.position_edges, p0, p1));
+
+            case VertexKind::Seam:
+            {
+                if (kind1 != VertexKind::Seam && kind1 != VertexKind::Locked)
+                {
+                    return false;
+                }
+
+                // the other wedge follows its own seam edge to the same target position
+                int other = wedge_next[v0];
+                int target = -1;
+                if (topo.seam_out_to[v0] == (int) v1)
+                {
+                    target = topo.seam_in_from[other];
+                }
+                else if (topo.seam_in_from[v0] == (int) v1)
+                {
+                    target = topo.seam_out_to[other];
+                }
+
+                if (target < 0 || position_ids[target] != p1)
+                {
+                    return false;
+                }
+
+                collapse.wedge0 = other;
+                collapse.wedge1 = target;
+                return true;
+            }
+
+            default:
+                return false;
+        }
+    }
+
+    // count triangles removed by moving p0 onto p1, -1 if a remaining triangle flips or degenerates
+    static int CheckCollapseTriangles(
+        const Vector<unsigned int>& indices,
+        const Vector<unsigned int>& position_ids,
+        const Vector<unsigned int>& position_remap,
+        const Vector<Vector3>& positions,
+        const Vector<int>& adjacency_offsets,
+        const Vector<int>& adjacency,
+        unsigned int p0,
+        unsigned int p1)
+    {
+        int removed = 0;
+        const Vector3& v0 = positions[p0];
+        const Vector3& v1 = positions[p1];
+
+        for (int i = adjacency_offsets[p0]; i < adjacency_offsets[p0 + 1]; ++i)
+        {
+            int t = adjacency[i];
+            unsigned int q[3];
+            for (int j = 0; j < 3; ++j)
+            {
+                q[j] = position_remap[position_ids[indices[t * 3 + j]]];
+            }
+
+            // already collapsed by an earlier collapse of this pass
+            if (q[0] == q[1] || q[1] == q[2] || q[2] == q[0])
+            {
+                continue;
+            }
+
+            if (q[0] == p1 || q[1] == p1 || q[2] == p1)
+            {
+                removed++;
+                continue;
+            }
+
+            int k = q[0] == p0 ? 0 : (q[1] == p0 ? 1 : 2);
+            const Vector3& b = positions[q[(k + 1) % 3]];
+            const Vector3& c = positions[q[(k + 2) % 3]];
+
+            Vector3 n_before = (b - v0) * (c - v0);
+            Vector3 n_after = (b - v1) * (c - v1);
+            double dot = Vector3::Dot(n_before, n_after);
+            double limit = FLIP_DOT_LIMIT * sqrt((double) n_before.SqrMagnitude() * n_after.SqrMagnitude());
+            if (dot <= limit)
+            {
+                return -1;
+            }
+        }
+
+        return removed;
+    }
+
+    MeshData MeshSimplifier::Simplify(const MeshData& data, float triangle_ratio)
+    {
+        int vertex_count = data.vertices.Size();
+
+        // submesh id of each triangle, whole index buffer is one submesh when there is no submesh
+        Vector<Mesh::Submesh> submeshes = data.submeshes;
+        if (submeshes.Empty())
+        {
+            submeshes.Add({ 0, data.indices.Size() });
+        }
+
+        // vertices with equal positions share one position id, the smallest vertex index of them
+        Vector<int> sorted(vertex_count);
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            sorted[i] = i;
+        }
+        if (vertex_count > 0)
+        {
+            std::sort(&sorted[0], &sorted[0] + vertex_count, [&](int a, int b) {
+                const Vector4& va = data.vertices[a].vertex;
+                const Vector4& vb = data.vertices[b].vertex;
+                if (va.x != vb.x) return va.x < vb.x;
+                if (va.y != vb.y) return va.y < vb.y;
+                if (va.z != vb.z) return va.z < vb.z;
+                return a < b;
+            });
+        }
+
+        Vector<unsigned int> position_ids(vertex_count);
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            const Vector4& v = data.vertices[sorted[i]].vertex;
+            if (i > 0)
+            {
+                const Vector4& prev = data.vertices[sorted[i - 1]].vertex;
+                if (prev.x == v.x && prev.y == v.y && prev.z == v.z)
+                {
+                    position_ids[sorted[i]] = position_ids[sorted[i - 1]];
+                    continue;
+                }
+            }
+            position_ids[sorted[i]] = sorted[i];
+        }
+
+        // positions normalized by mesh extent so error does not depend on scale
+        Vector3 bounds_min = vertex_count > 0 ? Vector3(data.vertices[0].vertex) : Vector3::Zero();
+        Vector3 bounds_max = bounds_min;
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            bounds_min = Vector3::Min(bounds_min, Vector3(data.vertices[i].vertex));
+            bounds_max = Vector3::Max(bounds_max, Vector3(data.vertices[i].vertex));
+        }
+        Vector3 extent_size = bounds_max - bounds_min;
+        float extent = Mathf::Max(extent_size.x, Mathf::Max(extent_size.y, extent_size.z));
+        float inv_extent = extent > 0 ? 1.0f / extent : 0.0f;
+
+        Vector<Vector3> positions(vertex_count);
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            positions[i] = (Vector3(data.vertices[i].vertex) - bounds_min) * inv_extent;
+        }
+
+        // drop triangles with repeated positions, lock positions used by more than one submesh
+        Vector<unsigned int> indices;
+        Vector<int> triangle_submeshes;
+        Vector<int> position_submeshes(vertex_count, -1);
+        Vector<byte> static_locked(vertex_count, 0);
+        for (int i = 0; i < submeshes.Size(); ++i)
+        {
+            int first = submeshes[i].index_first;
+            int count = submeshes[i].index_count;
+            for (int j = first; j + 2 < first + count && j + 2 < data.indices.Size(); j += 3)
+            {
+                unsigned int a = data.indices[j];
+                unsigned int b = data.indices[j + 1];
+                unsigned int c = data.indices[j + 2];
+                if (a >= (unsigned int) vertex_count || b >= (unsigned int) vertex_count || c >= (unsigned int) vertex_count)
+                {
+                    continue;
+                }
+                if (position_ids[a] == position_ids[b] || position_ids[b] == position_ids[c] || position_ids[c] == position_ids[a])
+                {
+                    continue;
+                }
+
+                unsigned int corners[3] = { a, b, c };
+                for (int k = 0; k < 3; ++k)
+                {
+                    unsigned int p = position_ids[corners[k]];
+                    if (position_submeshes[p] < 0)
+                    {
+                        position_submeshes[p] = i;
+                    }
+                    else if (position_submeshes[p] != i)
+                    {
+                        static_locked[p] = 1;
+                    }
+                }
+
+                indices.AddRange({ a, b, c });
+                triangle_submeshes.Add(i);
+            }
+        }
+
+        // used vertices of one position are linked in a circular wedge list headed by position_wedges,
+        // more than two wedges can not collapse along one seam
+        Vector<byte> used(vertex_count, 0);
+        for (int i = 0; i < indices.Size(); ++i)
+        {
+            used[indices[i]] = 1;
+        }
+        Vector<int> position_wedges(vertex_count, -1);
+        Vector<int> wedge_counts(vertex_count, 0);
+        Vector<int> wedge_next(vertex_count, -1);
+        for (int v = 0; v < vertex_count; ++v)
+        {
+            if (!used[v])
+            {
+                continue;
+            }
+
+            unsigned int p = position_ids[v];
+            int head = position_wedges[p];
+            if (head < 0)
+            {
+                position_wedges[p] = v;
+                wedge_next[v] = v;
+            }
+            else
+            {
+                wedge_next[v] = wedge_next[head];
+                wedge_next[head] = v;
+            }
+
+            if (++wedge_counts[p] > 2)
+            {
+                static_locked[p] = 1;
+            }
+        }
+
+        // plane quadrics weighted by area, border and seam edges add planes through the edge
+        Topology topo;
+        BuildTopology(topo, indices, position_ids, position_wedges, wedge_next, static_locked);
+
+        Vector<Quadric> quadrics(vertex_count);
+        for (int i = 0; i < indices.Size() / 3; ++i)
+        {
+            unsigned int p[3];
+            for (int j = 0; j < 3; ++j)
+            {
+                p[j] = position_ids[indices[i * 3 + j]];
+            }
+
+            Vector3 normal = (positions[p[1]] - positions[p[0]]) * (positions[p[2]] - positions[p[0]]);
+            float area = normal.Magnitude();
+            if (area <= 0)
+            {
+                continue;
+            }
+            normal = normal / area;
+
+            Quadric q;
+            q.AddPlane(normal, -Vector3::Dot(normal, positions[p[0]]), area);
+            for (int j = 0; j < 3; ++j)
+            {
+                quadrics[p[j]].Add(q);
+            }
+
+            for (int j = 0; j < 3; ++j)
+            {
+                unsigned int a = indices[i * 3 + j];
+                unsigned int b = indices[i * 3 + (j + 1) % 3];
+                unsigned int pa = p[j];
+                unsigned int pb = p[(j + 1) % 3];
+                if (HasEdge(topo.position_edges, pb, pa) && HasEdge(topo.attribute_edges, b, a))
+                {
+                    continue;
+                }
+
+                Vector3 edge = positions[pb] - positions[pa];
+                float length = edge.Magnitude();
+                Vector3 edge_normal = edge * normal;
+                float edge_normal_length = edge_normal.Magnitude();
+                if (edge_normal_length <= 0)
+                {
+                    continue;
+                }
+                edge_normal = edge_normal / edge_normal_length;
+
+                Quadric eq;
+                eq.AddPlane(edge_normal, -Vector3::Dot(edge_normal, positions[pa]), length * length * BORDER_EDGE_WEIGHT);
+                quadrics[pa].Add(eq);
+                quadrics[pb].Add(eq);
+            }
+        }
+
+        int target_triangle_count = (int) (data.indices.Size() / 3 * Mathf::Clamp01(triangle_ratio));
+        Vector<Collapse> collapses;
+        Vector<int> adjacency_offsets;
+        Vector<int> adjacency;
+
+        for (int pass = 0; pass < MAX_PASS_COUNT; ++pass)
+        {
+            int triangle_count = indices.Size() / 3;
+            if (triangle_count <= target_triangle_count)
+            {
+                break;
+            }
+
+            if (pass > 0)
+            {
+                BuildTopology(topo, indices, position_ids, position_wedges, wedge_next, static_locked);
+            }
+
+            // cheaper valid direction of every edge, error of moving p0 onto p1
+            collapses.Clear();
+            for (int i = 0; i < indices.Size(); ++i)
+            {
+                unsigned int a = indices[i];
+                unsigned int b = indices[(i % 3 == 2) ? i - 2 : i + 1];
+
+                Collapse ab;
+                Collapse ba;
+                bool can_ab = CanCollapse(topo, position_ids, wedge_next, a, b, ab);
+                bool can_ba = CanCollapse(topo, position_ids, wedge_next, b, a, ba);
+                if (can_ab)
+                {
+                    ab.error = quadrics[position_ids[a]].Error(positions[position_ids[b]]);
+                }
+                if (can_ba)
+                {
+                    ba.error = quadrics[position_ids[b]].Error(positions[position_ids[a]]);
+                }
+
+                if (can_ab && (!can_ba || ab.error <= ba.error))
+                {
+                    collapses.Add(ab);
+                }
+                else if (can_ba)
+                {
+                    collapses.Add(ba);
+                }
+            }
+            if (collapses.Empty())
+            {
+                break;
+            }
+            std::sort(&collapses[0], &collapses[0] + collapses.Size(), [](const Collapse& a, const Collapse& b) {
+                return a.error < b.error;
+            });
+
+            // triangles around each position
+            adjacency_offsets = Vector<int>(vertex_count + 1, 0);
+            for (int i = 0; i < indices.Size(); ++i)
+            {
+                adjacency_offsets[position_ids[indices[i]] + 1]++;
+            }
+            for (int i = 0; i < vertex_count; ++i)
+            {
+                adjacency_offsets[i + 1] += adjacency_offsets[i];
+            }
+            adjacency.Resize(indices.Size());
+            {
+                Vector<int> fill = adjacency_offsets;
+                for (int i = 0; i < indices.Size(); ++i)
+                {
+                    adjacency[fill[position_ids[indices[i]]]++] = i / 3;
+                }
+            }
+
+            // both ends of a collapse are locked for the rest of the pass so collapses never chain
+            Vector<unsigned int> vertex_remap(vertex_count);
+            Vector<unsigned int> position_remap(vertex_count);
+            for (int i = 0; i < vertex_count; ++i)
+            {
+                vertex_remap[i] = i;
+                position_remap[i] = i;
+            }
+            Vector<byte> collapse_locked(vertex_count, 0);
+
+            int removed_goal = triangle_count - target_triangle_count;
+            int removed_count = 0;
+            int collapse_count = 0;
+
+            for (int i = 0; i < collapses.Size() && removed_count < removed_goal; ++i)
+            {
+                const Collapse& c = collapses[i];
+                unsigned int p0 = position_ids[c.v0];
+                unsigned int p1 = position_ids[c.v1];
+                if (collapse_locked[p0] || collapse_locked[p1])
+                {
+                    continue;
+                }
+
+                int removed = CheckCollapseTriangles(indices, position_ids, position_remap, positions, adjacency_offsets, adjacency, p0, p1);
+                if (removed < 0)
+                {
+                    continue;
+                }
+
+                vertex_remap[c.v0] = c.v1;
+                if (c.wedge0 >= 0)
+                {
+                    vertex_remap[c.wedge0] = c.wedge1;
+                }
+                position_remap[p0] = p1;
+                quadrics[p1].Add(quadrics[p0]);
+
+                collapse_locked[p0] = 1;
+                collapse_locked[p1] = 1;
+                removed_count += removed;
+                collapse_count++;
+            }
+
+            if (collapse_count == 0)
+            {
+                break;
+            }
+
+            // apply remap and drop collapsed triangles, collapsed vertices leave their wedge lists
+            Vector<unsigned int> new_indices;
+            Vector<int> new_triangle_submeshes;
+            for (int i = 0; i < indices.Size() / 3; ++i)
+            {
+                unsigned int a = vertex_remap[indices[i * 3 + 0]];
+                unsigned int b = vertex_remap[indices[i * 3 + 1]];
+                unsigned int c = vertex_remap[indices[i * 3 + 2]];
+                if (position_ids[a] == position_ids[b] || position_ids[b] == position_ids[c] || position_ids[c] == position_ids[a])
+                {
+                    continue;
+                }
+
+                new_indices.AddRange({ a, b, c });
+                new_triangle_submeshes.Add(triangle_submeshes[i]);
+            }
+            indices = std::move(new_indices);
+            triangle_submeshes = std::move(new_triangle_submeshes);
+        }
+
+        // keep used vertices in source order
+        Vector<int> vertex_map(vertex_count, -1);
+        for (int i = 0; i < indices.Size(); ++i)
+        {
+            vertex_map[indices[i]] = 0;
+        }
+
+        MeshData result;
+        result.name = data.name;
+        result.has_colors = data.has_colors;
+        result.has_uv = data.has_uv;
+        result.has_uv2 = data.has_uv2;
+        result.has_normals = data.has_normals;
+        result.has_tangents = data.has_tangents;
+        result.has_bone_weights = data.has_bone_weights;
+        result.bindposes = data.bindposes;
+        result.bounds_center = data.bounds_center;
+        result.bounds_size = data.bounds_size;
+
+        for (int i = 0; i < vertex_count; ++i)
+        {
+            if (vertex_map[i] >= 0)
+            {
+                vertex_map[i] = result.vertices.Size();
+                result.vertices.Add(data.vertices[i]);
+            }
+        }
+
+        for (int i = 0; i < submeshes.Size(); ++i)
+        {
+            Mesh::Submesh submesh;
+            submesh.index_first = result.indices.Size();
+            for (int j = 0; j < triangle_submeshes.Size(); ++j)
+            {
+                if (triangle_submeshes[j] == i)
+                {
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        result.indices.Add(vertex_map[indices[j * 3 + k]]);
+                    }
+                }
+            }
+            submesh.index_count = result.indices.Size() - submesh.index_first;
+
+            if (!data.submeshes.Empty())
+            {
+                result.submeshes.Add(submesh);
+            }
+        }
+
+        result.blend_shapes.Resize(data.blend_shapes.Size());
+        for (int i = 0; i < data.blend_shapes.Size(); ++i)
+        {
+            const auto& shape = data.blend_shapes[i];
+            auto& result_shape = result.blend_shapes[i];
+            result_shape.name = shape.name;
+            result_shape.frames.Resize(shape.frames.Size());
+
+            for (int j = 0; j < shape.frames.Size(); ++j)
+            {
+                const auto& frame = shape.frames[j];
+                auto& result_frame = result_shape.frames[j];
+                result_frame.weight = frame.weight;
+
+                for (int k = 0; k < vertex_count; ++k)
+                {
+                    if (vertex_map[k] < 0)
+                    {
+                        continue;
+                    }
+                    if (k < frame.vertices.Size())
+                    {
+                        result_frame.vertices.Add(frame.vertices[k]);
+                    }
+                    if (k < frame.normals.Size())
+                    {
+                        result_frame.normals.Add(frame.normals[k]);
+                    }
+                    if (k < frame.tangents.Size())
+                    {
+                        result_frame.tangents.Add(frame.tangents[k]);
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+}
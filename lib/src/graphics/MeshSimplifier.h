@@ -0,0 +1,73 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Mesh.h"
+#include "container/Vector.h"
+#include "string/String.h"
+
+namespace Viry3D
+{
+    // cpu copy of a .mesh file, read and written without gpu resources for offline tools
+    struct MeshData
+    {
+        struct BlendShapeFrame
+        {
+            float weight;
+            Vector<Vector3> vertices;
+            Vector<Vector3> normals;
+            Vector<Vector3> tangents;
+        };
+
+        struct BlendShape
+        {
+            String name;
+            Vector<BlendShapeFrame> frames;
+        };
+
+        String name;
+        Vector<Mesh::Vertex> vertices;
+        bool has_colors = false;
+        bool has_uv = false;
+        bool has_uv2 = false;
+        bool has_normals = false;
+        bool has_tangents = false;
+        bool has_bone_weights = false;
+        Vector<unsigned int> indices;
+        Vector<Mesh::Submesh> submeshes;
+        Vector<Matrix4x4> bindposes;
+        Vector<BlendShape> blend_shapes;
+        Vector3 bounds_center;
+        Vector3 bounds_size;
+
+        static bool LoadFromFile(const String& path, MeshData& data);
+        bool SaveToFile(const String& path) const;
+        int GetTriangleCount() const { return indices.Size() / 3; }
+    };
+
+    // quadric error metric edge collapse, each vertex collapses onto a neighbor so kept vertices
+    // are a subset of source vertices and uvs, normals, bone weights and blend shapes stay untouched,
+    // uv and normal seams and open borders only collapse along themselves, vertices shared by submeshes are locked
+    class MeshSimplifier
+    {
+    public:
+        // triangle_ratio is the target triangle count / source triangle count, result may stay above it
+        // when no collapse is left that keeps locked vertices and does not flip triangles
+        static MeshData Simplify(const MeshData& data, float triangle_ratio);
+    };
+}
@@ -0,0 +1,470 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "OcclusionBuffer.h"
+#include "Mesh.h"
+#include "math/Mathf.h"
+#include "Engine.h"
+#include "thread/ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OCCLUSION_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace Viry3D
+{
+	// below this triangle count waking workers costs more than rasterizing on the calling thread
+	static const int PARALLEL_TRIANGLE_COUNT = 256;
+
+	OcclusionBuffer::OcclusionBuffer(int width, int height):
+		m_width((Mathf::Max(width, 4) + 3) & ~3),
+		m_height(Mathf::Max(height, 1))
+	{
+		int w = m_width;
+		int h = m_height;
+		while (true)
+		{
+			m_mips.Add(Vector<float>(w * h));
+			m_mip_widths.Add(w);
+			m_mip_heights.Add(h);
+
+			if (w == 1 && h == 1)
+			{
+				break;
+			}
+			w = Mathf::Max((w + 1) / 2, 1);
+			h = Mathf::Max((h + 1) / 2, 1);
+		}
+	}
+
+	void OcclusionBuffer::Clear(const Matrix4x4& view_projection)
+	{
+		m_view_projection = view_projection;
+		m_triangles.Clear();
+
+		auto& depth = m_mips[0];
+		for (int i = 0; i < depth.Size(); ++i)
+		{
+			depth[i] = 1.0f;
+		}
+	}
+
+	bool OcclusionBuffer::AddOccluder(const Ref<Mesh>& mesh, const Matrix4x4& model)
+	{
+		Matrix4x4 mvp = m_view_projection * model;
+
+		const auto& vertices = mesh->GetVertices();
+		const auto& indices = mesh->GetIndices();
+		const auto& submeshes = mesh->GetSubmeshes();
+
+		for (int i = 0; i < submeshes.Size(); ++i)
+		{
+			const auto& submesh = submeshes[i];
+			for (int j = 0; j + 2 < submesh.index_count; j += 3)
+			{
+				if (m_triangles.Size() >= MaxTriangleCount)
+				{
+					return false;
+				}
+
+				const unsigned int* index = &indices[submesh.index_first + j];
+				Vector4 a = mvp * Vector4(Vector3(vertices[index[0]].vertex), 1.0f);
+				Vector4 b = mvp * Vector4(Vector3(vertices[index[1]].vertex), 1.0f);
+				Vector4 c = mvp * Vector4(Vector3(vertices[index[2]].vertex), 1.0f);
+
+				this->AddClipTriangle(a, b, c);
+			}
+		}
+
+		return true;
+	}
+
+	bool OcclusionBuffer::AddOccluder(const Vector<Vector3>& positions, const Vector<unsigned int>& indices, const Matrix4x4& model)
+	{
+		Matrix4x4 mvp = m_view_projection * model;
+
+		for (int i = 0; i + 2 < indices.Size(); i += 3)
+		{
+			if (m_triangles.Size() >= MaxTriangleCount)
+			{
+				return false;
+			}
+
+			Vector4 a = mvp * Vector4(positions[indices[i + 0]], 1.0f);
+			Vector4 b = mvp * Vector4(positions[indices[i + 1]], 1.0f);
+			Vector4 c = mvp * Vector4(positions[indices[i + 2]], 1.0f);
+
+			this->AddClipTriangle(a, b, c);
+		}
+
+		return true;
+	}
+
+	void OcclusionBuffer::AddClipTriangle(const Vector4& a, const Vector4& b, const Vector4& c)
+	{
+		// clip against near plane z + w >= 0, a triangle becomes at most a quad
+		const Vector4* in[3] = { &a, &b, &c };
+		Vector4 out[4];
+		int out_count = 0;
+
+		for (int i = 0; i < 3; ++i)
+		{
+			const Vector4& p = *in[i];
+			const Vector4& q = *in[(i + 1) % 3];
+			float dp = p.z + p.w;
+			float dq = q.z + q.w;
+
+			if (dp >= 0)
+			{
+				out[out_count++] = p;
+			}
+			if ((dp >= 0) != (dq >= 0))
+			{
+				float t = dp / (dp - dq);
+				out[out_count++] = p + (q - p) * t;
+			}
+		}
+
+		for (int i = 1; i + 1 < out_count; ++i)
+		{
+			this->AddScreenTriangle(out[0], out[i], out[i + 1]);
+		}
+	}
+
+	void OcclusionBuffer::AddScreenTriangle(const Vector4& a, const Vector4& b, const Vector4& c)
+	{
+		const Vector4* clip[3] = { &a, &b, &c };
+		float x[3], y[3], z[3];
+
+		for (int i = 0; i < 3; ++i)
+		{
+			const Vector4& v = *clip[i];
+			if (v.w <= Mathf::Epsilon)
+			{
+				return;
+			}
+
+			float inv_w = 1.0f / v.w;
+			x[i] = (v.x * inv_w * 0.5f + 0.5f) * m_width;
+			y[i] = (v.y * inv_w * 0.5f + 0.5f) * m_height;
+			z[i] = v.z * inv_w;
+		}
+
+		Triangle t;
+		t.min_x = Mathf::Max(Mathf::FloorToInt(Mathf::Min(x[0], Mathf::Min(x[1], x[2]))), 0);
+		t.min_y = Mathf::Max(Mathf::FloorToInt(Mathf::Min(y[0], Mathf::Min(y[1], y[2]))), 0);
+		t.max_x = Mathf::Min(Mathf::FloorToInt(Mathf::Max(x[0], Mathf::Max(x[1], x[2]))), m_width - 1);
+		t.max_y = Mathf::Min(Mathf::FloorToInt(Mathf::Max(y[0], Mathf::Max(y[1], y[2]))), m_height - 1);
+		if (t.min_x > t.max_x || t.min_y > t.max_y)
+		{
+			return;
+		}
+
+		// edge i is opposite to vertex i, e(x, y) = a * x + b * y + c is positive inside
+		for (int i = 0; i < 3; ++i)
+		{
+			int p = (i + 1) % 3;
+			int q = (i + 2) % 3;
+			t.edge_a[i] = y[p] - y[q];
+			t.edge_b[i] = x[q] - x[p];
+			t.edge_c[i] = x[p] * y[q] - x[q] * y[p];
+		}
+
+		// both windings are rasterized, occluders may be single sided walls
+		float area = t.edge_a[0] * x[0] + t.edge_b[0] * y[0] + t.edge_c[0];
+		if (fabs(area) < Mathf::Epsilon)
+		{
+			return;
+		}
+		if (area < 0)
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				t.edge_a[i] = -t.edge_a[i];
+				t.edge_b[i] = -t.edge_b[i];
+				t.edge_c[i] = -t.edge_c[i];
+			}
+			area = -area;
+		}
+
+		// depth plane from barycentric weights e(x, y) / area
+		float inv_area = 1.0f / area;
+		t.depth_a = (t.edge_a[0] * z[0] + t.edge_a[1] * z[1] + t.edge_a[2] * z[2]) * inv_area;
+		t.depth_b = (t.edge_b[0] * z[0] + t.edge_b[1] * z[1] + t.edge_b[2] * z[2]) * inv_area;
+		t.depth_c = (t.edge_c[0] * z[0] + t.edge_c[1] * z[1] + t.edge_c[2] * z[2]) * inv_area;
+
+		m_triangles.Add(t);
+	}
+
+	void OcclusionBuffer::Rasterize()
+	{
+		if (m_triangles.Size() > 0)
+		{
+#if VR_WASM
+			this->RasterizeBand(0, m_height);
+#else
+			ThreadPool* thread_pool = Engine::Instance() ? Engine::Instance()->GetThreadPool() : nullptr;
+			if (thread_pool && m_triangles.Size() >= PARALLEL_TRIANGLE_COUNT)
+			{
+				// bands own disjoint rows, no locking on depth writes, calling thread takes band 0
+				int band_count = thread_pool->GetThreadCount() + 1;
+				int band_height = (m_height + band_count - 1) / band_count;
+
+				// the engine pool also runs async loading, wait only for the bands instead of WaitAll
+				std::mutex mutex;
+				std::condition_variable condition;
+				int pending = band_count - 1;
+
+				for (int i = 1; i < band_count; ++i)
+				{
+					int y_begin = Mathf::Min(i * band_height, m_height);
+					int y_end = Mathf::Min(y_begin + band_height, m_height);
+
+					Thread::Task task;
+					task.job = [this, y_begin, y_end, &mutex, &condition, &pending]() {
+						this->RasterizeBand(y_begin, y_end);
+
+						std::lock_guard<std::mutex> lock(mutex);
+						pending--;
+						condition.notify_one();
+						return nullptr;
+					};
+					thread_pool->AddTask(task, i - 1);
+				}
+
+				this->RasterizeBand(0, Mathf::Min(band_height, m_height));
+
+				std::unique_lock<std::mutex> lock(mutex);
+				condition.wait(lock, [&pending]() {
+					return pending == 0;
+				});
+			}
+			else
+			{
+				this->RasterizeBand(0, m_height);
+			}
+#endif
+		}
+
+		this->BuildMips();
+	}
+
+	void OcclusionBuffer::RasterizeBand(int y_begin, int y_end)
+	{
+		float* depth = &m_mips[0][0];
+
+		for (int i = 0; i < m_triangles.Size(); ++i)
+		{
+			const Triangle& t = m_triangles[i];
+			int y0 = Mathf::Max(t.min_y, y_begin);
+			int y1 = Mathf::Min(t.max_y, y_end - 1);
+			int x0 = t.min_x & ~3;
+
+			for (int y = y0; y <= y1; ++y)
+			{
+				// sample at pixel centers
+				float py = y + 0.5f;
+				float row_e0 = t.edge_b[0] * py + t.edge_c[0];
+				float row_e1 = t.edge_b[1] * py + t.edge_c[1];
+				float row_e2 = t.edge_b[2] * py + t.edge_c[2];
+				float row_z = t.depth_b * py + t.depth_c;
+				float* row = &depth[y * m_width];
+
+#if defined(OCCLUSION_SSE)
+				__m128 a0 = _mm_set1_ps(t.edge_a[0]);
+				__m128 a1 = _mm_set1_ps(t.edge_a[1]);
+				__m128 a2 = _mm_set1_ps(t.edge_a[2]);
+				__m128 az = _mm_set1_ps(t.depth_a);
+				__m128 r0 = _mm_set1_ps(row_e0);
+				__m128 r1 = _mm_set1_ps(row_e1);
+				__m128 r2 = _mm_set1_ps(row_e2);
+				__m128 rz = _mm_set1_ps(row_z);
+				__m128 zero = _mm_setzero_ps();
+
+				for (int x = x0; x <= t.max_x; x += 4)
+				{
+					__m128 px = _mm_add_ps(_mm_set1_ps((float) x), _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f));
+					__m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), r0);
+					__m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), r1);
+					__m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), r2);
+					__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+					if (_mm_movemask_ps(inside) == 0)
+					{
+						continue;
+					}
+
+					__m128 z = _mm_add_ps(_mm_mul_ps(az, px), rz);
+					__m128 old_z = _mm_loadu_ps(&row[x]);
+					__m128 new_z = _mm_min_ps(old_z, z);
+					_mm_storeu_ps(&row[x], _mm_or_ps(_mm_and_ps(inside, new_z), _mm_andnot_ps(inside, old_z)));
+				}
+#elif defined(OCCLUSION_NEON)
+				float32x4_t a0 = vdupq_n_f32(t.edge_a[0]);
+				float32x4_t a1 = vdupq_n_f32(t.edge_a[1]);
+				float32x4_t a2 = vdupq_n_f32(t.edge_a[2]);
+				float32x4_t az = vdupq_n_f32(t.depth_a);
+				float32x4_t r0 = vdupq_n_f32(row_e0);
+				float32x4_t r1 = vdupq_n_f32(row_e1);
+				float32x4_t r2 = vdupq_n_f32(row_e2);
+				float32x4_t rz = vdupq_n_f32(row_z);
+				float32x4_t zero = vdupq_n_f32(0.0f);
+				const float offsets[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+				float32x4_t offset = vld1q_f32(offsets);
+
+				for (int x = x0; x <= t.max_x; x += 4)
+				{
+					float32x4_t px = vaddq_f32(vdupq_n_f32((float) x), offset);
+					float32x4_t e0 = vmlaq_f32(r0, a0, px);
+					float32x4_t e1 = vmlaq_f32(r1, a1, px);
+					float32x4_t e2 = vmlaq_f32(r2, a2, px);
+					uint32x4_t inside = vandq_u32(vandq_u32(vcgeq_f32(e0, zero), vcgeq_f32(e1, zero)), vcgeq_f32(e2, zero));
+
+					float32x4_t z = vmlaq_f32(rz, az, px);
+					float32x4_t old_z = vld1q_f32(&row[x]);
+					vst1q_f32(&row[x], vbslq_f32(inside, vminq_f32(old_z, z), old_z));
+				}
+#else
+				for (int x = t.min_x; x <= t.max_x; ++x)
+				{
+					float px = x + 0.5f;
+					if (t.edge_a[0] * px + row_e0 >= 0 &&
+						t.edge_a[1] * px + row_e1 >= 0 &&
+						t.edge_a[2] * px + row_e2 >= 0)
+					{
+						float z = t.depth_a * px + row_z;
+						if (z < row[x])
+						{
+							row[x] = z;
+						}
+					}
+				}
+#endif
+			}
+		}
+	}
+
+	void OcclusionBuffer::BuildMips()
+	{
+		// each texel keeps the farthest depth of its footprint, so a nearer rect is surely in front
+		for (int level = 1; level < m_mips.Size(); ++level)
+		{
+			const float* src = &m_mips[level - 1][0];
+			float* dst = &m_mips[level][0];
+			int src_w = m_mip_widths[level - 1];
+			int src_h = m_mip_heights[level - 1];
+			int dst_w = m_mip_widths[level];
+			int dst_h = m_mip_heights[level];
+
+			for (int y = 0; y < dst_h; ++y)
+			{
+				int sy0 = Mathf::Min(y * 2, src_h - 1);
+				int sy1 = Mathf::Min(y * 2 + 1, src_h - 1);
+
+				for (int x = 0; x < dst_w; ++x)
+				{
+					int sx0 = Mathf::Min(x * 2, src_w - 1);
+					int sx1 = Mathf::Min(x * 2 + 1, src_w - 1);
+
+					dst[y * dst_w + x] = Mathf::Max(
+						Mathf::Max(src[sy0 * src_w + sx0], src[sy0 * src_w + sx1]),
+						Mathf::Max(src[sy1 * src_w + sx0], src[sy1 * src_w + sx1]));
+				}
+			}
+		}
+	}
+
+	bool OcclusionBuffer::IsVisible(const Bounds& bounds) const
+	{
+		const Vector3& min = bounds.Min();
+		const Vector3& max = bounds.Max();
+
+		float min_x = 1e9f, max_x = -1e9f, min_y = 1e9f, max_y = -1e9f;
+		float min_z = 1e9f;
+
+		for (int i = 0; i < 8; ++i)
+		{
+			Vector3 corner(
+				(i & 1) ? max.x : min.x,
+				(i & 2) ? max.y : min.y,
+				(i & 4) ? max.z : min.z);
+			Vector4 clip = m_view_projection * Vector4(corner, 1.0f);
+
+			if (clip.w <= Mathf::Epsilon || clip.z < -clip.w)
+			{
+				return true;
+			}
+
+			float inv_w = 1.0f / clip.w;
+			float x = clip.x * inv_w;
+			float y = clip.y * inv_w;
+			float z = clip.z * inv_w;
+
+			min_x = Mathf::Min(min_x, x);
+			max_x = Mathf::Max(max_x, x);
+			min_y = Mathf::Min(min_y, y);
+			max_y = Mathf::Max(max_y, y);
+			min_z = Mathf::Min(min_z, z);
+		}
+
+		int x0 = Mathf::FloorToInt((min_x * 0.5f + 0.5f) * m_width);
+		int x1 = Mathf::FloorToInt((max_x * 0.5f + 0.5f) * m_width);
+		int y0 = Mathf::FloorToInt((min_y * 0.5f + 0.5f) * m_height);
+		int y1 = Mathf::FloorToInt((max_y * 0.5f + 0.5f) * m_height);
+
+		// off screen boxes are left to frustum culling
+		if (x1 < 0 || y1 < 0 || x0 >= m_width || y0 >= m_height)
+		{
+			return true;
+		}
+
+		x0 = Mathf::Max(x0, 0);
+		y0 = Mathf::Max(y0, 0);
+		x1 = Mathf::Min(x1, m_width - 1);
+		y1 = Mathf::Min(y1, m_height - 1);
+
+		// coarsest level covering the rect with at most 2 x 2 texels
+		int level = 0;
+		while ((x1 - x0 > 1 || y1 - y0 > 1) && level + 1 < m_mips.Size())
+		{
+			x0 >>= 1;
+			y0 >>= 1;
+			x1 >>= 1;
+			y1 >>= 1;
+			level++;
+		}
+
+		const auto& mip = m_mips[level];
+		int mip_width = m_mip_widths[level];
+
+		for (int y = y0; y <= y1; ++y)
+		{
+			for (int x = x0; x <= x1; ++x)
+			{
+				if (min_z <= mip[y * mip_width + x])
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+}
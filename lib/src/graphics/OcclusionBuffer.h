@@ -0,0 +1,81 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "math/Matrix4x4.h"
+#include "math/Vector4.h"
+#include "math/Bounds.h"
+#include "container/Vector.h"
+
+namespace Viry3D
+{
+	class Mesh;
+
+	// low resolution cpu depth buffer, occluder triangles are rasterized in horizontal bands on worker threads,
+	// occludees are tested as screen rects against a max depth mip chain, depth is ndc z in -1 ~ 1
+	class OcclusionBuffer
+	{
+	public:
+		static const int MaxTriangleCount = 65536;
+
+		// width is rounded up to a multiple of 4
+		OcclusionBuffer(int width = 256, int height = 128);
+		int GetWidth() const { return m_width; }
+		int GetHeight() const { return m_height; }
+		// begin a frame, drop all occluders
+		void Clear(const Matrix4x4& view_projection);
+		// return false when triangle count reaches MaxTriangleCount
+		bool AddOccluder(const Ref<Mesh>& mesh, const Matrix4x4& model);
+		bool AddOccluder(const Vector<Vector3>& positions, const Vector<unsigned int>& indices, const Matrix4x4& model);
+		int GetTriangleCount() const { return m_triangles.Size(); }
+		// rasterize added occluders and build the hierarchical z
+		void Rasterize();
+		// false only if the box is fully behind rasterized occluders, boxes crossing near plane are visible
+		bool IsVisible(const Bounds& bounds) const;
+		float GetDepth(int x, int y) const { return m_mips[0][y * m_width + x]; }
+
+	private:
+		struct Triangle
+		{
+			float edge_a[3];
+			float edge_b[3];
+			float edge_c[3];
+			float depth_a;
+			float depth_b;
+			float depth_c;
+			int min_x;
+			int min_y;
+			int max_x;
+			int max_y;
+		};
+
+		void AddClipTriangle(const Vector4& a, const Vector4& b, const Vector4& c);
+		void AddScreenTriangle(const Vector4& a, const Vector4& b, const Vector4& c);
+		void RasterizeBand(int y_begin, int y_end);
+		void BuildMips();
+
+	private:
+		int m_width;
+		int m_height;
+		Matrix4x4 m_view_projection;
+		Vector<Triangle> m_triangles;
+		Vector<Vector<float>> m_mips;
+		Vector<int> m_mip_widths;
+		Vector<int> m_mip_heights;
+	};
+}
@@ -0,0 +1,382 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "RenderGraph.h"
+
+namespace Viry3D
+{
+	RenderGraph::RenderGraph():
+		m_target_count(0),
+		m_pass_count(0),
+		m_compiled(false)
+	{
+
+	}
+
+	void RenderGraph::Clear()
+	{
+		for (int i = 0; i < m_targets.Size(); ++i)
+		{
+			m_targets[i].target.reset();
+		}
+		for (int i = 0; i < m_passes.Size(); ++i)
+		{
+			m_passes[i].execute = nullptr;
+		}
+
+		m_target_count = 0;
+		m_pass_count = 0;
+	}
+
+	RenderGraph::Target& RenderGraph::DeclareTarget(const String& name, const RenderTargetKey& key, bool imported)
+	{
+		// entries of the last declaration are overwritten in place, the plan stays valid while they match
+		if (m_target_count == m_targets.Size())
+		{
+			Target t;
+			t.imported = imported;
+			t.first_pass = -1;
+			t.last_pass = -1;
+			t.physical = -1;
+			m_targets.Add(t);
+			m_compiled = false;
+		}
+		else if (m_targets[m_target_count].imported != imported || m_targets[m_target_count].key.u != key.u)
+		{
+			m_compiled = false;
+		}
+
+		Target& t = m_targets[m_target_count++];
+		t.name = name;
+		t.key = key;
+		t.imported = imported;
+
+		return t;
+	}
+
+	int RenderGraph::ImportTarget(const String& name, const Ref<RenderTarget>& target)
+	{
+		this->DeclareTarget(name, target->key, true).target = target;
+
+		return m_target_count - 1;
+	}
+
+	int RenderGraph::CreateTarget(const String& name, const RenderTargetKey& key)
+	{
+		this->DeclareTarget(name, key, false);
+
+		return m_target_count - 1;
+	}
+
+	int RenderGraph::CreateTarget(
+		const String& name,
+		int width,
+		int height,
+		TextureFormat color_format,
+		TextureFormat depth_format,
+		FilterMode filter_mode,
+		SamplerAddressMode wrap_mode,
+		filament::backend::TargetBufferFlags flags)
+	{
+		RenderTargetKey key;
+		key.width = width;
+		key.height = height;
+		key.color_format = color_format;
+		key.depth_format = depth_format;
+		key.filter_mode = filter_mode;
+		key.wrap_mode = wrap_mode;
+		key.flags = flags;
+
+		return this->CreateTarget(name, key);
+	}
+
+	static bool IsSameTargets(const Vector<int>& a, const int* b, int count)
+	{
+		if (a.Size() != count)
+		{
+			return false;
+		}
+		for (int i = 0; i < count; ++i)
+		{
+			if (a[i] != b[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static void CopyTargets(Vector<int>& a, const int* b, int count)
+	{
+		a.Clear();
+		a.AddRange(b, count);
+	}
+
+	int RenderGraph::AddPass(const String& name, std::initializer_list<int> reads, std::initializer_list<int> writes, ExecuteFunc execute)
+	{
+		return this->DeclarePass(name, reads.begin(), (int) reads.size(), writes.begin(), (int) writes.size(), execute);
+	}
+
+	int RenderGraph::AddPass(const String& name, const Vector<int>& reads, const Vector<int>& writes, ExecuteFunc execute)
+	{
+		return this->DeclarePass(
+			name,
+			reads.Size() > 0 ? &reads[0] : nullptr,
+			reads.Size(),
+			writes.Size() > 0 ? &writes[0] : nullptr,
+			writes.Size(),
+			execute);
+	}
+
+	int RenderGraph::DeclarePass(const String& name, const int* reads, int read_count, const int* writes, int write_count, ExecuteFunc& execute)
+	{
+		if (m_pass_count == m_passes.Size())
+		{
+			Pass p;
+			p.culled = true;
+			m_passes.Add(p);
+			m_compiled = false;
+		}
+
+		Pass& p = m_passes[m_pass_count++];
+		if (!IsSameTargets(p.reads, reads, read_count) || !IsSameTargets(p.writes, writes, write_count))
+		{
+			CopyTargets(p.reads, reads, read_count);
+			CopyTargets(p.writes, writes, write_count);
+			m_compiled = false;
+		}
+		p.name = name;
+		p.execute = std::move(execute);
+
+		return m_pass_count - 1;
+	}
+
+	const Ref<RenderTarget>& RenderGraph::GetTarget(int target) const
+	{
+		const Target& t = m_targets[target];
+		if (t.imported || t.physical < 0)
+		{
+			return t.target;
+		}
+		return m_physicals[t.physical].target;
+	}
+
+	void RenderGraph::Compile()
+	{
+		m_targets.Resize(m_target_count);
+		m_passes.Resize(m_pass_count);
+		m_physicals.Clear();
+		m_order.Clear();
+
+		for (int i = 0; i < m_targets.Size(); ++i)
+		{
+			m_targets[i].first_pass = -1;
+			m_targets[i].last_pass = -1;
+			m_targets[i].physical = -1;
+		}
+
+		// walk back from imported targets, a write satisfies the read of a transient target after it,
+		// so earlier writes to the same target are only kept if something reads them in between
+		Vector<byte> needed(m_targets.Size(), 0);
+		for (int i = 0; i < m_targets.Size(); ++i)
+		{
+			needed[i] = m_targets[i].imported ? 1 : 0;
+		}
+
+		for (int i = m_passes.Size() - 1; i >= 0; --i)
+		{
+			Pass& pass = m_passes[i];
+			pass.culled = true;
+
+			for (int j = 0; j < pass.writes.Size(); ++j)
+			{
+				if (needed[pass.writes[j]])
+				{
+					pass.culled = false;
+					break;
+				}
+			}
+
+			if (pass.culled)
+			{
+				continue;
+			}
+
+			for (int j = 0; j < pass.writes.Size(); ++j)
+			{
+				int w = pass.writes[j];
+				needed[w] = m_targets[w].imported ? 1 : 0;
+			}
+			for (int j = 0; j < pass.reads.Size(); ++j)
+			{
+				needed[pass.reads[j]] = 1;
+			}
+		}
+
+		for (int i = 0; i < m_passes.Size(); ++i)
+		{
+			if (m_passes[i].culled)
+			{
+				continue;
+			}
+
+			int order = m_order.Size();
+			m_order.Add(i);
+
+			auto use = [&](int target) {
+				Target& t = m_targets[target];
+				if (t.first_pass < 0)
+				{
+					t.first_pass = order;
+				}
+				t.last_pass = order;
+			};
+
+			for (int j = 0; j < m_passes[i].reads.Size(); ++j)
+			{
+				int r = m_passes[i].reads[j];
+				// a transient target must be written before it is read
+				assert(m_targets[r].imported || m_targets[r].first_pass >= 0);
+				use(r);
+			}
+			for (int j = 0; j < m_passes[i].writes.Size(); ++j)
+			{
+				use(m_passes[i].writes[j]);
+			}
+		}
+
+		// targets starting at a pass take free physical targets with the same key before targets ending
+		// at that pass free theirs, so a pass never reads and writes one physical target
+		Vector<int> free_physicals;
+		for (int i = 0; i < m_order.Size(); ++i)
+		{
+			for (int j = 0; j < m_targets.Size(); ++j)
+			{
+				Target& t = m_targets[j];
+				if (t.imported || t.first_pass != i)
+				{
+					continue;
+				}
+
+				for (int k = free_physicals.Size() - 1; k >= 0; --k)
+				{
+					if (m_physicals[free_physicals[k]].key.u == t.key.u)
+					{
+						t.physical = free_physicals[k];
+						free_physicals[k] = free_physicals[free_physicals.Size() - 1];
+						free_physicals.Resize(free_physicals.Size() - 1);
+						break;
+					}
+				}
+
+				if (t.physical < 0)
+				{
+					Physical p;
+					p.key = t.key;
+					p.first_pass = i;
+					m_physicals.Add(p);
+					t.physical = m_physicals.Size() - 1;
+				}
+
+				m_physicals[t.physical].last_pass = t.last_pass;
+			}
+
+			for (int j = 0; j < m_targets.Size(); ++j)
+			{
+				const Target& t = m_targets[j];
+				if (!t.imported && t.last_pass == i)
+				{
+					free_physicals.Add(t.physical);
+				}
+			}
+		}
+
+		m_compiled = true;
+	}
+
+	void RenderGraph::Execute()
+	{
+		// fewer targets or passes than the compiled declaration
+		if (m_target_count != m_targets.Size() || m_pass_count != m_passes.Size())
+		{
+			m_compiled = false;
+		}
+
+		if (!m_compiled)
+		{
+			this->Compile();
+		}
+
+		for (int i = 0; i < m_order.Size(); ++i)
+		{
+			for (int j = 0; j < m_physicals.Size(); ++j)
+			{
+				Physical& p = m_physicals[j];
+				if (p.first_pass == i)
+				{
+					p.target = RenderTarget::GetTemporaryRenderTarget(
+						p.key.width,
+						p.key.height,
+						p.key.color_format,
+						p.key.depth_format,
+						p.key.filter_mode,
+						p.key.wrap_mode,
+						p.key.flags);
+				}
+			}
+
+			const Pass& pass = m_passes[m_order[i]];
+			if (pass.execute)
+			{
+				pass.execute(*this);
+			}
+
+			for (int j = 0; j < m_physicals.Size(); ++j)
+			{
+				Physical& p = m_physicals[j];
+				if (p.last_pass == i)
+				{
+					RenderTarget::ReleaseTemporaryRenderTarget(p.target);
+					p.target.reset();
+				}
+			}
+		}
+	}
+
+	int RenderGraph::GetTransientMemorySize() const
+	{
+		int size = 0;
+		for (int i = 0; i < m_physicals.Size(); ++i)
+		{
+			size += m_physicals[i].key.GetMemorySize();
+		}
+		return size;
+	}
+
+	int RenderGraph::GetUnaliasedMemorySize() const
+	{
+		int size = 0;
+		for (int i = 0; i < m_target_count; ++i)
+		{
+			if (m_targets[i].physical >= 0)
+			{
+				size += m_targets[i].key.GetMemorySize();
+			}
+		}
+		return size;
+	}
+}
@@ -0,0 +1,123 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "RenderTarget.h"
+#include "memory/Ref.h"
+#include "container/Vector.h"
+#include "string/String.h"
+#include <functional>
+#include <initializer_list>
+
+namespace Viry3D
+{
+	// passes declare render targets they read and write, compile culls passes whose results are never read
+	// and assigns transient targets with non overlapping lifetimes and equal keys to one physical target.
+	// passes execute in declaration order, a read sees the latest write declared before it.
+	// a graph kept across frames is cleared and declared again each frame, the plan is only compiled again
+	// when target keys or pass reads and writes differ from the last declaration
+	class RenderGraph
+	{
+	public:
+		typedef std::function<void(RenderGraph& graph)> ExecuteFunc;
+
+		RenderGraph();
+		// drop targets and passes after execution, storage and the compiled plan are kept for the next declaration
+		void Clear();
+		// target owned outside the graph, never aliased, passes writing it are never culled
+		int ImportTarget(const String& name, const Ref<RenderTarget>& target);
+		// target taken from the temporary pool only from its first to its last using pass
+		int CreateTarget(const String& name, const RenderTargetKey& key);
+		int CreateTarget(
+			const String& name,
+			int width,
+			int height,
+			TextureFormat color_format,
+			TextureFormat depth_format,
+			FilterMode filter_mode,
+			SamplerAddressMode wrap_mode,
+			filament::backend::TargetBufferFlags flags);
+		// reads and writes are copied into storage of the pass declared at the same index last time, keep captures of
+		// execute within the small storage of std::function, like this and a few ints, so a frame does not allocate
+		int AddPass(const String& name, std::initializer_list<int> reads, std::initializer_list<int> writes, ExecuteFunc execute);
+		int AddPass(const String& name, const Vector<int>& reads, const Vector<int>& writes, ExecuteFunc execute);
+		// build the plan without touching gpu resources
+		void Compile();
+		void Execute();
+		int GetTargetCount() const { return m_target_count; }
+		const String& GetTargetName(int target) const { return m_targets[target].name; }
+		const RenderTargetKey& GetTargetKey(int target) const { return m_targets[target].key; }
+		bool IsTargetImported(int target) const { return m_targets[target].imported; }
+		// valid for imported targets, and for transient targets while a pass using them executes
+		const Ref<RenderTarget>& GetTarget(int target) const;
+		int GetPassCount() const { return m_pass_count; }
+		bool IsCompiled() const { return m_compiled; }
+		const String& GetPassName(int pass) const { return m_passes[pass].name; }
+		bool IsPassCulled(int pass) const { return m_passes[pass].culled; }
+		// indices of passes left after culling in execution order
+		const Vector<int>& GetPassOrder() const { return m_order; }
+		// -1 for imported and unused targets
+		int GetPhysicalTarget(int target) const { return m_targets[target].physical; }
+		int GetPhysicalTargetCount() const { return m_physicals.Size(); }
+		const RenderTargetKey& GetPhysicalTargetKey(int physical) const { return m_physicals[physical].key; }
+		// bytes of transient targets after aliasing, and if each used transient target had its own
+		int GetTransientMemorySize() const;
+		int GetUnaliasedMemorySize() const;
+
+	private:
+		struct Target
+		{
+			String name;
+			RenderTargetKey key;
+			Ref<RenderTarget> target;
+			bool imported;
+			int first_pass;
+			int last_pass;
+			int physical;
+		};
+
+		struct Pass
+		{
+			String name;
+			Vector<int> reads;
+			Vector<int> writes;
+			ExecuteFunc execute;
+			bool culled;
+		};
+
+		struct Physical
+		{
+			RenderTargetKey key;
+			Ref<RenderTarget> target;
+			int first_pass;
+			int last_pass;
+		};
+
+		Target& DeclareTarget(const String& name, const RenderTargetKey& key, bool imported);
+		int DeclarePass(const String& name, const int* reads, int read_count, const int* writes, int write_count, ExecuteFunc& execute);
+
+	private:
+		Vector<Target> m_targets;
+		Vector<Pass> m_passes;
+		Vector<Physical> m_physicals;
+		Vector<int> m_order;
+		int m_target_count;
+		int m_pass_count;
+		bool m_compiled;
+	};
+}
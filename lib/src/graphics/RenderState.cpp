@@ -0,0 +1,117 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "RenderState.h"
+#include "Engine.h"
+#include "time/Time.h"
+
+namespace Viry3D
+{
+	RenderState::RenderState()
+	{
+		this->Reset();
+	}
+
+	void RenderState::Reset()
+	{
+		for (size_t i = 0; i < filament::backend::CONFIG_UNIFORM_BINDING_COUNT; ++i)
+		{
+			m_uniform_buffers[i] = filament::backend::HandleBase::nullid;
+			m_uniform_offsets[i] = WholeBuffer;
+		}
+
+		for (size_t i = 0; i < filament::backend::CONFIG_SAMPLER_BINDING_COUNT; ++i)
+		{
+			m_samplers[i] = filament::backend::HandleBase::nullid;
+		}
+
+		m_scissor_valid = false;
+		m_scissor_left = 0;
+		m_scissor_bottom = 0;
+		m_scissor_width = 0;
+		m_scissor_height = 0;
+	}
+
+	void RenderState::BindUniformBuffer(size_t binding, const filament::backend::UniformBufferHandle& buffer)
+	{
+		assert(binding < filament::backend::CONFIG_UNIFORM_BINDING_COUNT);
+
+		if (m_uniform_buffers[binding] == buffer.getId() && m_uniform_offsets[binding] == WholeBuffer)
+		{
+			Time::SetSkippedStateChange(Time::GetSkippedStateChange() + 1);
+			return;
+		}
+		m_uniform_buffers[binding] = buffer.getId();
+		m_uniform_offsets[binding] = WholeBuffer;
+
+		auto& driver = Engine::Instance()->GetDriverApi();
+		driver.bindUniformBuffer(binding, buffer);
+	}
+
+	void RenderState::BindUniformBufferRange(size_t binding, const filament::backend::UniformBufferHandle& buffer, size_t offset, size_t size)
+	{
+		assert(binding < filament::backend::CONFIG_UNIFORM_BINDING_COUNT);
+
+		// size is fixed per binding point, so buffer and offset identify the range
+		if (m_uniform_buffers[binding] == buffer.getId() && m_uniform_offsets[binding] == offset)
+		{
+			Time::SetSkippedStateChange(Time::GetSkippedStateChange() + 1);
+			return;
+		}
+		m_uniform_buffers[binding] = buffer.getId();
+		m_uniform_offsets[binding] = offset;
+
+		auto& driver = Engine::Instance()->GetDriverApi();
+		driver.bindUniformBufferRange(binding, buffer, offset, size);
+	}
+
+	void RenderState::BindSamplers(size_t binding, const filament::backend::SamplerGroupHandle& samplers)
+	{
+		assert(binding < filament::backend::CONFIG_SAMPLER_BINDING_COUNT);
+
+		if (m_samplers[binding] == samplers.getId())
+		{
+			Time::SetSkippedStateChange(Time::GetSkippedStateChange() + 1);
+			return;
+		}
+		m_samplers[binding] = samplers.getId();
+
+		auto& driver = Engine::Instance()->GetDriverApi();
+		driver.bindSamplers(binding, samplers);
+	}
+
+	void RenderState::SetViewportScissor(int32_t left, int32_t bottom, uint32_t width, uint32_t height)
+	{
+		if (m_scissor_valid &&
+			m_scissor_left == left &&
+			m_scissor_bottom == bottom &&
+			m_scissor_width == width &&
+			m_scissor_height == height)
+		{
+			Time::SetSkippedStateChange(Time::GetSkippedStateChange() + 1);
+			return;
+		}
+		m_scissor_valid = true;
+		m_scissor_left = left;
+		m_scissor_bottom = bottom;
+		m_scissor_width = width;
+		m_scissor_height = height;
+
+		auto& driver = Engine::Instance()->GetDriverApi();
+		driver.setViewportScissor(left, bottom, width, height);
+	}
+}
@@ -0,0 +1,50 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "private/backend/DriverApi.h"
+
+namespace Viry3D
+{
+	// remembers bindings issued inside a render pass and drops commands that would change nothing,
+	// skipped commands are counted by Time::GetSkippedStateChange
+	class RenderState
+	{
+	public:
+		RenderState();
+		// call after beginRenderPass, driver state is unknown at that point
+		void Reset();
+		void BindUniformBuffer(size_t binding, const filament::backend::UniformBufferHandle& buffer);
+		void BindUniformBufferRange(size_t binding, const filament::backend::UniformBufferHandle& buffer, size_t offset, size_t size);
+		void BindSamplers(size_t binding, const filament::backend::SamplerGroupHandle& samplers);
+		void SetViewportScissor(int32_t left, int32_t bottom, uint32_t width, uint32_t height);
+
+	private:
+		static const size_t WholeBuffer = (size_t) -1;
+
+		filament::backend::HandleBase::HandleId m_uniform_buffers[filament::backend::CONFIG_UNIFORM_BINDING_COUNT];
+		// WholeBuffer when bound without range
+		size_t m_uniform_offsets[filament::backend::CONFIG_UNIFORM_BINDING_COUNT];
+		filament::backend::HandleBase::HandleId m_samplers[filament::backend::CONFIG_SAMPLER_BINDING_COUNT];
+		bool m_scissor_valid;
+		int32_t m_scissor_left;
+		int32_t m_scissor_bottom;
+		uint32_t m_scissor_width;
+		uint32_t m_scissor_height;
+	};
+}
@@ -17,11 +17,55 @@
 
 #include "RenderTarget.h"
 #include "Engine.h"
+#include "time/Time.h"
 
 namespace Viry3D
 {
 	Map<uint64_t, TemporaryRenderTargets> RenderTarget::m_temporary_render_targets_using;
 	Map<uint64_t, TemporaryRenderTargets> RenderTarget::m_temporary_render_targets_idle;
+	int RenderTarget::m_temporary_idle_frames = 60;
+	int RenderTarget::m_temporary_budget = 0;
+	RenderTarget::TemporaryStats RenderTarget::m_temporary_stats = { 0, 0, 0, 0 };
+
+	static int GetPixelSize(TextureFormat format)
+	{
+		switch (format)
+		{
+			case TextureFormat::R8:
+				return 1;
+			case TextureFormat::R16F:
+			case TextureFormat::D16:
+				return 2;
+			case TextureFormat::R8G8B8A8:
+			case TextureFormat::R32F:
+			case TextureFormat::R11G11B10F:
+			case TextureFormat::D24X8:
+			case TextureFormat::D32:
+			case TextureFormat::D24S8:
+				return 4;
+			case TextureFormat::R16G16B16A16F:
+			case TextureFormat::D32S8:
+				return 8;
+			case TextureFormat::R32G32B32A32F:
+				return 16;
+			default:
+				return 0;
+		}
+	}
+
+	int RenderTargetKey::GetMemorySize() const
+	{
+		int pixel_size = 0;
+		if (flags & filament::backend::TargetBufferFlags::COLOR)
+		{
+			pixel_size += GetPixelSize(color_format);
+		}
+		if (flags & filament::backend::TargetBufferFlags::DEPTH)
+		{
+			pixel_size += GetPixelSize(depth_format);
+		}
+		return width * height * pixel_size;
+	}
 
 	void RenderTarget::Init()
 	{
@@ -50,6 +94,84 @@ namespace Viry3D
 			}
 		}
 		m_temporary_render_targets_idle.Clear();
+
+		m_temporary_stats = { 0, 0, 0, 0 };
+	}
+
+	void RenderTarget::EndFrame()
+	{
+		int frame = Time::GetFrameCount();
+
+		for (auto& i : m_temporary_render_targets_idle)
+		{
+			auto& targets = i.second.targets;
+			for (int j = targets.Size() - 1; j >= 0; --j)
+			{
+				if (frame - targets[j]->m_last_used_frame >= m_temporary_idle_frames)
+				{
+					DestroyTemporaryRenderTarget(targets[j]);
+					targets.Remove(j);
+				}
+			}
+		}
+
+		EvictTemporaryRenderTargets(0);
+	}
+
+	void RenderTarget::SetTemporaryBudget(int bytes)
+	{
+		m_temporary_budget = bytes;
+
+		EvictTemporaryRenderTargets(0);
+	}
+
+	void RenderTarget::DestroyTemporaryRenderTarget(const Ref<RenderTarget>& target)
+	{
+		// only idle targets are destroyed
+		m_temporary_stats.idle_count--;
+		m_temporary_stats.idle_bytes -= target->key.GetMemorySize();
+
+		auto& driver = Engine::Instance()->GetDriverApi();
+		driver.destroyRenderTarget(target->target);
+		target->target.clear();
+		target->color.reset();
+		target->depth.reset();
+	}
+
+	void RenderTarget::EvictTemporaryRenderTargets(int extra_bytes)
+	{
+		if (m_temporary_budget <= 0)
+		{
+			return;
+		}
+
+		while (m_temporary_stats.live_bytes + m_temporary_stats.idle_bytes + extra_bytes > m_temporary_budget)
+		{
+			// least recently used idle target
+			Vector<Ref<RenderTarget>>* lru_targets = nullptr;
+			int lru_index = -1;
+
+			for (auto& i : m_temporary_render_targets_idle)
+			{
+				auto& targets = i.second.targets;
+				for (int j = 0; j < targets.Size(); ++j)
+				{
+					if (lru_index < 0 || targets[j]->m_last_used_frame < (*lru_targets)[lru_index]->m_last_used_frame)
+					{
+						lru_targets = &targets;
+						lru_index = j;
+					}
+				}
+			}
+
+			if (lru_index < 0)
+			{
+				break;
+			}
+
+			DestroyTemporaryRenderTarget((*lru_targets)[lru_index]);
+			lru_targets->Remove(lru_index);
+		}
 	}
 
 	Ref<RenderTarget> RenderTarget::GetTemporaryRenderTarget(
@@ -81,6 +203,9 @@ namespace Viry3D
 				int index = p->targets.Size() - 1;
 				target = p->targets[index];
 				p->targets.Remove(index);
+
+				m_temporary_stats.idle_count--;
+				m_temporary_stats.idle_bytes -= key.GetMemorySize();
 			}
 			else
 			{
@@ -94,6 +219,9 @@ namespace Viry3D
 
 		if (create)
 		{
+			// make room before the new target counts against the budget
+			EvictTemporaryRenderTargets(key.GetMemorySize());
+
 			target = RefMake<RenderTarget>();
 			target->key = key;
 
@@ -135,6 +263,10 @@ namespace Viry3D
 				stencil);
 		}
 
+		target->m_last_used_frame = Time::GetFrameCount();
+		m_temporary_stats.live_count++;
+		m_temporary_stats.live_bytes += key.GetMemorySize();
+
 		if (m_temporary_render_targets_using.TryGet(key.u, &p))
 		{
 			p->targets.Add(target);
@@ -160,6 +292,12 @@ namespace Viry3D
 		{
 			if (p->targets.Remove(target))
 			{
+				target->m_last_used_frame = Time::GetFrameCount();
+				m_temporary_stats.live_count--;
+				m_temporary_stats.live_bytes -= key.GetMemorySize();
+				m_temporary_stats.idle_count++;
+				m_temporary_stats.idle_bytes += key.GetMemorySize();
+
 				if (m_temporary_render_targets_idle.TryGet(key.u, &p))
 				{
 					p->targets.Add(target);
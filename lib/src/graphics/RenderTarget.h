@@ -25,6 +25,10 @@ namespace Viry3D
 {
 	class RenderTargetKey
 	{
+	public:
+		// bytes of color and depth buffers
+		int GetMemorySize() const;
+
 	public:
 		union
 		{
@@ -55,8 +59,18 @@ namespace Viry3D
 	class RenderTarget
 	{
 	public:
+		struct TemporaryStats
+		{
+			int live_count;
+			int idle_count;
+			int live_bytes;
+			int idle_bytes;
+		};
+
 		static void Init();
 		static void Done();
+		// release idle temporary targets unused for too many frames, called once per frame after rendering
+		static void EndFrame();
 		static Ref<RenderTarget> GetTemporaryRenderTarget(
 			int width,
 			int height,
@@ -66,6 +80,14 @@ namespace Viry3D
 			SamplerAddressMode wrap_mode,
 			filament::backend::TargetBufferFlags flags);
 		static void ReleaseTemporaryRenderTarget(const Ref<RenderTarget>& target);
+		// idle targets unused for more frames are destroyed, 0 destroys them at the end of the frame they were released
+		static void SetTemporaryIdleFrames(int frames) { m_temporary_idle_frames = frames; }
+		static int GetTemporaryIdleFrames() { return m_temporary_idle_frames; }
+		// bytes of live and idle temporary targets above which least recently used idle targets are destroyed,
+		// 0 for no limit, live targets are never destroyed so the pool may stay above budget
+		static void SetTemporaryBudget(int bytes);
+		static int GetTemporaryBudget() { return m_temporary_budget; }
+		static const TemporaryStats& GetTemporaryStats() { return m_temporary_stats; }
 
 	public:
 		filament::backend::RenderTargetHandle target;
@@ -73,8 +95,16 @@ namespace Viry3D
 		Ref<Texture> depth;
 		RenderTargetKey key;
 
+	private:
+		static void DestroyTemporaryRenderTarget(const Ref<RenderTarget>& target);
+		static void EvictTemporaryRenderTargets(int extra_bytes);
+
 	private:
 		static Map<uint64_t, TemporaryRenderTargets> m_temporary_render_targets_using;
 		static Map<uint64_t, TemporaryRenderTargets> m_temporary_render_targets_idle;
+		static int m_temporary_idle_frames;
+		static int m_temporary_budget;
+		static TemporaryStats m_temporary_stats;
+		int m_last_used_frame = 0;
 	};
 }
@@ -19,13 +19,40 @@
 #include "Engine.h"
 #include "Editor.h"
 #include "GameObject.h"
+#include "Graphics.h"
+#include "StaticBatching.h"
+#include "Light.h"
+#include "LODGroup.h"
+#include "time/Time.h"
 
 namespace Viry3D
 {
     List<Renderer*> Renderer::m_renderers;
+    BoundsTree Renderer::m_bounds_tree;
+    Vector<Renderer*> Renderer::m_bounds_dirty_renderers;
+    List<Renderer*> Renderer::m_unbounded_renderers;
+    UniformBufferPool Renderer::m_uniform_pool(sizeof(RendererUniforms), 128);
+    WeakRef<GameObject> Renderer::m_selected_object;
+
+    void Renderer::Done()
+    {
+        m_uniform_pool.Clear();
+    }
 
 	void Renderer::PrepareAll()
 	{
+        // selection changes are rare, recolor all bounds when it happens
+        auto selected_obj = Engine::Instance()->GetEditor()->GetSelectedGameObject();
+        if (selected_obj != m_selected_object.lock())
+        {
+            m_selected_object = selected_obj;
+
+            for (auto i : m_renderers)
+            {
+                i->MarkUniformsDirty();
+            }
+        }
+
 		for (auto i : m_renderers)
 		{
             if (i->GetGameObject()->IsActiveInTree() && i->IsEnable())
@@ -33,26 +60,74 @@ namespace Viry3D
                 i->Prepare();
             }
 		}
+
+        Renderer::UpdateBoundsTree();
+
+        m_uniform_pool.Flush();
 	}
 
+    void Renderer::UpdateBoundsTree()
+    {
+        for (int i = 0; i < m_bounds_dirty_renderers.Size(); ++i)
+        {
+            auto renderer = m_bounds_dirty_renderers[i];
+            renderer->m_bounds_proxy_dirty = false;
+
+            // created or enabled after PrepareAll of this frame
+            if ((renderer->m_uniform_slot < 0 || renderer->m_uniforms_dirty) &&
+                renderer->GetGameObject()->IsActiveInTree() && renderer->IsEnable())
+            {
+                renderer->Prepare();
+            }
+
+            renderer->UpdateBoundsProxy();
+        }
+        m_bounds_dirty_renderers.Clear();
+    }
+
     Renderer::Renderer():
 		m_cast_shadow(false),
 		m_recieve_shadow(false),
+		m_occluder(false),
         m_lightmap_scale_offset(1, 1, 0, 0),
-        m_lightmap_index(-1)
+        m_lightmap_index(-1),
+        m_shader_keyword_mask(0),
+        m_uniform_slot(-1),
+        m_uniforms_dirty(true),
+        m_world_bounds_dirty(true),
+        m_bounds_proxy(BoundsTree::NullNode),
+        m_bounds_proxy_dirty(false),
+        m_static_batch_index(-1),
+        m_lights_frame(-1),
+        m_version(0),
+        m_version_frame(0),
+        m_lod_group(nullptr)
     {
+        m_renderer_uniforms.lod_fade = Vector4(1, 1, 0, 0);
+
         m_renderers.AddLast(this);
+
+        this->MarkWorldBoundsDirty();
     }
     
     Renderer::~Renderer()
     {
-		auto& driver = Engine::Instance()->GetDriverApi();
+        if (m_uniform_slot >= 0)
+        {
+            m_uniform_pool.Free(m_uniform_slot);
+            m_uniform_slot = -1;
+        }
 
-		if (m_transform_uniform_buffer)
-		{
-			driver.destroyUniformBuffer(m_transform_uniform_buffer);
-			m_transform_uniform_buffer.clear();
-		}
+        if (m_bounds_proxy != BoundsTree::NullNode)
+        {
+            m_bounds_tree.DestroyProxy(m_bounds_proxy);
+            m_bounds_proxy = BoundsTree::NullNode;
+        }
+        if (m_bounds_proxy_dirty)
+        {
+            m_bounds_dirty_renderers.Remove(this);
+        }
+        m_unbounded_renderers.Remove(this);
 
         m_renderers.Remove(this);
     }
@@ -79,11 +154,13 @@ namespace Viry3D
         m_materials = materials;
 
         this->UpdateShaderKeywords();
+        this->IncreaseVersion();
     }
 
 	void Renderer::EnableCastShadow(bool enable)
 	{
 		m_cast_shadow = enable;
+        this->IncreaseVersion();
 	}
     
 	void Renderer::EnableRecieveShadow(bool enable)
@@ -91,14 +168,29 @@ namespace Viry3D
 		m_recieve_shadow = enable;
 	}
 
+	void Renderer::EnableOccluder(bool enable)
+	{
+		m_occluder = enable;
+	}
+
     void Renderer::SetLightmapIndex(int index)
     {
         m_lightmap_index = index;
+        this->MarkUniformsDirty();
     }
     
     void Renderer::SetLightmapScaleOffset(const Vector4& vec)
     {
         m_lightmap_scale_offset = vec;
+        this->MarkUniformsDirty();
+    }
+
+    void Renderer::SetStaticBatch(const Ref<StaticBatch>& batch, int index)
+    {
+        m_static_batch = batch;
+        m_static_batch_index = index;
+        this->MarkUniformsDirty();
+        this->IncreaseVersion();
     }
 
     void Renderer::SetShaderKeywords(const Vector<String>& keywords)
@@ -118,11 +210,6 @@ namespace Viry3D
         }
     }
 
-    const String& Renderer::GetShaderKey(int material_index) const
-    {
-        return m_shader_keys[material_index];
-    }
-
     const Vector<String>& Renderer::GetShaderKeywords() const
     {
         return m_shader_keywords;
@@ -130,25 +217,335 @@ namespace Viry3D
 
     void Renderer::UpdateShaderKeywords()
     {
-        m_shader_keys.Resize(m_materials.Size());
+        m_shader_keyword_mask = Shader::MakeKeywordMask(m_shader_keywords);
 
+        m_shaders.Clear();
+        m_shaders.Resize(m_materials.Size() * 16);
+
+        // load base variants now rather than on first draw
         for (int i = 0; i < m_materials.Size(); ++i)
         {
-            if (m_materials[i] && m_materials[i]->GetShaderName().Size() > 0)
+            this->GetShader(i);
+        }
+    }
+
+    const Ref<Shader>& Renderer::GetShader(int material_index, bool recieve_shadow, bool light_add, bool instancing, bool cluster_lighting)
+    {
+        static const Ref<Shader> s_null_shader;
+
+        const auto& material = m_materials[material_index];
+        if (!material)
+        {
+            return s_null_shader;
+        }
+
+        int state = (recieve_shadow ? 1 : 0) | (light_add ? 2 : 0) | (instancing ? 4 : 0) | (cluster_lighting ? 8 : 0);
+        auto& shader = m_shaders[material_index * 16 + state];
+        if (!shader)
+        {
+            static const uint64_t s_recieve_shadow_mask = Shader::MakeKeywordMask({ "RECIEVE_SHADOW_ON" });
+            static const uint64_t s_light_add_mask = Shader::MakeKeywordMask({ "LIGHT_ADD_ON" });
+            static const uint64_t s_cluster_lighting_mask = Shader::MakeKeywordMask({ "CLUSTER_LIGHTING_ON" });
+
+            uint64_t keyword_mask = m_shader_keyword_mask;
+            if (recieve_shadow)
+            {
+                keyword_mask |= s_recieve_shadow_mask;
+            }
+            if (light_add)
+            {
+                keyword_mask |= s_light_add_mask;
+            }
+            if (instancing)
+            {
+                keyword_mask |= Graphics::GetInstancingKeywordMask();
+            }
+            if (cluster_lighting)
             {
-                m_shader_keys[i] = m_materials[i]->EnableKeywords(m_shader_keywords);
+                keyword_mask |= s_cluster_lighting_mask;
             }
+
+            shader = material->GetShader(keyword_mask);
         }
+
+        return shader;
     }
     
-    Vector<filament::backend::RenderPrimitiveHandle> Renderer::GetPrimitives()
+    const Bounds& Renderer::GetWorldBounds()
+    {
+        if (m_world_bounds_dirty)
+        {
+            m_world_bounds_dirty = false;
+            m_world_bounds = this->CalculateWorldBounds();
+        }
+
+        return m_world_bounds;
+    }
+
+    int Renderer::GetQueue() const
+    {
+        int queue = 0;
+
+        for (int i = 0; i < m_materials.Size(); ++i)
+        {
+            if (m_materials[i])
+            {
+                queue = Mathf::Max(queue, m_materials[i]->GetQueue());
+            }
+        }
+
+        return queue;
+    }
+
+    uint64_t Renderer::GetSortKey(float depth)
+    {
+        int queue = this->GetQueue();
+        uint64_t shader_id = 0;
+        uint64_t material_id = 0;
+        uint64_t mesh_id = this->GetMeshId() & 0x3ff;
+
+        if (m_materials.Size() > 0 && m_materials[0])
+        {
+            const auto& material = m_materials[0];
+            const auto& shader = this->GetShader(0);
+
+            if (shader)
+            {
+                shader_id = shader->GetId() & 0xfff;
+            }
+            material_id = material->GetId() & 0xfff;
+        }
+
+        uint64_t depth_bits = (uint64_t) (Mathf::Clamp01(depth) * 0xffff);
+        uint64_t key = (uint64_t) Mathf::Clamp(queue, 0, 0x3fff) << 50;
+
+        if (queue > (int) Shader::Queue::AlphaTest)
+        {
+            // back to front, state changes come second
+            key |= (0xffff - depth_bits) << 34;
+            key |= shader_id << 22;
+            key |= material_id << 10;
+            key |= mesh_id;
+        }
+        else
+        {
+            key |= shader_id << 38;
+            key |= material_id << 26;
+            key |= mesh_id << 16;
+            key |= depth_bits;
+        }
+
+        return key;
+    }
+
+    bool Renderer::IsInstancingEnable()
+    {
+        if (!this->CanInstance() || m_lightmap_index >= 0 || m_materials.Size() == 0)
+        {
+            return false;
+        }
+
+        if (this->GetQueue() > (int) Shader::Queue::AlphaTest)
+        {
+            return false;
+        }
+
+        // lod fade is per renderer
+        if (m_lod_group && m_lod_group->IsCrossFadeEnable())
+        {
+            return false;
+        }
+
+        for (int i = 0; i < m_materials.Size(); ++i)
+        {
+            const auto& shader = this->GetShader(i);
+            if (!shader || !shader->IsInstancingSupported())
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    const Vector<Light*>& Renderer::GetLights()
+    {
+        if (m_lights_frame == Time::GetFrameCount())
+        {
+            return m_lights;
+        }
+        m_lights_frame = Time::GetFrameCount();
+        m_lights.Clear();
+
+        int layer = this->GetGameObject()->GetLayer();
+        auto is_lit = [=](Light* light) {
+            return light->GetGameObject()->IsActiveInTree() && light->IsEnable() && ((1 << layer) & light->GetCullingMask()) != 0;
+        };
+
+        // renderers without bounds are lit by every light
+        if (m_bounds_proxy == BoundsTree::NullNode)
+        {
+            const auto& lights = Light::GetLights();
+            for (auto i : lights)
+            {
+                if (is_lit(i))
+                {
+                    m_lights.Add(i);
+                }
+            }
+            Light::SortDirectionalFirst(m_lights);
+            return m_lights;
+        }
+
+        const auto& directional_lights = Light::GetUnboundedLights();
+        for (auto i : directional_lights)
+        {
+            if (is_lit(i))
+            {
+                m_lights.Add(i);
+            }
+        }
+
+        const Bounds& bounds = this->GetWorldBounds();
+        Light::GetBoundsTree().Query(bounds, [&](void* user_data) {
+            Light* light = (Light*) user_data;
+            if (is_lit(light) && light->Intersects(bounds))
+            {
+                m_lights.Add(light);
+            }
+        });
+
+        // the unbounded list and the tree follow light type changes only when proxies are updated
+        Light::SortDirectionalFirst(m_lights);
+
+        return m_lights;
+    }
+
+    bool Renderer::IsClusterLightingSupported()
+    {
+        if (m_materials.Size() == 0)
+        {
+            return false;
+        }
+
+        for (int i = 0; i < m_materials.Size(); ++i)
+        {
+            const auto& shader = this->GetShader(i);
+            if (!shader || (shader->IsForwardLight() && !shader->IsClusterLightingSupported()))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool Renderer::IsInstancingCompatible(Renderer* other)
+    {
+        if (!other->CanInstance() ||
+            other->m_lightmap_index >= 0 ||
+            other->m_shader_keyword_mask != m_shader_keyword_mask ||
+            other->m_recieve_shadow != m_recieve_shadow ||
+            other->GetGameObject()->GetLayer() != this->GetGameObject()->GetLayer() ||
+            other->m_materials.Size() != m_materials.Size())
+        {
+            return false;
+        }
+
+        // same mesh shares the primitive list
+        if (&other->GetPrimitives() != &this->GetPrimitives())
+        {
+            return false;
+        }
+
+        for (int i = 0; i < m_materials.Size(); ++i)
+        {
+            if (other->m_materials[i] != m_materials[i])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    Bounds Renderer::CalculateWorldBounds()
+    {
+        return this->GetLocalBounds().Transform(this->GetTransform()->GetLocalToWorldMatrix());
+    }
+
+    void Renderer::MarkWorldBoundsDirty()
+    {
+        m_world_bounds_dirty = true;
+
+        // model and bounds matrix follow world bounds
+        this->MarkUniformsDirty();
+        this->IncreaseVersion();
+
+        // tree proxy is refitted lazily in UpdateBoundsTree
+        if (!m_bounds_proxy_dirty)
+        {
+            m_bounds_proxy_dirty = true;
+            m_bounds_dirty_renderers.Add(this);
+        }
+    }
+
+    void Renderer::IncreaseVersion()
+    {
+        m_version++;
+        m_version_frame = Time::GetFrameCount();
+    }
+
+    void Renderer::UpdateBoundsProxy()
+    {
+        if (this->GetLocalBounds().GetSize().SqrMagnitude() > 0)
+        {
+            const Bounds& bounds = this->GetWorldBounds();
+
+            if (m_bounds_proxy == BoundsTree::NullNode)
+            {
+                m_bounds_proxy = m_bounds_tree.CreateProxy(bounds, this);
+                m_unbounded_renderers.Remove(this);
+            }
+            else
+            {
+                m_bounds_tree.MoveProxy(m_bounds_proxy, bounds);
+            }
+        }
+        else
+        {
+            if (m_bounds_proxy != BoundsTree::NullNode)
+            {
+                m_bounds_tree.DestroyProxy(m_bounds_proxy);
+                m_bounds_proxy = BoundsTree::NullNode;
+            }
+
+            if (!m_unbounded_renderers.Contains(this))
+            {
+                m_unbounded_renderers.AddLast(this);
+            }
+        }
+    }
+
+    void Renderer::OnTransformDirty()
+    {
+        this->MarkWorldBoundsDirty();
+    }
+
+    void Renderer::OnEnable(bool enable)
+    {
+        // transform dirty is not notified to disabled components
+        this->MarkWorldBoundsDirty();
+    }
+
+    const Vector<filament::backend::RenderPrimitiveHandle>& Renderer::GetPrimitives()
     {
-        return Vector<filament::backend::RenderPrimitiveHandle>();
+        static const Vector<filament::backend::RenderPrimitiveHandle> s_empty;
+        return s_empty;
     }
 
 	void Renderer::Prepare()
 	{
-		auto& driver = Engine::Instance()->GetDriverApi();
 		const auto& materials = this->GetMaterials();
 
 		for (int i = 0; i < materials.Size(); ++i)
@@ -160,24 +557,75 @@ namespace Viry3D
 			}
 		}
 
-		if (!m_transform_uniform_buffer)
-		{
-			m_transform_uniform_buffer = driver.createUniformBuffer(sizeof(RendererUniforms), filament::backend::BufferUsage::DYNAMIC);
-		}
+        if (m_uniform_slot < 0)
+        {
+            m_uniform_slot = m_uniform_pool.Allocate();
+            m_uniforms_dirty = true;
+        }
 
+        if (m_uniforms_dirty)
+        {
+            m_uniforms_dirty = false;
+            this->UpdateUniforms();
+        }
+	}
+
+    bool Renderer::IsLODCrossFadeSupported()
+    {
+        if (m_materials.Size() == 0)
+        {
+            return false;
+        }
+
+        for (int i = 0; i < m_materials.Size(); ++i)
+        {
+            const auto& material = m_materials[i];
+            if (!material || !material->GetShader() || !material->GetShader()->IsLODCrossFadeSupported())
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void Renderer::SetLODFade(float fade, bool complement)
+    {
+        Vector4& lod_fade = m_renderer_uniforms.lod_fade;
+        float sign = complement ? -1.0f : 1.0f;
+        if (lod_fade.x != fade || lod_fade.y != sign)
+        {
+            lod_fade = Vector4(fade, sign, 0, 0);
+
+            if (m_uniform_slot >= 0)
+            {
+                m_uniform_pool.Update(m_uniform_slot, &m_renderer_uniforms, sizeof(RendererUniforms));
+            }
+        }
+    }
+
+    void Renderer::UpdateUniforms()
+    {
         Bounds bounds = this->GetLocalBounds();
         Vector3 bounds_position = bounds.GetCenter();
         Vector3 bounds_size = bounds.GetSize();
-        auto selected_obj = Engine::Instance()->GetEditor()->GetSelectedGameObject();
+        auto selected_obj = m_selected_object.lock();
 
         m_renderer_uniforms.model_matrix = this->GetTransform()->GetLocalToWorldMatrix();
         m_renderer_uniforms.bounds_matrix = Matrix4x4::TRS(bounds_position, Quaternion::Identity(), bounds_size);
         m_renderer_uniforms.bounds_color = (selected_obj == this->GetGameObject() || selected_obj == this->GetTransform()->GetRoot()->GetGameObject()) ? Color(1, 0, 0, 1) : Color(0, 1, 0, 1);
         m_renderer_uniforms.lightmap_scale_offset = m_lightmap_scale_offset;
+
+        // static batch vertices are in world space with lightmap scale offset applied
+        if (m_static_batch)
+        {
+            const Bounds& world_bounds = this->GetWorldBounds();
+            m_renderer_uniforms.model_matrix = Matrix4x4::Identity();
+            m_renderer_uniforms.bounds_matrix = Matrix4x4::TRS(world_bounds.GetCenter(), Quaternion::Identity(), world_bounds.GetSize());
+            m_renderer_uniforms.lightmap_scale_offset = Vector4(1, 1, 0, 0);
+        }
         m_renderer_uniforms.lightmap_index = Vector4((float) m_lightmap_index);
 
-		void* buffer = driver.allocate(sizeof(RendererUniforms));
-		Memory::Copy(buffer, &m_renderer_uniforms, sizeof(RendererUniforms));
-		driver.loadUniformBuffer(m_transform_uniform_buffer, filament::backend::BufferDescriptor(buffer, sizeof(RendererUniforms)));
-	}
+        m_uniform_pool.Update(m_uniform_slot, &m_renderer_uniforms, sizeof(RendererUniforms));
+    }
 }
@@ -19,21 +19,42 @@
 
 #include "Component.h"
 #include "Material.h"
+#include "UniformBufferPool.h"
 #include "container/List.h"
 #include "container/Vector.h"
 #include "math/Vector4.h"
 #include "math/Bounds.h"
+#include "math/BoundsTree.h"
 #include "private/backend/DriverApi.h"
 
 namespace Viry3D
 {
     class Mesh;
+    class Renderer;
+    class GameObject;
+    class StaticBatch;
+    class Light;
+    class LODGroup;
+
+    struct DrawItem
+    {
+        uint64_t key;
+        Renderer* renderer;
+    };
 
     class Renderer : public Component
     {
     public:
         static const List<Renderer*>& GetRenderers() { return m_renderers; }
+		static void Done();
 		static void PrepareAll();
+        // bvh of renderers with bounds, user data is Renderer*
+        static const BoundsTree& GetBoundsTree() { return m_bounds_tree; }
+        // renderers without bounds are not in the tree and never culled
+        static const List<Renderer*>& GetUnboundedRenderers() { return m_unbounded_renderers; }
+        // refit proxies of renderers moved, created or enabled since last call, called again before culling
+        // so renderers added after PrepareAll are drawn in the same frame, those are prepared here too
+        static void UpdateBoundsTree();
         Renderer();
         virtual ~Renderer();
         Ref<Material> GetMaterial() const;
@@ -44,37 +65,114 @@ namespace Viry3D
 		void EnableCastShadow(bool enable);
 		bool IsRecieveShadow() const { return m_recieve_shadow; }
 		void EnableRecieveShadow(bool enable);
+		// mesh of an occluder is rasterized into the cpu depth buffer of cameras with occlusion culling,
+		// mark few large static meshes like walls and buildings
+		bool IsOccluder() const { return m_occluder; }
+		void EnableOccluder(bool enable);
         int GetLightmapIndex() const { return m_lightmap_index; }
         void SetLightmapIndex(int index);
         const Vector4& GetLightmapScaleOffset() const { return m_lightmap_scale_offset; }
         void SetLightmapScaleOffset(const Vector4& vec);
         void SetShaderKeywords(const Vector<String>& keywords);
         void EnableShaderKeyword(const String& keyword);
-        const String& GetShaderKey(int material_index) const;
         const Vector<String>& GetShaderKeywords() const;
+        uint64_t GetShaderKeywordMask() const { return m_shader_keyword_mask; }
+        // shader variant of material with renderer keywords, lighting and instancing keywords, cached per state
+        const Ref<Shader>& GetShader(int material_index, bool recieve_shadow = false, bool light_add = false, bool instancing = false, bool cluster_lighting = false);
         const RendererUniforms& GetRendererUniforms() const { return m_renderer_uniforms; }
-        const filament::backend::UniformBufferHandle& GetTransformUniformBuffer() const { return m_transform_uniform_buffer; }
-        virtual Vector<filament::backend::RenderPrimitiveHandle> GetPrimitives();
+        // renderer uniforms live in a shared pool, bind with range GetUniformOffset ~ sizeof(RendererUniforms)
+        const filament::backend::UniformBufferHandle& GetUniformBuffer() const { return m_uniform_pool.GetBuffer(m_uniform_slot); }
+        int GetUniformOffset() const { return m_uniform_pool.GetOffset(m_uniform_slot); }
+        virtual const Vector<filament::backend::RenderPrimitiveHandle>& GetPrimitives();
+        // primitives for depth only passes, position stream when the mesh keeps one, else GetPrimitives
+        virtual const Vector<filament::backend::RenderPrimitiveHandle>& GetDepthPrimitives() { return this->GetPrimitives(); }
         virtual Bounds GetLocalBounds() const { return Bounds(); }
+        const Bounds& GetWorldBounds();
+        // max queue of materials
+        int GetQueue() const;
+        // queue | shader | material | mesh | depth for opaque, queue | far to near depth | shader | material | mesh for transparent,
+        // depth is normalized view depth in 0 ~ 1
+        uint64_t GetSortKey(float depth);
+        // opaque renderer without lightmap whose shaders all support instancing
+        bool IsInstancingEnable();
+        // other can be drawn in the same instanced draw call as this
+        bool IsInstancingCompatible(Renderer* other);
+        // active lights in layer whose range and cone reach world bounds, directional lights first,
+        // updated once per frame on first use
+        const Vector<Light*>& GetLights();
+        // forward lit shaders of all materials shade clustered lights in one pass
+        bool IsClusterLightingSupported();
+        // combined world space mesh set by StaticBatching, model matrix is identity when batched
+        const Ref<StaticBatch>& GetStaticBatch() const { return m_static_batch; }
+        int GetStaticBatchIndex() const { return m_static_batch_index; }
+        // increased when transform, bounds, enable state, materials or cast shadow flag change,
+        // shadow maps are re-rendered only when versions of their casters change
+        uint32_t GetVersion() const { return m_version; }
+        // frame of the last version change
+        int GetVersionFrame() const { return m_version_frame; }
+        // lod group whose levels contain this renderer
+        LODGroup* GetLODGroup() const { return m_lod_group; }
+        // shaders of all materials dither with LOD_FADE_CROSSFADE
+        bool IsLODCrossFadeSupported();
+        // partly drawn while lod group cross fades between levels
+        bool IsLODFading() const { return m_renderer_uniforms.lod_fade.x < 1.0f; }
+        // upload renderer uniforms changed after PrepareAll, like lod fade set during culling
+        static void FlushUniforms() { m_uniform_pool.Flush(); }
 
 	protected:
 		virtual void Prepare();
 		virtual void OnResize(int width, int height) { }
+        virtual void OnTransformDirty();
+        virtual void OnEnable(bool enable);
+        virtual Bounds CalculateWorldBounds();
+        virtual uint32_t GetMeshId() const { return 0; }
+        // only model matrix varies between instances
+        virtual bool CanInstance() const { return false; }
+        void MarkWorldBoundsDirty();
+        void MarkUniformsDirty() { m_uniforms_dirty = true; }
+        void IncreaseVersion();
 
 	private:
 		friend class Camera;
+        friend class StaticBatching;
+        friend class LODGroup;
+        void SetStaticBatch(const Ref<StaticBatch>& batch, int index);
+        void SetLODGroup(LODGroup* group) { m_lod_group = group; }
+        void SetLODFade(float fade, bool complement);
         void UpdateShaderKeywords();
+        void UpdateBoundsProxy();
+        void UpdateUniforms();
 
 	private:
         static List<Renderer*> m_renderers;
+        static BoundsTree m_bounds_tree;
+        static Vector<Renderer*> m_bounds_dirty_renderers;
+        static List<Renderer*> m_unbounded_renderers;
+        static UniformBufferPool m_uniform_pool;
+        static WeakRef<GameObject> m_selected_object;
         Vector<Ref<Material>> m_materials;
 		bool m_cast_shadow;
 		bool m_recieve_shadow;
+		bool m_occluder;
         Vector4 m_lightmap_scale_offset;
         int m_lightmap_index;
         Vector<String> m_shader_keywords;
-        Vector<String> m_shader_keys;
+        uint64_t m_shader_keyword_mask;
+        // 16 lighting and instancing states per material
+        Vector<Ref<Shader>> m_shaders;
         RendererUniforms m_renderer_uniforms;
-		filament::backend::UniformBufferHandle m_transform_uniform_buffer;
+        int m_uniform_slot;
+        bool m_uniforms_dirty;
+        Bounds m_world_bounds;
+        bool m_world_bounds_dirty;
+        int m_bounds_proxy;
+        bool m_bounds_proxy_dirty;
+        Ref<StaticBatch> m_static_batch;
+        int m_static_batch_index;
+        Vector<Light*> m_lights;
+        int m_lights_frame;
+        uint32_t m_version;
+        int m_version_frame;
+        LODGroup* m_lod_group;
     };
 }
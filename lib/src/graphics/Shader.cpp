@@ -21,6 +21,7 @@
 #include "io/File.h"
 #include "lua/lua.hpp"
 #include "memory/Memory.h"
+#include "math/Mathf.h"
 
 #if VR_VULKAN || VR_D3D
 #include "vulkan/spirv_shader_compiler.h"
@@ -37,7 +38,11 @@
 
 namespace Viry3D
 {
-	Map<String, Ref<Shader>> Shader::m_shaders;
+	Map<String, int> Shader::m_keyword_ids;
+	Vector<String> Shader::m_keyword_names;
+	Map<String, int> Shader::m_name_ids;
+	Vector<Shader::Variant> Shader::m_variants;
+	int Shader::m_variant_count = 0;
 
 #if VR_VULKAN || VR_D3D
     static void GlslToSpirv(const String& glsl, ShaderCompiler::ShaderType shader_type, Vector<unsigned int>& spirv)
@@ -98,43 +103,151 @@ namespace Viry3D
     
     void Shader::Done()
     {
-		m_shaders.Clear();
+		m_variants.Clear();
+		m_variant_count = 0;
 
 #if VR_VULKAN || VR_D3D
 		ShaderCompiler::DeinitShaderCompiler();
 #endif
     }
 
-    static List<String> KeywordsToList(const Vector<String>& keywords)
-    {
-        List<String> keyword_list;
-        for (int i = 0; i < keywords.Size(); ++i)
-        {
-            keyword_list.AddLast(keywords[i]);
-        }
-        keyword_list.Sort();
-        return keyword_list;
-    }
+	int Shader::GetKeywordId(const String& keyword)
+	{
+		int* find;
+		if (m_keyword_ids.TryGet(keyword, &find))
+		{
+			return *find;
+		}
 
-    String Shader::MakeKey(const String& name, const Vector<String>& keywords)
-    {
-        String key = name;
-        List<String> keyword_list = KeywordsToList(keywords);
-        for (const auto& i : keyword_list)
-        {
-            key += "|" + i;
-        }
-        return key;
-    }
+		int id = m_keyword_names.Size();
+		if (id >= MaxKeywordCount)
+		{
+			// remembered as -1 so the error is logged once per keyword
+			Log("shader keyword count exceeds %d, keyword ignored: %s", MaxKeywordCount, keyword.CString());
+			m_keyword_ids.Add(keyword, -1);
+			return -1;
+		}
+
+		m_keyword_ids.Add(keyword, id);
+		m_keyword_names.Add(keyword);
+
+		return id;
+	}
+
+	uint64_t Shader::MakeKeywordMask(const Vector<String>& keywords)
+	{
+		uint64_t mask = 0;
+		for (int i = 0; i < keywords.Size(); ++i)
+		{
+			int id = GetKeywordId(keywords[i]);
+			if (id >= 0)
+			{
+				mask |= (uint64_t) 1 << id;
+			}
+		}
+		return mask;
+	}
+
+	Vector<String> Shader::GetKeywords(uint64_t keyword_mask)
+	{
+		Vector<String> keywords;
+		for (int i = 0; i < m_keyword_names.Size(); ++i)
+		{
+			if (keyword_mask & ((uint64_t) 1 << i))
+			{
+				keywords.Add(m_keyword_names[i]);
+			}
+		}
+		return keywords;
+	}
+
+	int Shader::GetNameId(const String& name)
+	{
+		int* find;
+		if (m_name_ids.TryGet(name, &find))
+		{
+			return *find;
+		}
+
+		int id = m_name_ids.Size();
+		m_name_ids.Add(name, id);
+
+		return id;
+	}
+
+	static int HashVariant(int name_id, uint64_t keyword_mask, int capacity)
+	{
+		uint64_t h = keyword_mask * 0x9e3779b97f4a7c15ULL ^ (uint64_t) name_id * 0xc2b2ae3d27d4eb4fULL;
+		h ^= h >> 32;
+		return (int) (h & (uint64_t) (capacity - 1));
+	}
+
+	Ref<Shader>* Shader::FindVariant(int name_id, uint64_t keyword_mask)
+	{
+		int capacity = m_variants.Size();
+		if (capacity == 0)
+		{
+			return nullptr;
+		}
+
+		int index = HashVariant(name_id, keyword_mask, capacity);
+		while (m_variants[index].name_id >= 0)
+		{
+			auto& variant = m_variants[index];
+			if (variant.name_id == name_id && variant.keyword_mask == keyword_mask)
+			{
+				return &variant.shader;
+			}
+			index = (index + 1) & (capacity - 1);
+		}
+
+		return nullptr;
+	}
+
+	void Shader::AddVariant(int name_id, uint64_t keyword_mask, const Ref<Shader>& shader)
+	{
+		// keep load factor under 1/2
+		if ((m_variant_count + 1) * 2 > m_variants.Size())
+		{
+			Vector<Variant> variants = std::move(m_variants);
+			m_variants = Vector<Variant>(Mathf::Max(variants.Size() * 2, 64));
+			m_variant_count = 0;
+
+			for (int i = 0; i < variants.Size(); ++i)
+			{
+				if (variants[i].name_id >= 0)
+				{
+					AddVariant(variants[i].name_id, variants[i].keyword_mask, variants[i].shader);
+				}
+			}
+		}
+
+		int capacity = m_variants.Size();
+		int index = HashVariant(name_id, keyword_mask, capacity);
+		while (m_variants[index].name_id >= 0)
+		{
+			index = (index + 1) & (capacity - 1);
+		}
+
+		m_variants[index].name_id = name_id;
+		m_variants[index].keyword_mask = keyword_mask;
+		m_variants[index].shader = shader;
+		m_variant_count++;
+	}
 
 	Ref<Shader> Shader::Find(const String& name, const Vector<String>& keywords)
+	{
+		return Find(name, MakeKeywordMask(keywords));
+	}
+
+	Ref<Shader> Shader::Find(const String& name, uint64_t keyword_mask)
 	{
 		Ref<Shader> shader;
 
-        String key = MakeKey(name, keywords);
+		int name_id = GetNameId(name);
 
-		Ref<Shader>* find;
-		if (m_shaders.TryGet(key, &find))
+		Ref<Shader>* find = FindVariant(name_id, keyword_mask);
+		if (find)
 		{
 			shader = *find;
 		}
@@ -153,12 +266,12 @@ namespace Viry3D
 				String lua_src = File::ReadAllText(path);
 
 				shader = Ref<Shader>(new Shader(name));
-                shader->m_shader_key = key;
-                shader->m_keywords = keywords;
+                shader->m_keywords = GetKeywords(keyword_mask);
+                shader->m_keyword_mask = keyword_mask;
 				shader->Load(lua_src);
 				shader->Compile();
 
-				m_shaders.Add(key, shader);
+				AddVariant(name_id, keyword_mask, shader);
 			}
 			else
 			{
@@ -173,11 +286,9 @@ namespace Viry3D
     {
         Ref<Shader> shader;
 
-        List<String> keyword_list = KeywordsToList(keywords);
-
         shader = Ref<Shader>(new Shader(""));
-        shader->m_shader_key = MakeKey(shader->GetName(), keywords);;
         shader->m_keywords = keywords;
+        shader->m_keyword_mask = MakeKeywordMask(keywords);
         shader->m_passes = passes;
         for (const auto& pass : shader->m_passes)
         {
@@ -192,7 +303,11 @@ namespace Viry3D
     }
     
     Shader::Shader(const String& name):
-		m_queue(0)
+		m_keyword_mask(0),
+		m_queue(0),
+		m_instancing_supported(false),
+		m_cluster_lighting_supported(false),
+		m_lod_cross_fade_supported(false)
     {
         this->SetName(name);
     }
@@ -519,7 +634,8 @@ namespace Viry3D
 				"#extension GL_ARB_shading_language_420pack : enable\n"
 				"#define VK_LAYOUT_LOCATION(i) layout(location = i)\n"
 				"#define VK_UNIFORM_BINDING(i) layout(std140, set = 0, binding = i)\n"
-				"#define VK_SAMPLER_BINDING(i) layout(set = 1, binding = i)\n";
+				"#define VK_SAMPLER_BINDING(i) layout(set = 1, binding = i)\n"
+				"#define VK_INSTANCE_INDEX gl_InstanceIndex\n";
 			if (Engine::Instance()->GetBackend() == filament::backend::Backend::VULKAN ||
 				Engine::Instance()->GetBackend() == filament::backend::Backend::METAL)
 			{
@@ -533,12 +649,14 @@ namespace Viry3D
 				vk_convert = "void vk_convert() { }\n";
 			}
 		}
-		else if (Engine::Instance()->GetBackend() == filament::backend::Backend::OPENGL)
+		else if (Engine::Instance()->GetBackend() == filament::backend::Backend::OPENGL ||
+			Engine::Instance()->GetBackend() == filament::backend::Backend::NOOP)
 		{
 			define = "#define VR_GLES 1\n"
 				"#define VK_LAYOUT_LOCATION(i)\n"
 				"#define VK_UNIFORM_BINDING(i) layout(std140)\n"
-				"#define VK_SAMPLER_BINDING(i)\n";
+				"#define VK_SAMPLER_BINDING(i)\n"
+				"#define VK_INSTANCE_INDEX gl_InstanceID\n";
 			vk_convert = "void vk_convert() { }\n";
 		}
 		else
@@ -551,6 +669,29 @@ namespace Viry3D
 			define += "#define " + i + " 1\n";
 		}
 
+		m_instancing_supported = false;
+		m_cluster_lighting_supported = false;
+		m_lod_cross_fade_supported = false;
+		if (!(Engine::Instance()->GetBackend() == filament::backend::Backend::OPENGL &&
+			Engine::Instance()->GetShaderModel() == filament::backend::ShaderModel::GL_ES_20))
+		{
+			for (int i = 0; i < m_passes.Size(); ++i)
+			{
+				if (m_passes[i].vs.Contains("INSTANCING_ON"))
+				{
+					m_instancing_supported = true;
+				}
+				if (m_passes[i].fs.Contains("CLUSTER_LIGHTING_ON"))
+				{
+					m_cluster_lighting_supported = true;
+				}
+				if (m_passes[i].fs.Contains("LOD_FADE_CROSSFADE"))
+				{
+					m_lod_cross_fade_supported = true;
+				}
+			}
+		}
+
 		for (int i = 0; i < m_passes.Size(); ++i)
 		{
 			auto& pass = m_passes[i];
@@ -109,19 +109,32 @@ namespace Viry3D
 			filament::backend::PipelineState pipeline;
 		};
 
+		static const int MaxKeywordCount = 64;
+
         static void Init();
         static void Done();
-        static String MakeKey(const String& name, const Vector<String>& keywords);
+		// keywords are registered once as global ids, a keyword mask has bit (1 << id) set for each keyword,
+		// keywords after the first MaxKeywordCount get id -1 and are left out of masks
+		static int GetKeywordId(const String& keyword);
+		static uint64_t MakeKeywordMask(const Vector<String>& keywords);
+		static Vector<String> GetKeywords(uint64_t keyword_mask);
 		static Ref<Shader> Find(const String& name, const Vector<String>& keywords = Vector<String>());
+		static Ref<Shader> Find(const String& name, uint64_t keyword_mask);
         static Ref<Shader> Create(const Vector<Pass>& passes, const Vector<String>& keywords = Vector<String>());
 
         virtual ~Shader();
-        const String& GetShaderKey() const { return m_shader_key; }
 		const Vector<String>& GetKeywords() const { return m_keywords; }
+		uint64_t GetKeywordMask() const { return m_keyword_mask; }
 		int GetPassCount() const { return m_passes.Size(); }
 		const Pass& GetPass(int index) const { return m_passes[index]; }
         int GetQueue() const { return m_queue; }
         bool IsForwardLight() const;
+		// vertex shader reads model matrices by instance index when INSTANCING_ON is defined
+		bool IsInstancingSupported() const { return m_instancing_supported; }
+		// fragment shader loops over clustered lights in one pass when CLUSTER_LIGHTING_ON is defined
+		bool IsClusterLightingSupported() const { return m_cluster_lighting_supported; }
+		// fragment shader dithers by renderer lod fade when LOD_FADE_CROSSFADE is defined
+		bool IsLODCrossFadeSupported() const { return m_lod_cross_fade_supported; }
 
 	private:
 		Shader(const String& name);
@@ -129,10 +142,30 @@ namespace Viry3D
 		void Compile();
 
 	private:
-		static Map<String, Ref<Shader>> m_shaders;
-        String m_shader_key;
+		struct Variant
+		{
+			int name_id = -1;
+			uint64_t keyword_mask = 0;
+			Ref<Shader> shader;
+		};
+
+		static int GetNameId(const String& name);
+		static Ref<Shader>* FindVariant(int name_id, uint64_t keyword_mask);
+		static void AddVariant(int name_id, uint64_t keyword_mask, const Ref<Shader>& shader);
+
+	private:
+		static Map<String, int> m_keyword_ids;
+		static Vector<String> m_keyword_names;
+		static Map<String, int> m_name_ids;
+		// open addressing hash table of loaded variants keyed by (name id, keyword mask)
+		static Vector<Variant> m_variants;
+		static int m_variant_count;
 		Vector<String> m_keywords;
+		uint64_t m_keyword_mask;
 		Vector<Pass> m_passes;
 		int m_queue;
+		bool m_instancing_supported;
+		bool m_cluster_lighting_supported;
+		bool m_lod_cross_fade_supported;
     };
 }
@@ -0,0 +1,194 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "ShadowAtlas.h"
+#include "Engine.h"
+#include "math/Mathf.h"
+#include <algorithm>
+
+namespace Viry3D
+{
+	int ShadowAtlas::m_size = 2048;
+	Ref<Texture> ShadowAtlas::m_texture;
+	filament::backend::RenderTargetHandle ShadowAtlas::m_render_target;
+	filament::backend::SamplerGroupHandle ShadowAtlas::m_sampler_group;
+	Vector<ShadowAtlas::Tile> ShadowAtlas::m_free_tiles;
+	int ShadowAtlas::m_version = 0;
+
+	void ShadowAtlas::Done()
+	{
+		auto& driver = Engine::Instance()->GetDriverApi();
+
+		if (m_render_target)
+		{
+			driver.destroyRenderTarget(m_render_target);
+			m_render_target.clear();
+		}
+
+		if (m_sampler_group)
+		{
+			driver.destroySamplerGroup(m_sampler_group);
+			m_sampler_group.clear();
+		}
+
+		m_texture.reset();
+	}
+
+	void ShadowAtlas::SetSize(int size)
+	{
+		if (m_size != size)
+		{
+			m_size = size;
+
+			if (m_texture)
+			{
+				ShadowAtlas::CreateTexture();
+			}
+		}
+	}
+
+	const Ref<Texture>& ShadowAtlas::GetTexture()
+	{
+		if (!m_texture)
+		{
+			ShadowAtlas::CreateTexture();
+		}
+		return m_texture;
+	}
+
+	const filament::backend::RenderTargetHandle& ShadowAtlas::GetRenderTarget()
+	{
+		if (!m_render_target)
+		{
+			ShadowAtlas::CreateTexture();
+		}
+		return m_render_target;
+	}
+
+	const filament::backend::SamplerGroupHandle& ShadowAtlas::GetSamplerGroup()
+	{
+		if (!m_sampler_group)
+		{
+			ShadowAtlas::CreateTexture();
+		}
+		return m_sampler_group;
+	}
+
+	void ShadowAtlas::CreateTexture()
+	{
+		auto& driver = Engine::Instance()->GetDriverApi();
+
+		m_texture = Texture::CreateRenderTexture(
+			m_size,
+			m_size,
+			Texture::SelectDepthFormat(),
+			FilterMode::Linear,
+			SamplerAddressMode::ClampToEdge);
+		m_version++;
+
+		if (!m_sampler_group)
+		{
+			m_sampler_group = driver.createSamplerGroup(1);
+		}
+
+		filament::backend::SamplerGroup samplers(1);
+		samplers.setSampler(0, m_texture->GetTexture(), m_texture->GetSampler());
+		driver.updateSamplerGroup(m_sampler_group, std::move(samplers));
+
+		if (m_render_target)
+		{
+			driver.destroyRenderTarget(m_render_target);
+			m_render_target.clear();
+		}
+
+		filament::backend::TargetBufferInfo color = { };
+		filament::backend::TargetBufferInfo depth = { };
+		filament::backend::TargetBufferInfo stencil = { };
+		depth.handle = m_texture->GetTexture();
+
+		m_render_target = driver.createRenderTarget(
+			filament::backend::TargetBufferFlags::DEPTH,
+			m_size,
+			m_size,
+			1,
+			color,
+			depth,
+			stencil);
+	}
+
+	void ShadowAtlas::Allocate(const Vector<int>& sizes, Vector<Tile>& tiles)
+	{
+		tiles.Resize(sizes.Size());
+
+		Vector<int> order(sizes.Size());
+		for (int i = 0; i < order.Size(); ++i)
+		{
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+			return sizes[a] > sizes[b];
+		});
+
+		m_free_tiles.Clear();
+		m_free_tiles.Add({ 0, 0, m_size });
+
+		for (int i = 0; i < order.Size(); ++i)
+		{
+			Tile& tile = tiles[order[i]];
+			tile = { 0, 0, 0 };
+
+			int size = MinTileSize;
+			while (size * 2 <= Mathf::Min(sizes[order[i]], m_size))
+			{
+				size *= 2;
+			}
+
+			while (size >= MinTileSize && tile.size == 0)
+			{
+				// smallest free tile that fits, split down to the requested size
+				int best = -1;
+				for (int j = 0; j < m_free_tiles.Size(); ++j)
+				{
+					if (m_free_tiles[j].size >= size && (best < 0 || m_free_tiles[j].size < m_free_tiles[best].size))
+					{
+						best = j;
+					}
+				}
+
+				if (best < 0)
+				{
+					size /= 2;
+					continue;
+				}
+
+				Tile free_tile = m_free_tiles[best];
+				m_free_tiles.Remove(best);
+
+				while (free_tile.size > size)
+				{
+					int half = free_tile.size / 2;
+					m_free_tiles.Add({ free_tile.x + half, free_tile.y, half });
+					m_free_tiles.Add({ free_tile.x, free_tile.y + half, half });
+					m_free_tiles.Add({ free_tile.x + half, free_tile.y + half, half });
+					free_tile.size = half;
+				}
+
+				tile = free_tile;
+			}
+		}
+	}
+}
@@ -0,0 +1,65 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Texture.h"
+#include "container/Vector.h"
+#include "private/backend/DriverApi.h"
+
+namespace Viry3D
+{
+	// one depth texture shared by shadow maps of all lights, split into power of 2 square tiles every frame,
+	// so receivers sample every shadow through the same sampler group
+	class ShadowAtlas
+	{
+	public:
+		// pixels from bottom left, size is 0 when not allocated
+		struct Tile
+		{
+			int x;
+			int y;
+			int size;
+		};
+
+		static const int MinTileSize = 128;
+
+		static void Done();
+		static int GetSize() { return m_size; }
+		// fixed shadow memory budget, tiles are allocated again next frame
+		static void SetSize(int size);
+		static const Ref<Texture>& GetTexture();
+		static const filament::backend::RenderTargetHandle& GetRenderTarget();
+		static const filament::backend::SamplerGroupHandle& GetSamplerGroup();
+		// increased when the texture is created again and old contents are lost
+		static int GetVersion() { return m_version; }
+		// sizes are rounded down to power of 2, larger requests are placed first and halved until they fit,
+		// a request gets a 0 size tile when the atlas is full
+		static void Allocate(const Vector<int>& sizes, Vector<Tile>& tiles);
+
+	private:
+		static void CreateTexture();
+
+	private:
+		static int m_size;
+		static Ref<Texture> m_texture;
+		static filament::backend::RenderTargetHandle m_render_target;
+		static filament::backend::SamplerGroupHandle m_sampler_group;
+		static Vector<Tile> m_free_tiles;
+		static int m_version;
+	};
+}
@@ -24,6 +24,7 @@ namespace Viry3D
 {
     SkinnedMeshRenderer::SkinnedMeshRenderer():
 		m_blend_shape_dirty(false),
+        m_bones_bounds_valid(false),
 		m_vb_vertex_count(0)
     {
 
@@ -62,6 +63,7 @@ namespace Viry3D
 		MeshRenderer::SetMesh(mesh);
 
 		m_blend_shape_weights.Clear();
+        m_bones_bounds_valid = false;
 
 		auto& driver = Engine::Instance()->GetDriverApi();
 		if (m_vb)
@@ -169,6 +171,10 @@ namespace Viry3D
 
 			m_bone_vectors.Resize(bone_count * 3);
 
+            // skinned vertices are blended from bone transformed positions,
+            // so union of mesh bounds transformed by every bone contains them all
+            const auto& local_bounds = mesh->GetBounds();
+
             for (int i = 0; i < bone_count; ++i)
             {
                 Matrix4x4 mat = m_bones[i].lock()->GetLocalToWorldMatrix() * bindposes[i];
@@ -176,8 +182,21 @@ namespace Viry3D
 				m_bone_vectors[i * 3 + 0] = mat.GetRow(0);
 				m_bone_vectors[i * 3 + 1] = mat.GetRow(1);
 				m_bone_vectors[i * 3 + 2] = mat.GetRow(2);
+
+                Bounds bone_bounds = local_bounds.Transform(mat);
+                if (i == 0)
+                {
+                    m_bones_bounds = bone_bounds;
+                }
+                else
+                {
+                    m_bones_bounds.Encapsulate(bone_bounds);
+                }
             }
 
+            m_bones_bounds_valid = bone_count > 0;
+            this->MarkWorldBoundsDirty();
+
             if (!m_bones_uniform_buffer)
             {
                 m_bones_uniform_buffer = driver.createUniformBuffer(sizeof(SkinnedMeshRendererUniforms), filament::backend::BufferUsage::DYNAMIC);
@@ -226,10 +245,14 @@ namespace Viry3D
                 filament::backend::SamplerGroup samplers(1);
                 samplers.setSampler(0, blend_shape_texture->GetTexture(), blend_shape_texture->GetSampler());
                 driver.updateSamplerGroup(m_blend_shape_sampler_group, std::move(samplers));
+
+                // weights are uploaded every frame, shape may change
+                this->IncreaseVersion();
             }
             else if (m_blend_shape_dirty)
             {
                 m_blend_shape_dirty = false;
+                this->IncreaseVersion();
 
                 const auto& vertices = mesh->GetVertices();
                 const auto& submeshes = mesh->GetSubmeshes();
@@ -300,23 +323,35 @@ namespace Viry3D
         MeshRenderer::Prepare();
     }
 
-    Vector<filament::backend::RenderPrimitiveHandle> SkinnedMeshRenderer::GetPrimitives()
+    Bounds SkinnedMeshRenderer::CalculateWorldBounds()
     {
-        Vector<filament::backend::RenderPrimitiveHandle> primitives;
-        
+        if (m_bones_bounds_valid)
+        {
+            return m_bones_bounds;
+        }
+
+        return MeshRenderer::CalculateWorldBounds();
+    }
+
+    const Vector<filament::backend::RenderPrimitiveHandle>& SkinnedMeshRenderer::GetPrimitives()
+    {
+		// blend shaped vertices
 		if (m_primitives.Size() > 0)
 		{
-			primitives = m_primitives;
+			return m_primitives;
 		}
-		else
-		{
-			const auto& mesh = this->GetMesh();
-			if (mesh)
-			{
-				primitives = mesh->GetPrimitives();
-			}
-		}
-        
-        return primitives;
+
+		return MeshRenderer::GetPrimitives();
+    }
+
+    const Vector<filament::backend::RenderPrimitiveHandle>& SkinnedMeshRenderer::GetDepthPrimitives()
+    {
+        // blend shaped positions are only in the full vertices
+        if (m_primitives.Size() > 0)
+        {
+            return m_primitives;
+        }
+
+        return MeshRenderer::GetDepthPrimitives();
     }
 }
@@ -37,10 +37,13 @@ namespace Viry3D
 		const Vector<Vector4>& GetBoneVectors() const { return m_bone_vectors; };
         const filament::backend::UniformBufferHandle& GetBonesUniformBuffer() const { return m_bones_uniform_buffer; }
         const filament::backend::SamplerGroupHandle& GetBlendShapeSamplerGroup() const { return m_blend_shape_sampler_group; }
-        virtual Vector<filament::backend::RenderPrimitiveHandle> GetPrimitives();
+        virtual const Vector<filament::backend::RenderPrimitiveHandle>& GetPrimitives();
+        virtual const Vector<filament::backend::RenderPrimitiveHandle>& GetDepthPrimitives();
         
 	protected:
 		virtual void Prepare();
+        virtual Bounds CalculateWorldBounds();
+        virtual bool CanInstance() const { return false; }
 
     private:
         void FindBones();
@@ -59,6 +62,8 @@ namespace Viry3D
 		Map<String, BlendShapeWeight> m_blend_shape_weights;
 		bool m_blend_shape_dirty;
 		Vector<Vector4> m_bone_vectors;
+        Bounds m_bones_bounds;
+        bool m_bones_bounds_valid;
         filament::backend::UniformBufferHandle m_bones_uniform_buffer;
         filament::backend::SamplerGroupHandle m_blend_shape_sampler_group;
 		filament::backend::VertexBufferHandle m_vb;
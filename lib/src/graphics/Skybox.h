@@ -28,5 +28,7 @@ namespace Viry3D
         virtual ~Skybox();
 		void SetTexture(const Ref<Texture>& texture, float level);
         void SetColor(const Color& color);
+        // skybox is drawn at infinity around camera, never culled
+        virtual Bounds GetLocalBounds() const { return Bounds(); }
     };
 }
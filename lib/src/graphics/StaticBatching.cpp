@@ -0,0 +1,311 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "StaticBatching.h"
+#include "MeshRenderer.h"
+#include "LODGroup.h"
+#include "Engine.h"
+#include "GameObject.h"
+#include "Transform.h"
+#include <typeinfo>
+
+namespace Viry3D
+{
+	StaticBatch::StaticBatch(const Ref<Mesh>& mesh, int source_count):
+		m_mesh(mesh),
+		m_source_count(source_count)
+	{
+		auto& driver = Engine::Instance()->GetDriverApi();
+
+		const auto& primitives = m_mesh->GetPrimitives();
+		const auto& depth_primitives = m_mesh->GetDepthPrimitives();
+		int submesh_count = primitives.Size() / m_source_count;
+
+		m_source_primitives.Resize(m_source_count);
+		m_source_depth_primitives.Resize(m_source_count);
+		for (int i = 0; i < m_source_count; ++i)
+		{
+			for (int j = 0; j < submesh_count; ++j)
+			{
+				m_source_primitives[i].Add(primitives[j * m_source_count + i]);
+
+				if (depth_primitives.Size() > 0)
+				{
+					m_source_depth_primitives[i].Add(depth_primitives[j * m_source_count + i]);
+				}
+			}
+		}
+
+		m_range_primitives.Resize(submesh_count);
+		for (int i = 0; i < submesh_count; ++i)
+		{
+			m_range_primitives[i] = driver.createRenderPrimitive();
+			driver.setRenderPrimitiveBuffer(m_range_primitives[i], m_mesh->GetVertexBuffer(), m_mesh->GetIndexBuffer(), m_mesh->GetEnabledAttributes());
+		}
+
+		this->SetRange(0, m_source_count - 1);
+	}
+
+	StaticBatch::~StaticBatch()
+	{
+		auto& driver = Engine::Instance()->GetDriverApi();
+
+		// source primitives are owned by mesh
+		for (int i = 0; i < m_range_primitives.Size(); ++i)
+		{
+			driver.destroyRenderPrimitive(m_range_primitives[i]);
+			m_range_primitives[i].clear();
+		}
+		m_range_primitives.Clear();
+	}
+
+	void StaticBatch::SetRange(int first_source, int last_source)
+	{
+		auto& driver = Engine::Instance()->GetDriverApi();
+
+		int max_index = m_mesh->GetVertices().Size() - 1;
+
+		// sources are consecutive inside each submesh
+		for (int i = 0; i < m_range_primitives.Size(); ++i)
+		{
+			const auto& first = this->GetSourceRange(first_source, i);
+			const auto& last = this->GetSourceRange(last_source, i);
+			int index_first = first.index_first;
+			int index_count = last.index_first + last.index_count - index_first;
+
+			driver.setRenderPrimitiveRange(m_range_primitives[i], filament::backend::PrimitiveType::TRIANGLES, index_first, 0, max_index, index_count);
+		}
+	}
+
+	static bool CanStaticBatch(const Ref<MeshRenderer>& renderer)
+	{
+		// derived renderers like skinned, skybox and ui renderers generate their own geometry
+		if (typeid(*renderer) != typeid(MeshRenderer))
+		{
+			return false;
+		}
+
+		if (!renderer->IsEnable() || !renderer->GetGameObject()->IsActiveInTree() || renderer->GetStaticBatch())
+		{
+			return false;
+		}
+
+		// merged draws share the first renderer's uniforms, lod fade is per renderer
+		if (renderer->GetLODGroup() && renderer->GetLODGroup()->IsCrossFadeEnable())
+		{
+			return false;
+		}
+
+		const auto& mesh = renderer->GetMesh();
+		if (!mesh || mesh->GetBlendShapes().Size() > 0 || mesh->GetBindposes().Size() > 0 ||
+			mesh->GetVertices().Size() > StaticBatching::MaxBatchVertexCount)
+		{
+			return false;
+		}
+
+		const auto& materials = renderer->GetMaterials();
+		if (materials.Empty())
+		{
+			return false;
+		}
+		for (int i = 0; i < materials.Size(); ++i)
+		{
+			if (!materials[i])
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	static bool IsStaticBatchCompatible(const Ref<MeshRenderer>& a, const Ref<MeshRenderer>& b)
+	{
+		const auto& materials_a = a->GetMaterials();
+		const auto& materials_b = b->GetMaterials();
+		if (materials_a.Size() != materials_b.Size())
+		{
+			return false;
+		}
+		for (int i = 0; i < materials_a.Size(); ++i)
+		{
+			if (materials_a[i] != materials_b[i])
+			{
+				return false;
+			}
+		}
+
+		return a->GetShaderKeywordMask() == b->GetShaderKeywordMask() &&
+			a->GetLightmapIndex() == b->GetLightmapIndex() &&
+			a->IsCastShadow() == b->IsCastShadow() &&
+			a->IsRecieveShadow() == b->IsRecieveShadow() &&
+			a->GetGameObject()->GetLayer() == b->GetGameObject()->GetLayer();
+	}
+
+	void StaticBatching::CombineGroup(const Vector<Ref<MeshRenderer>>& renderers)
+	{
+		int source_count = renderers.Size();
+		int submesh_count = renderers[0]->GetMaterials().Size();
+
+		Vector<Mesh::Vertex> vertices;
+		Vector<unsigned int> indices;
+		Vector<Mesh::Submesh> submeshes(submesh_count * source_count);
+		Vector<int> vertex_offsets(source_count);
+		Vector<int> flips(source_count);
+
+		for (int i = 0; i < source_count; ++i)
+		{
+			const auto& renderer = renderers[i];
+			const auto& source_vertices = renderer->GetMesh()->GetVertices();
+			Matrix4x4 model = renderer->GetTransform()->GetLocalToWorldMatrix();
+			Matrix4x4 normal_matrix = model.Inverse().Transpose();
+
+			// mirrored transform reverses triangle winding
+			float det =
+				model.m00 * (model.m11 * model.m22 - model.m12 * model.m21) -
+				model.m01 * (model.m10 * model.m22 - model.m12 * model.m20) +
+				model.m02 * (model.m10 * model.m21 - model.m11 * model.m20);
+			flips[i] = det < 0 ? 1 : 0;
+
+			// bake lightmap scale offset into uv2
+			bool lightmap = renderer->GetLightmapIndex() >= 0;
+			const Vector4& scale_offset = renderer->GetLightmapScaleOffset();
+
+			vertex_offsets[i] = vertices.Size();
+			for (int j = 0; j < source_vertices.Size(); ++j)
+			{
+				Mesh::Vertex v = source_vertices[j];
+				v.vertex = Vector4(model.MultiplyPoint3x4(Vector3(v.vertex)), v.vertex.w);
+				v.normal = normal_matrix.MultiplyDirection(v.normal).Normalized();
+				v.tangent = Vector4(model.MultiplyDirection(Vector3(v.tangent)).Normalized(), v.tangent.w);
+				if (lightmap)
+				{
+					v.uv2 = Vector2(v.uv2.x * scale_offset.x + scale_offset.z, v.uv2.y * scale_offset.y + scale_offset.w);
+				}
+				vertices.Add(v);
+			}
+		}
+
+		// submesh major, source minor, so visible neighbor sources merge into one range
+		for (int i = 0; i < submesh_count; ++i)
+		{
+			for (int j = 0; j < source_count; ++j)
+			{
+				const auto& mesh = renderers[j]->GetMesh();
+				const auto& source_indices = mesh->GetIndices();
+				const auto& source_submeshes = mesh->GetSubmeshes();
+				const auto& submesh = i < source_submeshes.Size() ? source_submeshes[i] : source_submeshes[0];
+
+				int index_first = indices.Size();
+				for (int k = 0; k < submesh.index_count; ++k)
+				{
+					indices.Add(source_indices[submesh.index_first + k] + vertex_offsets[j]);
+				}
+				if (flips[j] != 0)
+				{
+					for (int k = index_first; k + 2 < indices.Size(); k += 3)
+					{
+						Mathf::Swap(indices[k + 1], indices[k + 2]);
+					}
+				}
+
+				submeshes[i * source_count + j] = Mesh::Submesh({ index_first, submesh.index_count });
+			}
+		}
+
+		auto mesh = RefMake<Mesh>(std::move(vertices), std::move(indices), submeshes);
+		mesh->SetName("StaticBatch");
+
+		// shadow casters of the batch draw from position stream in shadow passes
+		if (renderers[0]->IsCastShadow())
+		{
+			mesh->EnableDepthStream(true);
+		}
+
+		auto batch = RefMake<StaticBatch>(mesh, source_count);
+		for (int i = 0; i < source_count; ++i)
+		{
+			renderers[i]->SetStaticBatch(batch, i);
+		}
+	}
+
+	int StaticBatching::Combine(const Ref<GameObject>& root)
+	{
+		Vector<Vector<Ref<MeshRenderer>>> groups;
+
+		auto renderers = root->GetComponentsInChildren<MeshRenderer>();
+		for (int i = 0; i < renderers.Size(); ++i)
+		{
+			const auto& renderer = renderers[i];
+			if (!CanStaticBatch(renderer))
+			{
+				continue;
+			}
+
+			bool added = false;
+			for (int j = 0; j < groups.Size(); ++j)
+			{
+				if (IsStaticBatchCompatible(groups[j][0], renderer))
+				{
+					groups[j].Add(renderer);
+					added = true;
+					break;
+				}
+			}
+
+			if (!added)
+			{
+				groups.Add(Vector<Ref<MeshRenderer>>({ renderer }));
+			}
+		}
+
+		int combined_count = 0;
+
+		for (int i = 0; i < groups.Size(); ++i)
+		{
+			const auto& group = groups[i];
+
+			// split into batches under the vertex limit
+			Vector<Ref<MeshRenderer>> batch;
+			int vertex_count = 0;
+			for (int j = 0; j <= group.Size(); ++j)
+			{
+				int source_vertex_count = j < group.Size() ? group[j]->GetMesh()->GetVertices().Size() : 0;
+
+				if (j == group.Size() || vertex_count + source_vertex_count > MaxBatchVertexCount)
+				{
+					// a single renderer gains nothing from batching
+					if (batch.Size() > 1)
+					{
+						CombineGroup(batch);
+						combined_count += batch.Size();
+					}
+					batch.Clear();
+					vertex_count = 0;
+				}
+
+				if (j < group.Size())
+				{
+					batch.Add(group[j]);
+					vertex_count += source_vertex_count;
+				}
+			}
+		}
+
+		return combined_count;
+	}
+}
@@ -0,0 +1,69 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Object.h"
+#include "Mesh.h"
+#include "container/Vector.h"
+#include "private/backend/DriverApi.h"
+
+namespace Viry3D
+{
+	class GameObject;
+	class MeshRenderer;
+
+	// world space mesh combined from static renderers sharing materials,
+	// index range of source s in submesh k is submesh k * source count + s
+	class StaticBatch : public Object
+	{
+	public:
+		StaticBatch(const Ref<Mesh>& mesh, int source_count);
+		virtual ~StaticBatch();
+		const Ref<Mesh>& GetMesh() const { return m_mesh; }
+		int GetSourceCount() const { return m_source_count; }
+		const Mesh::Submesh& GetSourceRange(int source, int submesh) const { return m_mesh->GetSubmeshes()[submesh * m_source_count + source]; }
+		// one primitive per submesh drawing only the source range
+		const Vector<filament::backend::RenderPrimitiveHandle>& GetSourcePrimitives(int source) const { return m_source_primitives[source]; }
+		// same as GetSourcePrimitives but reading the depth stream of mesh, empty if not enabled
+		const Vector<filament::backend::RenderPrimitiveHandle>& GetSourceDepthPrimitives(int source) const { return m_source_depth_primitives[source]; }
+		// one primitive per submesh drawing sources first ~ last, ranges are set by SetRange
+		const Vector<filament::backend::RenderPrimitiveHandle>& GetRangePrimitives() const { return m_range_primitives; }
+		void SetRange(int first_source, int last_source);
+
+	private:
+		Ref<Mesh> m_mesh;
+		int m_source_count;
+		Vector<Vector<filament::backend::RenderPrimitiveHandle>> m_source_primitives;
+		Vector<Vector<filament::backend::RenderPrimitiveHandle>> m_source_depth_primitives;
+		Vector<filament::backend::RenderPrimitiveHandle> m_range_primitives;
+	};
+
+	class StaticBatching
+	{
+	public:
+		// max vertices of a combined mesh, keeps 16 bit indices
+		static const int MaxBatchVertexCount = 65535;
+
+		// combine active mesh renderers under root with identical materials, keywords, lightmap, layer and shadow flags
+		// into world space meshes, renderers keep their bounds for culling, return the number of combined renderers
+		static int Combine(const Ref<GameObject>& root);
+
+	private:
+		static void CombineGroup(const Vector<Ref<MeshRenderer>>& renderers);
+	};
+}
@@ -615,6 +615,8 @@ namespace Viry3D
                 return filament::backend::TextureFormat::R32F;
             case TextureFormat::R32G32B32A32F:
                 return filament::backend::TextureFormat::RGBA32F;
+            case TextureFormat::R11G11B10F:
+                return filament::backend::TextureFormat::R11F_G11F_B10F;
 
 			case TextureFormat::D16:
 				return filament::backend::TextureFormat::DEPTH16;
@@ -857,6 +859,7 @@ namespace Viry3D
             case TextureFormat::R16G16B16A16F:
             case TextureFormat::R32F:
             case TextureFormat::R32G32B32A32F:
+            case TextureFormat::R11G11B10F:
 				usage |= filament::backend::TextureUsage::COLOR_ATTACHMENT;
 				break;
 			case TextureFormat::D16:
@@ -930,6 +933,39 @@ namespace Viry3D
 		return Texture::SelectFormat({ TextureFormat::D24X8, TextureFormat::D24S8, TextureFormat::D32, TextureFormat::D32S8, TextureFormat::D16 }, true);
 	}
 
+	TextureFormat Texture::SelectHDRFormat(bool alpha)
+	{
+		TextureFormat format;
+		if (alpha)
+		{
+			format = Texture::SelectFormat({ TextureFormat::R16G16B16A16F, TextureFormat::R32G32B32A32F }, true);
+		}
+		else
+		{
+			format = Texture::SelectFormat({ TextureFormat::R11G11B10F, TextureFormat::R16G16B16A16F, TextureFormat::R32G32B32A32F }, true);
+		}
+
+		if (format == TextureFormat::None)
+		{
+			format = TextureFormat::R8G8B8A8;
+		}
+
+		return format;
+	}
+
+	bool Texture::IsHDRFormat(TextureFormat format)
+	{
+		switch (format)
+		{
+			case TextureFormat::R16G16B16A16F:
+			case TextureFormat::R32G32B32A32F:
+			case TextureFormat::R11G11B10F:
+				return true;
+			default:
+				return false;
+		}
+	}
+
 	Texture::Texture():
 		m_width(0),
 		m_height(0),
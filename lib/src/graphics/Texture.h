@@ -49,6 +49,8 @@ namespace Viry3D
         R16G16B16A16F,
         R32F,
         R32G32B32A32F,
+        // packed unsigned float without alpha, render textures only
+        R11G11B10F,
 		D16,
 		D24X8,
 		D32,
@@ -137,6 +139,10 @@ namespace Viry3D
 			SamplerAddressMode wrap_mode);
 		static TextureFormat SelectFormat(const Vector<TextureFormat>& formats, bool render_texture);
 		static TextureFormat SelectDepthFormat();
+		// smallest float color format the driver renders to, packed R11G11B10F when alpha is not needed,
+		// R8G8B8A8 when no float format is supported
+		static TextureFormat SelectHDRFormat(bool alpha);
+		static bool IsHDRFormat(TextureFormat format);
         virtual ~Texture();
 		void UpdateCubemap(const ByteBuffer& pixels, int level, const Vector<int>& face_offsets);
 		void UpdateTexture(const ByteBuffer& pixels, int layer, int level, int x, int y, int w, int h);
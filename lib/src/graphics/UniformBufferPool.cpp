@@ -0,0 +1,112 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "UniformBufferPool.h"
+#include "Engine.h"
+#include "memory/Memory.h"
+
+namespace Viry3D
+{
+	UniformBufferPool::UniformBufferPool(int slot_size, int slots_per_page):
+		m_slot_size(slot_size),
+		m_slot_stride((slot_size + SlotAlignment - 1) / SlotAlignment * SlotAlignment),
+		m_slots_per_page(slots_per_page)
+	{
+	}
+
+	UniformBufferPool::~UniformBufferPool()
+	{
+		assert(m_pages.Size() == 0);
+	}
+
+	void UniformBufferPool::Clear()
+	{
+		auto& driver = Engine::Instance()->GetDriverApi();
+
+		for (int i = 0; i < m_pages.Size(); ++i)
+		{
+			driver.destroyUniformBuffer(m_pages[i].buffer);
+		}
+		m_pages.Clear();
+		m_free_slots.Clear();
+	}
+
+	int UniformBufferPool::Allocate()
+	{
+		if (m_free_slots.Empty())
+		{
+			auto& driver = Engine::Instance()->GetDriverApi();
+
+			Page page;
+			page.buffer = driver.createUniformBuffer(m_slot_stride * m_slots_per_page, filament::backend::BufferUsage::DYNAMIC);
+			page.data.Resize(m_slot_stride * m_slots_per_page, 0);
+			page.dirty = false;
+			m_pages.Add(page);
+
+			// pop from back, so lower slots are used first
+			int first = (m_pages.Size() - 1) * m_slots_per_page;
+			for (int i = m_slots_per_page - 1; i >= 0; --i)
+			{
+				m_free_slots.Add(first + i);
+			}
+		}
+
+		int slot = m_free_slots[m_free_slots.Size() - 1];
+		m_free_slots.RemoveRange(m_free_slots.Size() - 1, 1);
+
+		return slot;
+	}
+
+	void UniformBufferPool::Free(int slot)
+	{
+		// slots outliving Clear are dropped
+		if (slot < m_pages.Size() * m_slots_per_page)
+		{
+			m_free_slots.Add(slot);
+		}
+	}
+
+	void UniformBufferPool::Update(int slot, const void* data, int size)
+	{
+		Page& page = m_pages[slot / m_slots_per_page];
+		int offset = this->GetOffset(slot);
+
+		assert(size <= m_slot_size);
+		Memory::Copy(&page.data[offset], data, size);
+		page.dirty = true;
+	}
+
+	void UniformBufferPool::Flush()
+	{
+		auto& driver = Engine::Instance()->GetDriverApi();
+
+		for (int i = 0; i < m_pages.Size(); ++i)
+		{
+			Page& page = m_pages[i];
+			if (page.dirty)
+			{
+				// whole page, dynamic buffers may be discarded or renamed on load
+				int size = page.data.Size();
+				void* buffer = driver.allocate(size);
+				Memory::Copy(buffer, &page.data[0], size);
+				driver.loadUniformBuffer(page.buffer, filament::backend::BufferDescriptor(buffer, size));
+
+				page.dirty = false;
+			}
+		}
+	}
+}
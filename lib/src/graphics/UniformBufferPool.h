@@ -0,0 +1,59 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "container/Vector.h"
+#include "private/backend/DriverApi.h"
+
+namespace Viry3D
+{
+	// fixed size uniform blocks packed into a few large buffers and bound by offset,
+	// written slots are kept in a cpu copy and uploaded once per page in Flush
+	class UniformBufferPool
+	{
+	public:
+		static const int SlotAlignment = 256;
+
+		UniformBufferPool(int slot_size, int slots_per_page);
+		~UniformBufferPool();
+		void Clear();
+		int Allocate();
+		void Free(int slot);
+		// size is at most slot size
+		void Update(int slot, const void* data, int size);
+		void Flush();
+		const filament::backend::UniformBufferHandle& GetBuffer(int slot) const { return m_pages[slot / m_slots_per_page].buffer; }
+		int GetOffset(int slot) const { return (slot % m_slots_per_page) * m_slot_stride; }
+		int GetSlotSize() const { return m_slot_size; }
+		int GetPageCount() const { return m_pages.Size(); }
+
+	private:
+		struct Page
+		{
+			filament::backend::UniformBufferHandle buffer;
+			Vector<uint8_t> data;
+			bool dirty;
+		};
+
+		int m_slot_size;
+		int m_slot_stride;
+		int m_slots_per_page;
+		Vector<Page> m_pages;
+		Vector<int> m_free_slots;
+	};
+}
@@ -17,6 +17,7 @@
 
 #include "Bounds.h"
 #include "Mathf.h"
+#include "Matrix4x4.h"
 
 namespace Viry3D
 {
@@ -42,4 +43,35 @@ namespace Viry3D
             (point.z > m_min.z || Mathf::FloatEqual(point.z, m_min.z)) &&
             (point.z < m_max.z || Mathf::FloatEqual(point.z, m_max.z));
 	}
+
+    bool Bounds::Intersects(const Bounds& bounds) const
+    {
+        return m_min.x <= bounds.m_max.x && m_max.x >= bounds.m_min.x &&
+            m_min.y <= bounds.m_max.y && m_max.y >= bounds.m_min.y &&
+            m_min.z <= bounds.m_max.z && m_max.z >= bounds.m_min.z;
+    }
+
+    void Bounds::Encapsulate(const Vector3& point)
+    {
+        m_min = Vector3::Min(m_min, point);
+        m_max = Vector3::Max(m_max, point);
+    }
+
+    void Bounds::Encapsulate(const Bounds& bounds)
+    {
+        m_min = Vector3::Min(m_min, bounds.m_min);
+        m_max = Vector3::Max(m_max, bounds.m_max);
+    }
+
+    Bounds Bounds::Transform(const Matrix4x4& matrix) const
+    {
+        Vector3 center = matrix.MultiplyPoint3x4(this->GetCenter());
+        Vector3 extents = this->GetExtents();
+        Vector3 world_extents(
+            fabs(matrix.m00) * extents.x + fabs(matrix.m01) * extents.y + fabs(matrix.m02) * extents.z,
+            fabs(matrix.m10) * extents.x + fabs(matrix.m11) * extents.y + fabs(matrix.m12) * extents.z,
+            fabs(matrix.m20) * extents.x + fabs(matrix.m21) * extents.y + fabs(matrix.m22) * extents.z);
+
+        return Bounds(center - world_extents, center + world_extents);
+    }
 }
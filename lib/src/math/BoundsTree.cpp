@@ -0,0 +1,416 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "BoundsTree.h"
+
+namespace Viry3D
+{
+	BoundsTree::BoundsTree(float margin):
+		m_root(NullNode),
+		m_free_list(NullNode),
+		m_proxy_count(0),
+		m_margin(margin)
+	{
+	}
+
+	int BoundsTree::CreateProxy(const Bounds& bounds, void* user_data)
+	{
+		int proxy = this->AllocateNode();
+
+		Vector3 margin(m_margin, m_margin, m_margin);
+		m_nodes[proxy].bounds = Bounds(bounds.Min() - margin, bounds.Max() + margin);
+		m_nodes[proxy].user_data = user_data;
+		m_nodes[proxy].height = 0;
+
+		this->InsertLeaf(proxy);
+		m_proxy_count++;
+
+		return proxy;
+	}
+
+	void BoundsTree::DestroyProxy(int proxy)
+	{
+		assert(proxy >= 0 && proxy < m_nodes.Size());
+		assert(m_nodes[proxy].IsLeaf());
+
+		this->RemoveLeaf(proxy);
+		this->FreeNode(proxy);
+		m_proxy_count--;
+	}
+
+	bool BoundsTree::MoveProxy(int proxy, const Bounds& bounds)
+	{
+		assert(proxy >= 0 && proxy < m_nodes.Size());
+		assert(m_nodes[proxy].IsLeaf());
+
+		const Bounds& fat = m_nodes[proxy].bounds;
+		if (fat.Contains(bounds.Min()) && fat.Contains(bounds.Max()))
+		{
+			return false;
+		}
+
+		this->RemoveLeaf(proxy);
+
+		Vector3 margin(m_margin, m_margin, m_margin);
+		m_nodes[proxy].bounds = Bounds(bounds.Min() - margin, bounds.Max() + margin);
+
+		this->InsertLeaf(proxy);
+
+		return true;
+	}
+
+	int BoundsTree::AllocateNode()
+	{
+		int node;
+
+		if (m_free_list != NullNode)
+		{
+			node = m_free_list;
+			m_free_list = m_nodes[node].parent;
+		}
+		else
+		{
+			node = m_nodes.Size();
+			m_nodes.Add(Node());
+		}
+
+		m_nodes[node].user_data = nullptr;
+		m_nodes[node].parent = NullNode;
+		m_nodes[node].child1 = NullNode;
+		m_nodes[node].child2 = NullNode;
+		m_nodes[node].height = 0;
+
+		return node;
+	}
+
+	void BoundsTree::FreeNode(int node)
+	{
+		m_nodes[node].user_data = nullptr;
+		m_nodes[node].parent = m_free_list;
+		m_nodes[node].height = -1;
+		m_free_list = node;
+	}
+
+	void BoundsTree::InsertLeaf(int leaf)
+	{
+		if (m_root == NullNode)
+		{
+			m_root = leaf;
+			m_nodes[m_root].parent = NullNode;
+			return;
+		}
+
+		// find the best sibling by surface area heuristic
+		Bounds leaf_bounds = m_nodes[leaf].bounds;
+		int index = m_root;
+		while (!m_nodes[index].IsLeaf())
+		{
+			int child1 = m_nodes[index].child1;
+			int child2 = m_nodes[index].child2;
+
+			float area = Area(m_nodes[index].bounds);
+			float combined_area = Area(Combine(m_nodes[index].bounds, leaf_bounds));
+
+			// cost of creating a new parent for this node and the new leaf
+			float cost = 2.0f * combined_area;
+
+			// minimum cost of pushing the leaf further down the tree
+			float inheritance_cost = 2.0f * (combined_area - area);
+
+			float cost1 = Area(Combine(leaf_bounds, m_nodes[child1].bounds));
+			if (!m_nodes[child1].IsLeaf())
+			{
+				cost1 -= Area(m_nodes[child1].bounds);
+			}
+			cost1 += inheritance_cost;
+
+			float cost2 = Area(Combine(leaf_bounds, m_nodes[child2].bounds));
+			if (!m_nodes[child2].IsLeaf())
+			{
+				cost2 -= Area(m_nodes[child2].bounds);
+			}
+			cost2 += inheritance_cost;
+
+			if (cost < cost1 && cost < cost2)
+			{
+				break;
+			}
+
+			index = cost1 < cost2 ? child1 : child2;
+		}
+
+		int sibling = index;
+
+		// create a new parent
+		int old_parent = m_nodes[sibling].parent;
+		int new_parent = this->AllocateNode();
+		m_nodes[new_parent].parent = old_parent;
+		m_nodes[new_parent].bounds = Combine(leaf_bounds, m_nodes[sibling].bounds);
+		m_nodes[new_parent].height = m_nodes[sibling].height + 1;
+
+		if (old_parent != NullNode)
+		{
+			if (m_nodes[old_parent].child1 == sibling)
+			{
+				m_nodes[old_parent].child1 = new_parent;
+			}
+			else
+			{
+				m_nodes[old_parent].child2 = new_parent;
+			}
+		}
+		else
+		{
+			m_root = new_parent;
+		}
+
+		m_nodes[new_parent].child1 = sibling;
+		m_nodes[new_parent].child2 = leaf;
+		m_nodes[sibling].parent = new_parent;
+		m_nodes[leaf].parent = new_parent;
+
+		// walk back up the tree fixing heights and bounds
+		index = m_nodes[leaf].parent;
+		while (index != NullNode)
+		{
+			index = this->Balance(index);
+
+			int child1 = m_nodes[index].child1;
+			int child2 = m_nodes[index].child2;
+
+			m_nodes[index].height = 1 + Mathf::Max(m_nodes[child1].height, m_nodes[child2].height);
+			m_nodes[index].bounds = Combine(m_nodes[child1].bounds, m_nodes[child2].bounds);
+
+			index = m_nodes[index].parent;
+		}
+	}
+
+	void BoundsTree::RemoveLeaf(int leaf)
+	{
+		if (leaf == m_root)
+		{
+			m_root = NullNode;
+			return;
+		}
+
+		int parent = m_nodes[leaf].parent;
+		int grand_parent = m_nodes[parent].parent;
+		int sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+		if (grand_parent != NullNode)
+		{
+			// destroy parent and connect sibling to grand parent
+			if (m_nodes[grand_parent].child1 == parent)
+			{
+				m_nodes[grand_parent].child1 = sibling;
+			}
+			else
+			{
+				m_nodes[grand_parent].child2 = sibling;
+			}
+			m_nodes[sibling].parent = grand_parent;
+			this->FreeNode(parent);
+
+			int index = grand_parent;
+			while (index != NullNode)
+			{
+				index = this->Balance(index);
+
+				int child1 = m_nodes[index].child1;
+				int child2 = m_nodes[index].child2;
+
+				m_nodes[index].bounds = Combine(m_nodes[child1].bounds, m_nodes[child2].bounds);
+				m_nodes[index].height = 1 + Mathf::Max(m_nodes[child1].height, m_nodes[child2].height);
+
+				index = m_nodes[index].parent;
+			}
+		}
+		else
+		{
+			m_root = sibling;
+			m_nodes[sibling].parent = NullNode;
+			this->FreeNode(parent);
+		}
+	}
+
+	// rotate node a up if it is imbalanced, return the new root of the subtree
+	int BoundsTree::Balance(int a)
+	{
+		Node* A = &m_nodes[a];
+		if (A->IsLeaf() || A->height < 2)
+		{
+			return a;
+		}
+
+		int b = A->child1;
+		int c = A->child2;
+		Node* B = &m_nodes[b];
+		Node* C = &m_nodes[c];
+
+		int balance = C->height - B->height;
+
+		// rotate c up
+		if (balance > 1)
+		{
+			int f = C->child1;
+			int g = C->child2;
+			Node* F = &m_nodes[f];
+			Node* G = &m_nodes[g];
+
+			C->child1 = a;
+			C->parent = A->parent;
+			A->parent = c;
+
+			if (C->parent != NullNode)
+			{
+				if (m_nodes[C->parent].child1 == a)
+				{
+					m_nodes[C->parent].child1 = c;
+				}
+				else
+				{
+					m_nodes[C->parent].child2 = c;
+				}
+			}
+			else
+			{
+				m_root = c;
+			}
+
+			if (F->height > G->height)
+			{
+				C->child2 = f;
+				A->child2 = g;
+				G->parent = a;
+				A->bounds = Combine(B->bounds, G->bounds);
+				C->bounds = Combine(A->bounds, F->bounds);
+				A->height = 1 + Mathf::Max(B->height, G->height);
+				C->height = 1 + Mathf::Max(A->height, F->height);
+			}
+			else
+			{
+				C->child2 = g;
+				A->child2 = f;
+				F->parent = a;
+				A->bounds = Combine(B->bounds, F->bounds);
+				C->bounds = Combine(A->bounds, G->bounds);
+				A->height = 1 + Mathf::Max(B->height, F->height);
+				C->height = 1 + Mathf::Max(A->height, G->height);
+			}
+
+			return c;
+		}
+
+		// rotate b up
+		if (balance < -1)
+		{
+			int d = B->child1;
+			int e = B->child2;
+			Node* D = &m_nodes[d];
+			Node* E = &m_nodes[e];
+
+			B->child1 = a;
+			B->parent = A->parent;
+			A->parent = b;
+
+			if (B->parent != NullNode)
+			{
+				if (m_nodes[B->parent].child1 == a)
+				{
+					m_nodes[B->parent].child1 = b;
+				}
+				else
+				{
+					m_nodes[B->parent].child2 = b;
+				}
+			}
+			else
+			{
+				m_root = b;
+			}
+
+			if (D->height > E->height)
+			{
+				B->child2 = d;
+				A->child1 = e;
+				E->parent = a;
+				A->bounds = Combine(C->bounds, E->bounds);
+				B->bounds = Combine(A->bounds, D->bounds);
+				A->height = 1 + Mathf::Max(C->height, E->height);
+				B->height = 1 + Mathf::Max(A->height, D->height);
+			}
+			else
+			{
+				B->child2 = e;
+				A->child1 = d;
+				D->parent = a;
+				A->bounds = Combine(C->bounds, D->bounds);
+				B->bounds = Combine(A->bounds, E->bounds);
+				A->height = 1 + Mathf::Max(C->height, D->height);
+				B->height = 1 + Mathf::Max(A->height, E->height);
+			}
+
+			return b;
+		}
+
+		return a;
+	}
+
+	Bounds BoundsTree::Combine(const Bounds& a, const Bounds& b)
+	{
+		Bounds bounds = a;
+		bounds.Encapsulate(b);
+		return bounds;
+	}
+
+	float BoundsTree::Area(const Bounds& bounds)
+	{
+		Vector3 size = bounds.GetSize();
+		return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+	}
+
+	bool BoundsTree::RayIntersects(const Vector3& origin, const Vector3& inv_dir, const Bounds& bounds, float max_length)
+	{
+		float t_min = 0;
+		float t_max = max_length;
+
+		const float o[3] = { origin.x, origin.y, origin.z };
+		const float inv[3] = { inv_dir.x, inv_dir.y, inv_dir.z };
+		const float min[3] = { bounds.Min().x, bounds.Min().y, bounds.Min().z };
+		const float max[3] = { bounds.Max().x, bounds.Max().y, bounds.Max().z };
+
+		for (int i = 0; i < 3; ++i)
+		{
+			float t1 = (min[i] - o[i]) * inv[i];
+			float t2 = (max[i] - o[i]) * inv[i];
+			if (t1 > t2)
+			{
+				Mathf::Swap(t1, t2);
+			}
+
+			t_min = Mathf::Max(t_min, t1);
+			t_max = Mathf::Min(t_max, t2);
+
+			if (t_min > t_max)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
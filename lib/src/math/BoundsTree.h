@@ -0,0 +1,201 @@
+/*
+* Viry3D
+* Copyright 2014-2019 by Stack - stackos@qq.com
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include "Bounds.h"
+#include "Frustum.h"
+#include "Ray.h"
+#include "Mathf.h"
+#include "container/Vector.h"
+#include <assert.h>
+
+namespace Viry3D
+{
+	// dynamic aabb tree, leaves keep fattened bounds so small moves do not touch the tree
+	class BoundsTree
+	{
+	public:
+		static const int NullNode = -1;
+
+		BoundsTree(float margin = 0.1f);
+		int CreateProxy(const Bounds& bounds, void* user_data);
+		void DestroyProxy(int proxy);
+		// return true if the proxy was reinserted
+		bool MoveProxy(int proxy, const Bounds& bounds);
+		void* GetUserData(int proxy) const { return m_nodes[proxy].user_data; }
+		const Bounds& GetFatBounds(int proxy) const { return m_nodes[proxy].bounds; }
+		int GetProxyCount() const { return m_proxy_count; }
+		int GetHeight() const { return m_root == NullNode ? 0 : m_nodes[m_root].height; }
+		// callback(void* user_data) for every leaf overlapping bounds
+		template <class T>
+		void Query(const Bounds& bounds, T callback) const;
+		// callback(void* user_data, bool inside) for every leaf not outside frustum,
+		// inside is true when the whole leaf was proven to be in frustum
+		template <class T>
+		void Query(const Frustum& frustum, T callback) const;
+		// callback(void* user_data) for every leaf hit by ray within max_length
+		template <class T>
+		void Query(const Ray& ray, float max_length, T callback) const;
+
+	private:
+		struct Node
+		{
+			Bounds bounds;
+			void* user_data;
+			int parent;
+			int child1;
+			int child2;
+			// leaf = 0, free = -1
+			int height;
+
+			bool IsLeaf() const { return child1 == NullNode; }
+		};
+
+		static const int StackSize = 256;
+
+		int AllocateNode();
+		void FreeNode(int node);
+		void InsertLeaf(int leaf);
+		void RemoveLeaf(int leaf);
+		int Balance(int a);
+		static Bounds Combine(const Bounds& a, const Bounds& b);
+		static float Area(const Bounds& bounds);
+		static bool RayIntersects(const Vector3& origin, const Vector3& inv_dir, const Bounds& bounds, float max_length);
+
+	private:
+		Vector<Node> m_nodes;
+		int m_root;
+		int m_free_list;
+		int m_proxy_count;
+		float m_margin;
+	};
+
+	template <class T>
+	void BoundsTree::Query(const Bounds& bounds, T callback) const
+	{
+		int stack[StackSize];
+		int count = 0;
+
+		if (m_root != NullNode)
+		{
+			stack[count++] = m_root;
+		}
+
+		while (count > 0)
+		{
+			const Node& node = m_nodes[stack[--count]];
+
+			if (node.bounds.Intersects(bounds))
+			{
+				if (node.IsLeaf())
+				{
+					callback(node.user_data);
+				}
+				else
+				{
+					assert(count + 2 <= StackSize);
+					stack[count++] = node.child1;
+					stack[count++] = node.child2;
+				}
+			}
+		}
+	}
+
+	template <class T>
+	void BoundsTree::Query(const Frustum& frustum, T callback) const
+	{
+		// sign bit marks a subtree already known to be inside frustum
+		int stack[StackSize];
+		int count = 0;
+
+		if (m_root != NullNode)
+		{
+			stack[count++] = m_root;
+		}
+
+		while (count > 0)
+		{
+			int index = stack[--count];
+			bool inside = index < 0;
+			if (inside)
+			{
+				index = ~index;
+			}
+
+			const Node& node = m_nodes[index];
+
+			if (!inside)
+			{
+				ContainsResult result = frustum.ContainsBounds(node.bounds);
+				if (result == ContainsResult::Out)
+				{
+					continue;
+				}
+				inside = result == ContainsResult::In;
+			}
+
+			if (node.IsLeaf())
+			{
+				callback(node.user_data, inside);
+			}
+			else
+			{
+				assert(count + 2 <= StackSize);
+				stack[count++] = inside ? ~node.child1 : node.child1;
+				stack[count++] = inside ? ~node.child2 : node.child2;
+			}
+		}
+	}
+
+	template <class T>
+	void BoundsTree::Query(const Ray& ray, float max_length, T callback) const
+	{
+		const Vector3& dir = ray.GetDirection();
+		Vector3 inv_dir(
+			dir.x != 0 ? 1.0f / dir.x : Mathf::MaxFloatValue,
+			dir.y != 0 ? 1.0f / dir.y : Mathf::MaxFloatValue,
+			dir.z != 0 ? 1.0f / dir.z : Mathf::MaxFloatValue);
+
+		int stack[StackSize];
+		int count = 0;
+
+		if (m_root != NullNode)
+		{
+			stack[count++] = m_root;
+		}
+
+		while (count > 0)
+		{
+			const Node& node = m_nodes[stack[--count]];
+
+			if (RayIntersects(ray.GetOrigin(), inv_dir, node.bounds, max_length))
+			{
+				if (node.IsLeaf())
+				{
+					callback(node.user_data);
+				}
+				else
+				{
+					assert(count + 2 <= StackSize);
+					stack[count++] = node.child1;
+					stack[count++] = node.child2;
+				}
+			}
+		}
+	}
+}
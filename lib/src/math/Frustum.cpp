@@ -172,17 +172,41 @@ namespace Viry3D
 
 	ContainsResult Frustum::ContainsBounds(const Vector3& min, const Vector3& max) const
 	{
-		Vector<Vector3> corners(8);
-		corners[0] = max;
-		corners[1] = Vector3(min.x, max.y, max.z);
-		corners[2] = Vector3(max.x, min.y, max.z);
-		corners[3] = Vector3(max.x, max.y, min.z);
-		corners[4] = Vector3(min.x, min.y, max.z);
-		corners[5] = Vector3(min.x, max.y, min.z);
-		corners[6] = Vector3(max.x, min.y, min.z);
-		corners[7] = min;
-
-		return ContainsPoints(corners, nullptr);
+		Vector3 center = (min + max) * 0.5f;
+		Vector3 extents = (max - min) * 0.5f;
+		bool all_in = true;
+
+		for (int i = 0; i < 6; ++i)
+		{
+			const Vector4& plane = m_planes[i];
+
+			// distance of the center and projected radius of the box on the plane normal
+			float dis = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+			float radius = fabs(plane.x) * extents.x + fabs(plane.y) * extents.y + fabs(plane.z) * extents.z;
+
+			// all corners in negative side of one plane
+			if (dis + radius < 0)
+			{
+				return ContainsResult::Out;
+			}
+
+			if (dis - radius < 0)
+			{
+				all_in = false;
+			}
+		}
+
+		if (!all_in)
+		{
+			return ContainsResult::Cross;
+		}
+
+		return ContainsResult::In;
+	}
+
+	ContainsResult Frustum::ContainsBounds(const Bounds& bounds) const
+	{
+		return ContainsBounds(bounds.Min(), bounds.Max());
 	}
 
 	ContainsResult Frustum::ContainsPoints(const Vector<Vector3>& points, const Matrix4x4* matrix) const
@@ -19,6 +19,7 @@
 
 #include "Matrix4x4.h"
 #include "Vector3.h"
+#include "Bounds.h"
 
 namespace Viry3D
 {
@@ -57,6 +58,7 @@ namespace Viry3D
 		ContainsResult ContainsPoint(const Vector3& point) const;
 		ContainsResult ContainsSphere(const Vector3& center, float radius) const;
 		ContainsResult ContainsBounds(const Vector3& min, const Vector3& max) const;
+		ContainsResult ContainsBounds(const Bounds& bounds) const;
 		ContainsResult ContainsPoints(const Vector<Vector3>& points, const Matrix4x4* matrix) const;
 		float DistanceToPlane(const Vector3& point, int plane_index) const;
 
@@ -16,6 +16,70 @@
 */
 
 #include "Memory.h"
+#include <atomic>
+#include <new>
+
+#ifndef NDEBUG
+// global operator new calls, replaced below so allocations made inside std containers and std::function are counted
+static std::atomic<int> g_new_count(0);
+
+void* operator new(size_t size)
+{
+	g_new_count++;
+	void* p = malloc(size > 0 ? size : 1);
+	if (p == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	g_new_count++;
+	return malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept
+{
+	free(p);
+}
+#endif
 
 namespace Viry3D
 {
@@ -23,5 +87,15 @@ namespace Viry3D
 	std::mutex Memory::m_mutex;
 	int Memory::m_alloc_size = 0;
 	int Memory::m_new_size = 0;
+	int Memory::m_alloc_count = 0;
+
+	int Memory::GetAllocCount()
+	{
+		m_mutex.lock();
+		int count = m_alloc_count;
+		m_mutex.unlock();
+
+		return count + g_new_count;
+	}
 #endif
 }
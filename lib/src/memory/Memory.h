@@ -32,6 +32,7 @@ namespace Viry3D
 #ifndef NDEBUG
 			m_mutex.lock();
 			m_alloc_size += size;
+			m_alloc_count++;
 			m_mutex.unlock();
 #endif
 			return (T*) malloc(size);
@@ -44,6 +45,7 @@ namespace Viry3D
 			m_mutex.lock();
 			m_alloc_size -= old_size;
 			m_alloc_size += size;
+			m_alloc_count++;
 			m_mutex.unlock();
 #endif
 			return (T*) realloc(block, size);
@@ -103,6 +105,9 @@ namespace Viry3D
 #ifndef NDEBUG
 		static int GetAllocSize() { return m_alloc_size; }
 		static int GetNewSize() { return m_new_size; }
+		// number of Alloc and Realloc calls plus global operator new calls from all threads, never decreases,
+		// so std containers and std::function storage are counted too
+		static int GetAllocCount();
 #endif
 
 	private:
@@ -110,6 +115,7 @@ namespace Viry3D
 		static std::mutex m_mutex;
 		static int m_alloc_size;
 		static int m_new_size;
+		static int m_alloc_count;
 #endif
 	};
 }
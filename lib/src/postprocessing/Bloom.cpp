@@ -19,6 +19,7 @@
 #include "graphics/Camera.h"
 #include "graphics/Material.h"
 #include "graphics/RenderTarget.h"
+#include "graphics/RenderGraph.h"
 
 namespace Viry3D
 {
@@ -32,104 +33,125 @@ namespace Viry3D
 		m_material.reset();
 	}
 
-	void Bloom::OnRenderImage(const Ref<RenderTarget>& src, const Ref<RenderTarget>& dst)
+	void Bloom::OnRenderGraph(RenderGraph& graph, int src, int dst)
 	{
-		enum Pass
-		{
-			Prefilter13,
-			Downsample13,
-			UpsampleTent,
-            Uber,
-		};
-
-		struct Level
-		{
-			Ref<RenderTarget> down;
-			Ref<RenderTarget> up;
-		};
-
-		const int MAX_PYRAMID_SIZE = 16;
+		const RenderTargetKey& src_key = graph.GetTargetKey(src);
 
 		float ratio = Mathf::Clamp(m_anamorphic_ratio, -1.0f, 1.0f);
 		float rw = ratio < 0 ? -ratio : 0;
 		float rh = ratio > 0 ?  ratio : 0;
 
 		// half res
-		int tw = Mathf::FloorToInt(src->key.width / (2 - rw));
-		int th = Mathf::FloorToInt(src->key.height / (2 - rh));
+		int tw = Mathf::FloorToInt(src_key.width / (2 - rw));
+		int th = Mathf::FloorToInt(src_key.height / (2 - rh));
 
 		// determine the iteration count
 		int s = Mathf::Max(tw, th);
 		float logs = Mathf::Log2((float) s) + Mathf::Min(m_diffusion, 10.0f) - 10;
 		int logs_i = Mathf::FloorToInt(logs); 
-		int iterations = Mathf::Clamp(logs_i, 1, MAX_PYRAMID_SIZE);
-		float sample_scale = 0.5f + logs - logs_i;
-        m_material->SetFloat("_SampleScale", sample_scale);
-        
-		// prefiltering parameters
-		float lthresh = m_threshold;
-		float knee = lthresh * m_soft_knee + 1e-5f;
-		m_material->SetVector("_Threshold", Vector4(lthresh, lthresh - knee, knee * 2, 0.25f / knee));
-		float lclamp = m_clamp;
-		m_material->SetVector("_Params", Vector4(lclamp, 0, 0, 0));
+		m_iterations = Mathf::Clamp(logs_i, 1, MaxPyramidSize);
+		m_sample_scale = 0.5f + logs - logs_i;
+		m_src = src;
+		m_dst = dst;
 
-		// downsample
-		Level levels[MAX_PYRAMID_SIZE];
-		auto last_down = src;
-		for (int i = 0; i < iterations; i++)
-		{
-			int pass = i == 0 ? (int) Pass::Prefilter13 : (int) Pass::Downsample13;
+		// alpha of the source is applied in prefilter, the pyramid only keeps color
+		TextureFormat pyramid_format = Texture::IsHDRFormat(src_key.color_format) ? Texture::SelectHDRFormat(false) : src_key.color_format;
 
-			levels[i].down = RenderTarget::GetTemporaryRenderTarget(
+		// the up level of the smallest size is never written, the graph skips it
+		for (int i = 0; i < m_iterations; i++)
+		{
+			m_levels[i].down = graph.CreateTarget(
+				"BloomDown",
 				tw,
 				th,
-				src->key.color_format,
+				pyramid_format,
 				TextureFormat::None,
 				FilterMode::Linear,
 				SamplerAddressMode::ClampToEdge,
 				filament::backend::TargetBufferFlags::COLOR);
-			levels[i].up = RenderTarget::GetTemporaryRenderTarget(
+			m_levels[i].up = graph.CreateTarget(
+				"BloomUp",
 				tw,
 				th,
-				src->key.color_format,
+				pyramid_format,
 				TextureFormat::None,
 				FilterMode::Linear,
 				SamplerAddressMode::ClampToEdge,
 				filament::backend::TargetBufferFlags::COLOR);
-			m_material->SetVector("u_texel_size", Vector4(1.0f / last_down->color->GetWidth(), 1.0f / last_down->color->GetHeight(), 0, 0));
-            m_material->SetTexture(MaterialProperty::TEXTURE, last_down->color);
-			Camera::Blit(last_down, levels[i].down, m_material, pass);
 
-			last_down = levels[i].down;
 			tw = Mathf::Max(tw / 2, 1);
 			th = Mathf::Max(th / 2, 1);
 		}
 
-		// upsample
-		auto last_up = levels[iterations - 1].down;
-		for (int i = iterations - 2; i >= 0; i--)
+		// downsample
+		for (int i = 0; i < m_iterations; i++)
 		{
-            m_material->SetTexture("_BloomTex", levels[i].down->color);
-            m_material->SetVector("u_texel_size", Vector4(1.0f / last_up->color->GetWidth(), 1.0f / last_up->color->GetHeight(), 0, 0));
-            m_material->SetTexture(MaterialProperty::TEXTURE, last_up->color);
-			Camera::Blit(last_up, levels[i].up, m_material, (int) Pass::UpsampleTent);
+			int last_down = i == 0 ? src : m_levels[i - 1].down;
 
-			last_up = levels[i].up;
+			graph.AddPass("BloomDownsample", { last_down }, { m_levels[i].down }, [this, i](RenderGraph& graph) {
+				this->Downsample(graph, i);
+			});
+		}
+
+		// upsample
+		for (int i = m_iterations - 2; i >= 0; i--)
+		{
+			graph.AddPass("BloomUpsample", { this->GetLastUp(i), m_levels[i].down }, { m_levels[i].up }, [this, i](RenderGraph& graph) {
+				this->Upsample(graph, i);
+			});
 		}
 
-        // uber
-        m_material->SetVector("_Bloom_Settings", Vector4(sample_scale, m_intensity, 0, (float) iterations));
-        m_material->SetColor("_Bloom_Color", m_color);
-        m_material->SetTexture("_BloomTex", last_up->color);
-        m_material->SetVector("u_texel_size", Vector4(1.0f / last_up->color->GetWidth(), 1.0f / last_up->color->GetHeight(), 0, 0));
-        m_material->SetTexture(MaterialProperty::TEXTURE, src->color);
-        Camera::Blit(src, dst, m_material, (int) Pass::Uber);
-        
-		// cleanup
-		for (int i = 0; i < iterations; i++)
+		// uber
+		graph.AddPass("BloomUber", { src, this->GetLastUp(-1) }, { dst }, [this](RenderGraph& graph) {
+			this->Uber(graph);
+		});
+	}
+
+	int Bloom::GetLastUp(int level) const
+	{
+		// level below the given one, the smallest level is only downsampled
+		if (level + 1 == m_iterations - 1)
 		{
-			RenderTarget::ReleaseTemporaryRenderTarget(levels[i].down);
-			RenderTarget::ReleaseTemporaryRenderTarget(levels[i].up);
+			return m_levels[level + 1].down;
 		}
+		return m_levels[level + 1].up;
+	}
+
+	void Bloom::Downsample(RenderGraph& graph, int level)
+	{
+		// prefiltering parameters
+		float lthresh = m_threshold;
+		float knee = lthresh * m_soft_knee + 1e-5f;
+		Vector4 threshold(lthresh, lthresh - knee, knee * 2, 0.25f / knee);
+		Vector4 params(m_clamp, 0, 0, 0);
+
+		const auto& from = graph.GetTarget(level == 0 ? m_src : m_levels[level - 1].down);
+		m_material->SetFloat("_SampleScale", m_sample_scale);
+		m_material->SetVector("_Threshold", threshold);
+		m_material->SetVector("_Params", params);
+		m_material->SetVector("u_texel_size", Vector4(1.0f / from->color->GetWidth(), 1.0f / from->color->GetHeight(), 0, 0));
+		m_material->SetTexture(MaterialProperty::TEXTURE, from->color);
+		Camera::Blit(from, graph.GetTarget(m_levels[level].down), m_material, level == 0 ? (int) Pass::Prefilter13 : (int) Pass::Downsample13);
+	}
+
+	void Bloom::Upsample(RenderGraph& graph, int level)
+	{
+		const auto& from = graph.GetTarget(this->GetLastUp(level));
+		m_material->SetTexture("_BloomTex", graph.GetTarget(m_levels[level].down)->color);
+		m_material->SetVector("u_texel_size", Vector4(1.0f / from->color->GetWidth(), 1.0f / from->color->GetHeight(), 0, 0));
+		m_material->SetTexture(MaterialProperty::TEXTURE, from->color);
+		Camera::Blit(from, graph.GetTarget(m_levels[level].up), m_material, (int) Pass::UpsampleTent);
+	}
+
+	void Bloom::Uber(RenderGraph& graph)
+	{
+		const auto& from = graph.GetTarget(m_src);
+		const auto& bloom = graph.GetTarget(this->GetLastUp(-1));
+		m_material->SetVector("_Bloom_Settings", Vector4(m_sample_scale, m_intensity, 0, (float) m_iterations));
+		m_material->SetColor("_Bloom_Color", m_color);
+		m_material->SetTexture("_BloomTex", bloom->color);
+		m_material->SetVector("u_texel_size", Vector4(1.0f / bloom->color->GetWidth(), 1.0f / bloom->color->GetHeight(), 0, 0));
+		m_material->SetTexture(MaterialProperty::TEXTURE, from->color);
+		Camera::Blit(from, graph.GetTarget(m_dst), m_material, (int) Pass::Uber);
 	}
 }
@@ -29,7 +29,7 @@ namespace Viry3D
 	public:
 		Bloom();
 		virtual ~Bloom();
-		virtual void OnRenderImage(const Ref<RenderTarget>& src, const Ref<RenderTarget>& dst);
+		virtual void OnRenderGraph(RenderGraph& graph, int src, int dst);
 		void SetIntensity(float intensity) { m_intensity = intensity; }
 		void SetThreshold(float threshold) { m_threshold = threshold; }
 		void SetSoftKnee(float soft_knee) { m_soft_knee = soft_knee; }
@@ -38,8 +38,37 @@ namespace Viry3D
 		void SetAnamorphicRatio(float anamorphic_ratio) { m_anamorphic_ratio = anamorphic_ratio; }
 		void SetColor(float color) { m_color = color; }
 
+	private:
+		enum class Pass
+		{
+			Prefilter13,
+			Downsample13,
+			UpsampleTent,
+			Uber,
+		};
+
+		struct Level
+		{
+			int down;
+			int up;
+		};
+
+		static const int MaxPyramidSize = 16;
+
+		int GetLastUp(int level) const;
+		void Downsample(RenderGraph& graph, int level);
+		void Upsample(RenderGraph& graph, int level);
+		void Uber(RenderGraph& graph);
+
 	private:
 		Ref<Material> m_material;
+		// graph targets and parameters of this frame, pass functions only capture this and a level
+		// to fit in the small storage of std::function
+		Level m_levels[MaxPyramidSize];
+		int m_iterations = 0;
+		int m_src = -1;
+		int m_dst = -1;
+		float m_sample_scale = 0;
 		float m_intensity = 0.0f;
 		float m_threshold = 1.0f;
 		float m_soft_knee = 0.5f;
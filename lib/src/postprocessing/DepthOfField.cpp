@@ -20,6 +20,7 @@
 #include "graphics/Camera.h"
 #include "graphics/Material.h"
 #include "graphics/RenderTarget.h"
+#include "graphics/RenderGraph.h"
 
 namespace Viry3D
 {
@@ -33,7 +34,7 @@ namespace Viry3D
 		m_material.reset();
 	}
 
-	void DepthOfField::OnRenderImage(const Ref<RenderTarget>& src, const Ref<RenderTarget>& dst)
+	void DepthOfField::OnRenderGraph(RenderGraph& graph, int src, int dst)
 	{
 		enum Pass
 		{
@@ -49,86 +50,123 @@ namespace Viry3D
 
 		const float FILM_HEIGHT = 0.024f;
 
-		TextureFormat color_format = TextureFormat::R8G8B8A8;
+		const RenderTargetKey& src_key = graph.GetTargetKey(src);
+
+		// coc is kept in alpha of the half res targets
+		TextureFormat color_format = Texture::IsHDRFormat(src_key.color_format) ? Texture::SelectHDRFormat(true) : TextureFormat::R8G8B8A8;
 		TextureFormat coc_format = TextureFormat::R8;
 
 		// material setup
 		float f = m_focal_length / 1000.0f;
 		float s1 = Mathf::Max(m_focus_distance, f);
-		float aspect = src->key.width / (float) src->key.height;
+		float aspect = src_key.width / (float) src_key.height;
 		float coeff = f * f / (m_aperture * (s1 - f) * FILM_HEIGHT * 2.0f);
 		float radius_in_pixels = (float) m_kernel_size * 4 + 6;
-		float max_coc = Mathf::Min(0.05f, radius_in_pixels / src->key.height);
+		float max_coc = Mathf::Min(0.05f, radius_in_pixels / src_key.height);
 		float rcp_max_coc = 1.0f / max_coc;
 		float rcp_aspect = 1.0f / aspect;
 
-		m_material->SetFloat("_Distance", s1);
-		m_material->SetFloat("_LensCoeff", coeff);
-		m_material->SetFloat("_MaxCoC", max_coc);
-		m_material->SetFloat("_RcpMaxCoC", rcp_max_coc);
-		m_material->SetFloat("_RcpAspect", rcp_aspect);
-
-		// coc calculation pass
-		m_material->SetTexture(MaterialProperty::TEXTURE, this->GetCameraDepthTexture());
-
 		auto camera = this->GetGameObject()->GetComponent<Camera>();
 		float near_clip = camera->GetNearClip();
 		float far_clip = camera->GetFarClip();
 		float zc0 = 1.0f - far_clip / near_clip;
 		float zc1 = far_clip / near_clip;
-		m_material->SetVector("_ZBufferParams", Vector4(zc0, zc1, zc0 / far_clip, zc1 / far_clip));
+		Vector4 zbuffer_params(zc0, zc1, zc0 / far_clip, zc1 / far_clip);
 
-		auto coc_tex = RenderTarget::GetTemporaryRenderTarget(
-			src->key.width,
-			src->key.height,
+		int coc_tex = graph.CreateTarget(
+			"CoC",
+			src_key.width,
+			src_key.height,
 			coc_format,
 			TextureFormat::None,
 			FilterMode::Linear,
 			SamplerAddressMode::ClampToEdge,
 			filament::backend::TargetBufferFlags::COLOR);
-		Camera::Blit(Ref<RenderTarget>(), coc_tex, m_material, (int) Pass::CoCCalculation);
-
-		// downsampling and prefiltering pass
-		auto dof_tex = RenderTarget::GetTemporaryRenderTarget(
-			src->key.width / 2,
-			src->key.height / 2,
+		int dof_tex = graph.CreateTarget(
+			"DofPrefilter",
+			src_key.width / 2,
+			src_key.height / 2,
 			color_format,
 			TextureFormat::None,
 			FilterMode::Linear,
 			SamplerAddressMode::ClampToEdge,
 			filament::backend::TargetBufferFlags::COLOR);
-		m_material->SetTexture("_CoCTex", coc_tex->color);
-		m_material->SetVector("u_texel_size", Vector4(1.0f / src->color->GetWidth(), 1.0f / src->color->GetHeight(), 0, 0));
-		m_material->SetTexture(MaterialProperty::TEXTURE, src->color);
-		Camera::Blit(src, dof_tex, m_material, (int) Pass::DownsampleAndPrefilter);
-
-		// bokeh simulation pass
-		auto dof_temp = RenderTarget::GetTemporaryRenderTarget(
-			src->key.width / 2,
-			src->key.height / 2,
+		int dof_temp = graph.CreateTarget(
+			"DofBokeh",
+			src_key.width / 2,
+			src_key.height / 2,
 			color_format,
 			TextureFormat::None,
 			FilterMode::Linear,
 			SamplerAddressMode::ClampToEdge,
 			filament::backend::TargetBufferFlags::COLOR);
-		m_material->SetVector("u_texel_size", Vector4(1.0f / dof_tex->color->GetWidth(), 1.0f / dof_tex->color->GetHeight(), 0, 0));
-		m_material->SetTexture(MaterialProperty::TEXTURE, dof_tex->color);
-		Camera::Blit(dof_tex, dof_temp, m_material, (int) Pass::BokehSmallKernel + (int) m_kernel_size);
+		// takes the place of the prefilter target which is dead after the bokeh pass
+		int dof_post = graph.CreateTarget(
+			"DofPostFilter",
+			src_key.width / 2,
+			src_key.height / 2,
+			color_format,
+			TextureFormat::None,
+			FilterMode::Linear,
+			SamplerAddressMode::ClampToEdge,
+			filament::backend::TargetBufferFlags::COLOR);
+
+		m_src = src;
+		m_dst = dst;
+		m_coc_tex = coc_tex;
+		m_dof_tex = dof_tex;
+		m_dof_temp = dof_temp;
+		m_dof_post = dof_post;
+		m_bokeh_pass = (int) Pass::BokehSmallKernel + (int) m_kernel_size;
+
+		// constants of this frame go to the material now, pass functions only capture this
+		// to fit in the small storage of std::function
+		m_material->SetFloat("_Distance", s1);
+		m_material->SetFloat("_LensCoeff", coeff);
+		m_material->SetFloat("_MaxCoC", max_coc);
+		m_material->SetFloat("_RcpMaxCoC", rcp_max_coc);
+		m_material->SetFloat("_RcpAspect", rcp_aspect);
+		m_material->SetVector("_ZBufferParams", zbuffer_params);
+
+		// coc calculation pass
+		graph.AddPass("DofCoC", { }, { coc_tex }, [this](RenderGraph& graph) {
+			m_material->SetTexture(MaterialProperty::TEXTURE, this->GetCameraDepthTexture());
+			Camera::Blit(Ref<RenderTarget>(), graph.GetTarget(m_coc_tex), m_material, (int) Pass::CoCCalculation);
+		});
+
+		// downsampling and prefiltering pass
+		graph.AddPass("DofPrefilter", { src, coc_tex }, { dof_tex }, [this](RenderGraph& graph) {
+			const auto& from = graph.GetTarget(m_src);
+			m_material->SetTexture("_CoCTex", graph.GetTarget(m_coc_tex)->color);
+			m_material->SetVector("u_texel_size", Vector4(1.0f / from->color->GetWidth(), 1.0f / from->color->GetHeight(), 0, 0));
+			m_material->SetTexture(MaterialProperty::TEXTURE, from->color);
+			Camera::Blit(from, graph.GetTarget(m_dof_tex), m_material, (int) Pass::DownsampleAndPrefilter);
+		});
+
+		// bokeh simulation pass
+		graph.AddPass("DofBokeh", { dof_tex }, { dof_temp }, [this](RenderGraph& graph) {
+			const auto& from = graph.GetTarget(m_dof_tex);
+			m_material->SetVector("u_texel_size", Vector4(1.0f / from->color->GetWidth(), 1.0f / from->color->GetHeight(), 0, 0));
+			m_material->SetTexture(MaterialProperty::TEXTURE, from->color);
+			Camera::Blit(from, graph.GetTarget(m_dof_temp), m_material, m_bokeh_pass);
+		});
 
 		// postfilter pass
-		m_material->SetVector("u_texel_size", Vector4(1.0f / dof_temp->color->GetWidth(), 1.0f / dof_temp->color->GetHeight(), 0, 0));
-		m_material->SetTexture(MaterialProperty::TEXTURE, dof_temp->color);
-		Camera::Blit(dof_temp, dof_tex, m_material, (int) Pass::PostFilter);
+		graph.AddPass("DofPostFilter", { dof_temp }, { dof_post }, [this](RenderGraph& graph) {
+			const auto& from = graph.GetTarget(m_dof_temp);
+			m_material->SetVector("u_texel_size", Vector4(1.0f / from->color->GetWidth(), 1.0f / from->color->GetHeight(), 0, 0));
+			m_material->SetTexture(MaterialProperty::TEXTURE, from->color);
+			Camera::Blit(from, graph.GetTarget(m_dof_post), m_material, (int) Pass::PostFilter);
+		});
 
 		// combine pass
-		m_material->SetTexture("_CoCTex", coc_tex->color);
-		m_material->SetTexture("_DofTex", dof_tex->color);
-		m_material->SetVector("u_texel_size", Vector4(1.0f / src->color->GetWidth(), 1.0f / src->color->GetHeight(), 0, 0));
-		m_material->SetTexture(MaterialProperty::TEXTURE, src->color);
-		Camera::Blit(src, dst, m_material, (int) Pass::Combine);
-
-		RenderTarget::ReleaseTemporaryRenderTarget(dof_temp);
-		RenderTarget::ReleaseTemporaryRenderTarget(dof_tex);
-		RenderTarget::ReleaseTemporaryRenderTarget(coc_tex);
+		graph.AddPass("DofCombine", { src, coc_tex, dof_post }, { dst }, [this](RenderGraph& graph) {
+			const auto& from = graph.GetTarget(m_src);
+			m_material->SetTexture("_CoCTex", graph.GetTarget(m_coc_tex)->color);
+			m_material->SetTexture("_DofTex", graph.GetTarget(m_dof_post)->color);
+			m_material->SetVector("u_texel_size", Vector4(1.0f / from->color->GetWidth(), 1.0f / from->color->GetHeight(), 0, 0));
+			m_material->SetTexture(MaterialProperty::TEXTURE, from->color);
+			Camera::Blit(from, graph.GetTarget(m_dst), m_material, (int) Pass::Combine);
+		});
 	}
 }
@@ -36,7 +36,7 @@ namespace Viry3D
 
 		DepthOfField();
 		virtual ~DepthOfField();
-		virtual void OnRenderImage(const Ref<RenderTarget>& src, const Ref<RenderTarget>& dst);
+		virtual void OnRenderGraph(RenderGraph& graph, int src, int dst);
 		void SetFocusDistance(float distance) { m_focus_distance = distance; }
 		void SetAperture(float aperture) { m_aperture = aperture; }
 		void SetFocalLength(float length) { m_focal_length = length; }
@@ -48,5 +48,13 @@ namespace Viry3D
 		float m_aperture = 5.6f;
 		float m_focal_length = 50.0f;
 		KernelSize m_kernel_size = KernelSize::Medium;
+		// graph targets of this frame
+		int m_src = -1;
+		int m_dst = -1;
+		int m_coc_tex = -1;
+		int m_dof_tex = -1;
+		int m_dof_temp = -1;
+		int m_dof_post = -1;
+		int m_bokeh_pass = 0;
 	};
 }
@@ -17,6 +17,7 @@
 
 #include "PostProcessing.h"
 #include "graphics/Camera.h"
+#include "graphics/RenderGraph.h"
 
 namespace Viry3D
 {
@@ -34,4 +35,11 @@ namespace Viry3D
 	{
 		Camera::Blit(src, dst);
 	}
+
+	void PostProcessing::OnRenderGraph(RenderGraph& graph, int src, int dst)
+	{
+		graph.AddPass(this->GetName(), { src }, { dst }, [=](RenderGraph& graph) {
+			this->OnRenderImage(graph.GetTarget(src), graph.GetTarget(dst));
+		});
+	}
 }
@@ -35,6 +35,8 @@ namespace Viry3D
 	float Time::m_time = 0;
 	int Time::m_fps;
 	int Time::m_draw_call = 0;
+	int Time::m_skipped_state_change = 0;
+	int Time::m_submit_alloc_count = 0;
 
 	Date Time::GetDate()
 	{
@@ -52,6 +52,12 @@ namespace Viry3D
 		static int GetFPS() { return m_fps; }
 		static void SetDrawCall(int count) { m_draw_call = count; }
 		static int GetDrawCall() { return m_draw_call; }
+		//	redundant binding and scissor commands dropped by RenderState
+		static void SetSkippedStateChange(int count) { m_skipped_state_change = count; }
+		static int GetSkippedStateChange() { return m_skipped_state_change; }
+		//	allocations made by shadow and camera submission last frame, always 0 in release builds
+		static void SetSubmitAllocCount(int count) { m_submit_alloc_count = count; }
+		static int GetSubmitAllocCount() { return m_submit_alloc_count; }
 		static void Update();
 
 	private:
@@ -63,5 +69,7 @@ namespace Viry3D
 		static int m_frame_record;
 		static int m_fps;
 		static int m_draw_call;
+		static int m_skipped_state_change;
+		static int m_submit_alloc_count;
 	};
 }
@@ -268,6 +268,11 @@ public class GameObjectExporter
                 com_writers.Add(WriteSpringManager);
                 write_coms.Add(coms[i]);
             }
+            else if (coms[i] is LODGroup)
+            {
+                com_writers.Add(WriteLODGroup);
+                write_coms.Add(coms[i]);
+            }
         }
 
         bw.Write(write_coms.Count);
@@ -1234,6 +1239,42 @@ public class GameObjectExporter
         }
     }
 
+    static void WriteLODGroup(Component com)
+    {
+        WriteString("LODGroup");
+
+        LODGroup group = com as LODGroup;
+        var lods = group.GetLODs();
+        bw.Write(lods.Length);
+        for (int i = 0; i < lods.Length; ++i)
+        {
+            var lod = lods[i];
+            bw.Write(lod.screenRelativeTransitionHeight);
+            bw.Write(lod.fadeTransitionWidth);
+
+            int renderer_count = lod.renderers != null ? lod.renderers.Length : 0;
+            bw.Write(renderer_count);
+            for (int j = 0; j < renderer_count; ++j)
+            {
+                var renderer = lod.renderers[j];
+                if (renderer == null)
+                {
+                    WriteString("");
+                }
+                else if (renderer.transform == group.transform)
+                {
+                    WriteString(".");
+                }
+                else
+                {
+                    WriteString(GetRelativePath(group.transform, renderer.transform));
+                }
+            }
+        }
+
+        bw.Write((byte) (group.fadeMode == LODFadeMode.CrossFade ? 1 : 0));
+    }
+
     static string GetRelativePath(Transform a, Transform b)
     {
         if (a.transform.root != b.transform.root)